@@ -0,0 +1,38 @@
+#include "corpus.h"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+std::vector<CorpusPage> loadCorpus() {
+    const char* overrideDir = std::getenv("BENCH_CORPUS");
+    std::filesystem::path dir = overrideDir ? overrideDir : BENCH_CORPUS_DIR;
+
+    std::vector<CorpusPage> pages;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".html") {
+            continue;
+        }
+
+        std::ifstream file(entry.path(), std::ios::binary);
+        std::ostringstream content;
+        content << file.rdbuf();
+
+        CorpusPage page;
+        page.name = entry.path().stem().string();
+        page.html = content.str();
+        page.base = {ProtocolType::HTTPS, "bench.example.org", "/corpus/" + page.name + ".html"};
+        pages.push_back(std::move(page));
+    }
+
+    if (pages.empty()) {
+        throw std::runtime_error("No .html files in benchmark corpus " + dir.string());
+    }
+
+    // Stable benchmark names across runs
+    std::sort(pages.begin(), pages.end(),
+        [](const CorpusPage& a, const CorpusPage& b) { return a.name < b.name; });
+    return pages;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "link.h"
+
+// Checked-in HTML pages the benchmarks run over. Pages are read from the
+// BENCH_CORPUS environment variable if set, else from bench/corpus.
+struct CorpusPage {
+    std::string name;
+    std::string html;
+    Link base;
+};
+
+std::vector<CorpusPage> loadCorpus();
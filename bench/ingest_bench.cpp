@@ -0,0 +1,209 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <pqxx/pqxx>
+#include "corpus.h"
+#include "database.h"
+#include "doc_store.h"
+#include "html_parser.h"
+#include "posting_block.h"
+#include "simhash.h"
+
+// Index writes against a real PostgreSQL, through the same Database calls
+// the spider's index stage makes. Point BENCH_DATABASE at a scratch
+// database (libpq connection string): every iteration adds new documents.
+namespace {
+    std::unique_ptr<Database> database;
+    std::string connectionString;
+    std::string runId = std::to_string(
+        std::chrono::system_clock::now().time_since_epoch().count());
+
+    struct ParsedPage {
+        std::string name;
+        std::string title;
+        std::string text;
+        std::unordered_map<std::string, std::vector<uint32_t>> positions;
+        uint64_t fingerprint = 0;
+        size_t bytes = 0;
+    };
+
+    void ingestPage(benchmark::State& state, const ParsedPage* page) {
+        if (!database) {
+            state.SkipWithError("BENCH_DATABASE is not set");
+            return;
+        }
+
+        // One page per transaction, the cost of a single document
+        size_t serial = 0;
+        std::vector<IndexedPage> batch(1);
+        IndexedPage& indexed = batch.front();
+        indexed.title = page->title;
+        indexed.simhash = page->fingerprint;
+        indexed.wordPositions = page->positions;
+        for (auto _ : state) {
+            // A fresh url per iteration, so every write is an insert and not an upsert
+            indexed.url = "bench://" + runId + "/" + page->name + "/" + std::to_string(serial++);
+            indexed.text = DocumentStore::compress(page->text);
+            database->indexBatch(batch);
+        }
+
+        state.SetItemsProcessed(state.iterations());
+        state.SetBytesProcessed(state.iterations() * page->bytes);
+        state.counters["words"] = static_cast<double>(page->positions.size());
+    }
+
+    // The spider's index stage: state.range(0) pages per transaction
+    void ingestBatch(benchmark::State& state, const std::vector<ParsedPage>* pages) {
+        if (!database) {
+            state.SkipWithError("BENCH_DATABASE is not set");
+            return;
+        }
+
+        size_t batchSize = static_cast<size_t>(state.range(0));
+        size_t serial = 0;
+        size_t bytes = 0;
+        std::vector<IndexedPage> batch(batchSize);
+        for (auto _ : state) {
+            state.PauseTiming();
+            for (auto& indexed : batch) {
+                const ParsedPage& page = (*pages)[serial % pages->size()];
+                indexed.url = "bench://" + runId + "/batch/" + std::to_string(serial++);
+                indexed.title = page.title;
+                indexed.simhash = page.fingerprint;
+                indexed.text = DocumentStore::compress(page.text);
+                indexed.wordPositions = page.positions;
+                bytes += page.bytes;
+            }
+            state.ResumeTiming();
+
+            database->indexBatch(batch);
+        }
+
+        state.SetItemsProcessed(state.iterations() * batchSize);
+        state.SetBytesProcessed(bytes);
+    }
+
+    // --bulk-load: state.range(0) pages staged in batches of 128, then merged,
+    // so items/s compares directly with IngestBatch. With posting blocks an
+    // untimed load runs first, so every timed one appends to existing blocks;
+    // the run fails if that left a part-filled block anywhere but at the end
+    // of a word's list.
+    void ingestBulk(benchmark::State& state, const std::vector<ParsedPage>* pages, PostingLayout layout) {
+        if (!database) {
+            state.SkipWithError("BENCH_DATABASE is not set");
+            return;
+        }
+        Database::setPostingLayout(layout);
+
+        size_t pageCount = static_cast<size_t>(state.range(0));
+        size_t serial = 0;
+        size_t bytes = 0;
+        std::vector<IndexedPage> all(pageCount);
+        std::vector<IndexedPage> batch;
+        auto prepare = [&] {
+            for (auto& indexed : all) {
+                const ParsedPage& page = (*pages)[serial % pages->size()];
+                indexed.url = "bench://" + runId + "/bulk/" + std::to_string(serial++);
+                indexed.title = page.title;
+                indexed.simhash = page.fingerprint;
+                indexed.text = DocumentStore::compress(page.text);
+                indexed.wordPositions = page.positions;
+                bytes += page.bytes;
+            }
+        };
+        auto load = [&] {
+            database->beginBulkLoad();
+            for (size_t start = 0; start < all.size(); start += 128) {
+                batch.assign(all.begin() + start, all.begin() + std::min(all.size(), start + 128));
+                database->stageBatch(batch);
+            }
+            database->finishBulkLoad();
+        };
+
+        if (layout == PostingLayout::Blocks) {
+            prepare();
+            load();
+            bytes = 0;
+        }
+        for (auto _ : state) {
+            state.PauseTiming();
+            prepare();
+            state.ResumeTiming();
+
+            load();
+        }
+
+        state.SetItemsProcessed(state.iterations() * pageCount);
+        state.SetBytesProcessed(bytes);
+        Database::setPostingLayout(PostingLayout::Rows);
+
+        if (layout == PostingLayout::Blocks) {
+            pqxx::connection conn(connectionString);
+            pqxx::read_transaction txn(conn);
+            pqxx::result fill = txn.exec(
+                "SELECT COALESCE(AVG(postings), 0), "
+                "COUNT(*) FILTER (WHERE postings < " + std::to_string(PostingBlock::kBlockPostings) +
+                " AND first_document <> tail) "
+                "FROM (SELECT postings, first_document, "
+                "MAX(first_document) OVER (PARTITION BY word_id) AS tail FROM posting_blocks) b"
+            );
+            state.counters["block_fill"] = fill[0][0].as<double>() / PostingBlock::kBlockPostings;
+            if (fill[0][1].as<long long>() > 0) {
+                state.SkipWithError("Bulk loads left part-filled posting blocks inside a list");
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+
+    if (const char* connection = std::getenv("BENCH_DATABASE")) {
+        connectionString = connection;
+        database = std::make_unique<Database>(connection);
+        database->initializeDatabase();
+    }
+
+    // Parsing is measured by ParserBench, only the writes are timed here
+    static std::vector<ParsedPage> pages;
+    for (const auto& corpusPage : loadCorpus()) {
+        ParsedPage page;
+        page.name = corpusPage.name;
+        page.title = HtmlParser::extractTitle(corpusPage.html);
+        page.text = HtmlParser::extractText(corpusPage.html);
+        page.positions = HtmlParser::wordPositions(page.text);
+        page.fingerprint = SimHash::compute(page.positions);
+        page.bytes = corpusPage.html.size();
+        pages.push_back(std::move(page));
+    }
+
+    for (const auto& page : pages) {
+        benchmark::RegisterBenchmark(("IngestPage/" + page.name).c_str(), ingestPage, &page)
+            ->UseRealTime()
+            ->Unit(benchmark::kMillisecond);
+    }
+
+    benchmark::RegisterBenchmark("IngestBatch", ingestBatch, &pages)
+        ->Arg(1)->Arg(8)->Arg(32)->Arg(128)
+        ->UseRealTime()
+        ->Unit(benchmark::kMillisecond);
+
+    benchmark::RegisterBenchmark("IngestBulk/rows", ingestBulk, &pages, PostingLayout::Rows)
+        ->Arg(1024)->Arg(8192)
+        ->UseRealTime()
+        ->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("IngestBulk/blocks", ingestBulk, &pages, PostingLayout::Blocks)
+        ->Arg(1024)->Arg(8192)
+        ->UseRealTime()
+        ->Unit(benchmark::kMillisecond);
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    database.reset();
+    return 0;
+}
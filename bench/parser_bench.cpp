@@ -0,0 +1,113 @@
+#include <benchmark/benchmark.h>
+#include "corpus.h"
+#include "html_parser.h"
+#include "simhash.h"
+#include "tokenizer.h"
+
+namespace {
+    void extractText(benchmark::State& state, const CorpusPage* page) {
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(HtmlParser::extractText(page->html));
+        }
+        state.SetBytesProcessed(state.iterations() * page->html.size());
+    }
+
+    void extractTitle(benchmark::State& state, const CorpusPage* page) {
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(HtmlParser::extractTitle(page->html));
+        }
+        state.SetBytesProcessed(state.iterations() * page->html.size());
+    }
+
+    void extractLinks(benchmark::State& state, const CorpusPage* page) {
+        size_t links = 0;
+        for (auto _ : state) {
+            auto found = HtmlParser::extractLinks(page->base, page->html);
+            links = found.size();
+            benchmark::DoNotOptimize(found);
+        }
+        state.SetBytesProcessed(state.iterations() * page->html.size());
+        state.counters["links"] = static_cast<double>(links);
+    }
+
+    // Term frequencies straight from the tokenizer, the path the spider's
+    // word counting went through before positions were kept
+    void countWords(benchmark::State& state, const CorpusPage* page) {
+        std::string text = HtmlParser::extractText(page->html);
+        size_t words = 0;
+        for (auto _ : state) {
+            std::unordered_map<std::string, int> counts;
+            Tokenizer::getInstance().tokenize(text, [&](std::string_view word, uint32_t) {
+                ++counts[std::string(word)];
+            });
+            words = counts.size();
+            benchmark::DoNotOptimize(counts);
+        }
+        state.SetBytesProcessed(state.iterations() * text.size());
+        state.counters["words"] = static_cast<double>(words);
+    }
+
+    void wordPositions(benchmark::State& state, const CorpusPage* page) {
+        std::string text = HtmlParser::extractText(page->html);
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(HtmlParser::wordPositions(text));
+        }
+        state.SetBytesProcessed(state.iterations() * text.size());
+    }
+
+    void simHash(benchmark::State& state, const CorpusPage* page) {
+        auto positions = HtmlParser::wordPositions(HtmlParser::extractText(page->html));
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(SimHash::compute(positions));
+        }
+        state.SetItemsProcessed(state.iterations() * positions.size());
+    }
+
+    // The href shapes seen on real pages, crawlable or not
+    void resolveLink(benchmark::State& state) {
+        const Link base{ProtocolType::HTTPS, "bench.example.org", "/docs/container/unordered_map/reserve.html"};
+        const std::vector<std::string> hrefs = {
+            "https://en.example.org/wiki/Inverted_index",
+            "http://www.vldb.example.org/pvldb/vol10/p2067-wang.pdf",
+            "http://example.org",
+            "//donate.example.org/?utm_source=donate&utm_medium=sidebar",
+            "/wiki/Search_engine",
+            "/society/2024/03/12/pensii-indeksaciya/?utm_source=popular",
+            "../vector/reserve.html",
+            "./max_load_factor.html",
+            "rehash.html",
+            "#cite_note-1",
+            "javascript:void(0)",
+            "mailto:info@news.example.ru",
+        };
+
+        for (auto _ : state) {
+            for (const auto& href : hrefs) {
+                benchmark::DoNotOptimize(HtmlParser::resolveLink(base, href));
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * hrefs.size());
+    }
+}
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+
+    static const std::vector<CorpusPage> corpus = loadCorpus();
+    for (const auto& page : corpus) {
+        benchmark::RegisterBenchmark(("ExtractText/" + page.name).c_str(), extractText, &page);
+        benchmark::RegisterBenchmark(("ExtractTitle/" + page.name).c_str(), extractTitle, &page);
+        benchmark::RegisterBenchmark(("ExtractLinks/" + page.name).c_str(), extractLinks, &page);
+        benchmark::RegisterBenchmark(("CountWords/" + page.name).c_str(), countWords, &page);
+        benchmark::RegisterBenchmark(("WordPositions/" + page.name).c_str(), wordPositions, &page);
+        benchmark::RegisterBenchmark(("SimHash/" + page.name).c_str(), simHash, &page);
+    }
+    benchmark::RegisterBenchmark("ResolveLink", resolveLink);
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "bounded_queue.h"
+
+// The parsed-page queue of the crawl pipeline: parser threads push, several
+// index writers take batches. Besides the throughput, every run checks that
+// each item reached exactly one writer and that no batch came back empty.
+namespace {
+    constexpr size_t kProducers = 4;
+    constexpr uint64_t kItemsPerProducer = 50000;
+
+    void popBatch(benchmark::State& state) {
+        const size_t consumers = static_cast<size_t>(state.range(0));
+        const size_t batchSize = static_cast<size_t>(state.range(1));
+        const uint64_t total = kProducers * kItemsPerProducer;
+
+        for (auto _ : state) {
+            BoundedQueue<uint64_t> queue(1024);
+            std::atomic<uint64_t> received{0};
+            std::atomic<uint64_t> sum{0};
+            std::atomic<uint64_t> emptyBatches{0};
+
+            std::vector<std::thread> threads;
+            for (size_t c = 0; c < consumers; ++c) {
+                threads.emplace_back([&] {
+                    std::vector<uint64_t> batch;
+                    while (queue.popBatch(batch, batchSize, std::chrono::milliseconds(2))) {
+                        if (batch.empty()) {
+                            emptyBatches.fetch_add(1);
+                        }
+                        uint64_t local = 0;
+                        for (uint64_t item : batch) {
+                            local += item;
+                        }
+                        received.fetch_add(batch.size());
+                        sum.fetch_add(local);
+                        batch.clear();
+                    }
+                });
+            }
+
+            std::vector<std::thread> producers;
+            for (size_t p = 0; p < kProducers; ++p) {
+                producers.emplace_back([&, p] {
+                    for (uint64_t i = 0; i < kItemsPerProducer; ++i) {
+                        queue.push(p * kItemsPerProducer + i + 1);
+                    }
+                });
+            }
+            for (auto& producer : producers) {
+                producer.join();
+            }
+            queue.close();
+            for (auto& thread : threads) {
+                thread.join();
+            }
+
+            if (received != total || sum != total * (total + 1) / 2) {
+                state.SkipWithError("Items lost or delivered twice");
+                return;
+            }
+            if (emptyBatches > 0) {
+                state.SkipWithError("popBatch returned an empty batch");
+                return;
+            }
+        }
+
+        state.SetItemsProcessed(state.iterations() * total);
+    }
+}
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+
+    // Consumers, batch size
+    benchmark::RegisterBenchmark("PopBatch", popBatch)
+        ->Args({1, 32})->Args({4, 32})->Args({8, 32})->Args({8, 512})
+        ->UseRealTime()
+        ->Unit(benchmark::kMillisecond);
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,297 @@
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include "metrics.h"
+#include "utf8.h"
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+// Replays a JSONL query log against a running HttpServerApp and reports
+// throughput and latency percentiles. Each line is a JSON object; the
+// string under --field (default "query") is sent as the search query.
+//
+//   SearchLoad --queries bench/queries.jsonl --threads 8 --duration 30
+
+namespace {
+    struct Options {
+        std::string host = "127.0.0.1";
+        std::string port = "8080";
+        std::string queries = BENCH_QUERIES_FILE;
+        std::string field = "query";
+        std::string mode = "api";     // api: GET /api/search, form: POST /
+        int threads = 4;
+        int k = 10;
+        double duration = 10;         // seconds, after warmup
+        double warmup = 2;
+        long long requests = 0;       // stop after this many, if set
+    };
+
+    // Value of a top level string field, or false if the line has none
+    bool readStringField(const std::string& line, const std::string& field, std::string& value) {
+        std::string key = "\"" + field + "\"";
+        size_t pos = line.find(key);
+        if (pos == std::string::npos) return false;
+        pos = line.find(':', pos + key.size());
+        if (pos == std::string::npos) return false;
+        pos = line.find_first_not_of(" \t", pos + 1);
+        if (pos == std::string::npos || line[pos] != '"') return false;
+
+        auto hex4 = [&line](size_t at, char32_t& out) {
+            if (at + 4 > line.size()) return false;
+            out = 0;
+            for (size_t i = at; i < at + 4; ++i) {
+                char c = line[i];
+                out <<= 4;
+                if (c >= '0' && c <= '9') out |= c - '0';
+                else if (c >= 'a' && c <= 'f') out |= c - 'a' + 10;
+                else if (c >= 'A' && c <= 'F') out |= c - 'A' + 10;
+                else return false;
+            }
+            return true;
+        };
+
+        value.clear();
+        for (size_t i = pos + 1; i < line.size(); ++i) {
+            char c = line[i];
+            if (c == '"') return true;
+            if (c != '\\') {
+                value.push_back(c);
+                continue;
+            }
+            if (++i >= line.size()) return false;
+            switch (line[i]) {
+            case 'n': value.push_back('\n'); break;
+            case 't': value.push_back('\t'); break;
+            case 'r': value.push_back('\r'); break;
+            case 'b': value.push_back('\b'); break;
+            case 'f': value.push_back('\f'); break;
+            case 'u': {
+                char32_t cp;
+                if (!hex4(i + 1, cp)) return false;
+                i += 4;
+                char32_t low;
+                if (cp >= 0xD800 && cp < 0xDC00 && i + 6 < line.size() && line[i + 1] == '\\' && line[i + 2] == 'u'
+                    && hex4(i + 3, low) && low >= 0xDC00 && low < 0xE000) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    i += 6;
+                }
+                utf8::append(value, cp);
+                break;
+            }
+            default: value.push_back(line[i]); break;
+            }
+        }
+        return false;
+    }
+
+    std::vector<std::string> loadQueries(const Options& options) {
+        std::ifstream file(options.queries, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Cannot open " + options.queries);
+        }
+
+        std::vector<std::string> queries;
+        std::string line;
+        std::string query;
+        while (std::getline(file, line)) {
+            if (readStringField(line, options.field, query) && !query.empty()) {
+                queries.push_back(query);
+            }
+        }
+        if (queries.empty()) {
+            throw std::runtime_error("No \"" + options.field + "\" strings in " + options.queries);
+        }
+        return queries;
+    }
+
+    std::string urlEncode(const std::string& text) {
+        static const char* hex = "0123456789ABCDEF";
+        std::string out;
+        for (unsigned char c : text) {
+            if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+                out.push_back(static_cast<char>(c));
+            } else if (c == ' ') {
+                out.push_back('+');
+            } else {
+                out.push_back('%');
+                out.push_back(hex[c >> 4]);
+                out.push_back(hex[c & 15]);
+            }
+        }
+        return out;
+    }
+
+    struct LoadState {
+        std::atomic<bool> stop{false};
+        std::atomic<bool> measuring{false};
+        std::atomic<long long> sent{0};
+        metrics::Histogram latency;
+        metrics::Counter completed;
+        metrics::Counter errors;
+        metrics::Counter bytes;
+    };
+
+    // The server closes every connection after its response, so each
+    // request opens a new one, like a browser without keep-alive would
+    void worker(const Options& options, const std::vector<std::string>& queries,
+        const tcp::resolver::results_type& endpoints, size_t first, LoadState& load) {
+        net::io_context ioc;
+        size_t next = first;
+
+        while (!load.stop.load(std::memory_order_relaxed)) {
+            if (options.requests > 0 && load.measuring && load.sent.fetch_add(1) >= options.requests) {
+                load.stop = true;
+                break;
+            }
+
+            const std::string& query = queries[next];
+            next = (next + static_cast<size_t>(options.threads)) % queries.size();
+
+            http::request<http::string_body> request;
+            request.version(11);
+            request.set(http::field::host, options.host);
+            request.set(http::field::user_agent, "SearchLoad");
+            if (options.mode == "form") {
+                request.method(http::verb::post);
+                request.target("/");
+                request.set(http::field::content_type, "application/x-www-form-urlencoded");
+                request.body() = "search=" + urlEncode(query);
+            } else {
+                request.method(http::verb::get);
+                request.target("/api/search?q=" + urlEncode(query) + "&k=" + std::to_string(options.k));
+            }
+            request.prepare_payload();
+
+            bool measured = load.measuring.load(std::memory_order_relaxed);
+            auto start = std::chrono::steady_clock::now();
+            try {
+                beast::tcp_stream stream(ioc);
+                stream.expires_after(std::chrono::seconds(30));
+                stream.connect(endpoints);
+                http::write(stream, request);
+
+                beast::flat_buffer buffer;
+                http::response<http::string_body> response;
+                http::read(stream, buffer, response);
+
+                beast::error_code ec;
+                stream.socket().shutdown(tcp::socket::shutdown_both, ec);
+
+                if (!measured) continue;
+                load.latency.record(std::chrono::steady_clock::now() - start);
+                load.completed.add();
+                load.bytes.add(response.body().size());
+                if (response.result() != http::status::ok) {
+                    load.errors.add();
+                }
+            } catch (const std::exception&) {
+                if (measured) load.errors.add();
+            }
+        }
+    }
+
+    bool parseArgs(int argc, char* argv[], Options& options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc) {
+                std::cerr << "❌ Missing value for " << arg << std::endl;
+                return false;
+            }
+            std::string value = argv[++i];
+            if (arg == "--host") options.host = value;
+            else if (arg == "--port") options.port = value;
+            else if (arg == "--queries") options.queries = value;
+            else if (arg == "--field") options.field = value;
+            else if (arg == "--mode") options.mode = value;
+            else if (arg == "--threads") options.threads = std::max(1, std::stoi(value));
+            else if (arg == "--k") options.k = std::max(1, std::stoi(value));
+            else if (arg == "--duration") options.duration = std::stod(value);
+            else if (arg == "--warmup") options.warmup = std::stod(value);
+            else if (arg == "--requests") options.requests = std::stoll(value);
+            else {
+                std::cerr << "❌ Unknown option " << arg << std::endl;
+                return false;
+            }
+        }
+        if (options.mode != "api" && options.mode != "form") {
+            std::cerr << "❌ --mode must be api or form" << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        std::cerr << "Usage: SearchLoad [--host H] [--port P] [--queries FILE.jsonl] [--field NAME] "
+                     "[--mode api|form] [--threads N] [--k K] [--warmup S] [--duration S] [--requests N]"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        std::vector<std::string> queries = loadQueries(options);
+
+        net::io_context ioc;
+        auto endpoints = tcp::resolver(ioc).resolve(options.host, options.port);
+
+        std::cout << "🔍 Replaying " << queries.size() << " queries from " << options.queries
+                  << " against " << options.host << ":" << options.port
+                  << " with " << options.threads << " threads" << std::endl;
+
+        LoadState load;
+        std::vector<std::thread> threads;
+        for (int i = 0; i < options.threads; ++i) {
+            threads.emplace_back(worker, std::cref(options), std::cref(queries), std::cref(endpoints),
+                static_cast<size_t>(i) % queries.size(), std::ref(load));
+        }
+
+        std::this_thread::sleep_for(std::chrono::duration<double>(options.warmup));
+        load.measuring = true;
+        auto start = std::chrono::steady_clock::now();
+
+        auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(options.duration));
+        while (!load.stop && (options.requests > 0 || std::chrono::steady_clock::now() < deadline)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        load.stop = true;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        auto snapshot = load.latency.snapshot();
+        auto ms = [](uint64_t micros) { return micros / 1000.0; };
+
+        std::cout << std::fixed << std::setprecision(2)
+                  << "📊 Requests:   " << load.completed.value() << " in " << elapsed << " s ("
+                  << load.errors.value() << " errors)\n"
+                  << "📊 Throughput: " << load.completed.value() / elapsed << " req/s, "
+                  << load.bytes.value() / elapsed / 1024 << " KiB/s\n"
+                  << "📊 Latency ms: mean "
+                  << (snapshot.count ? ms(snapshot.sum) / snapshot.count : 0.0)
+                  << ", p50 " << ms(snapshot.percentile(0.50))
+                  << ", p90 " << ms(snapshot.percentile(0.90))
+                  << ", p99 " << ms(snapshot.percentile(0.99))
+                  << ", p99.9 " << ms(snapshot.percentile(0.999))
+                  << ", max " << ms(snapshot.percentile(1.0)) << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "💥 Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,75 @@
+#include <benchmark/benchmark.h>
+#include "corpus.h"
+#include "doc_store.h"
+#include "html_parser.h"
+#include "tokenizer.h"
+
+namespace {
+    void tokenize(benchmark::State& state, const std::string* text, bool stemming) {
+        Tokenizer::Options options;
+        options.stemming = stemming;
+        Tokenizer tokenizer(options);
+
+        size_t terms = 0;
+        for (auto _ : state) {
+            terms = 0;
+            tokenizer.tokenize(*text, [&](std::string_view term, uint32_t) {
+                benchmark::DoNotOptimize(term.data());
+                ++terms;
+            });
+        }
+        state.SetBytesProcessed(state.iterations() * text->size());
+        state.counters["terms"] = static_cast<double>(terms);
+    }
+
+    void foldCase(benchmark::State& state, const std::string* text) {
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(Tokenizer::foldCase(*text));
+        }
+        state.SetBytesProcessed(state.iterations() * text->size());
+    }
+
+    void compress(benchmark::State& state, const std::string* text) {
+        size_t packed = 0;
+        for (auto _ : state) {
+            auto body = DocumentStore::compress(*text);
+            packed = body.size();
+            benchmark::DoNotOptimize(body);
+        }
+        state.SetBytesProcessed(state.iterations() * text->size());
+        state.counters["ratio"] = packed ? static_cast<double>(text->size()) / packed : 0;
+    }
+
+    void decompress(benchmark::State& state, const std::string* text) {
+        auto body = DocumentStore::compress(*text);
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(DocumentStore::decompress(body));
+        }
+        state.SetBytesProcessed(state.iterations() * text->size());
+    }
+}
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+
+    // Tokenizer input is what the spider feeds it: page text with markup removed
+    static std::vector<std::pair<std::string, std::string>> texts;
+    for (const auto& page : loadCorpus()) {
+        texts.emplace_back(page.name, HtmlParser::extractText(page.html));
+    }
+
+    for (const auto& [name, text] : texts) {
+        benchmark::RegisterBenchmark(("Tokenize/" + name).c_str(), tokenize, &text, false);
+        benchmark::RegisterBenchmark(("TokenizeStemmed/" + name).c_str(), tokenize, &text, true);
+        benchmark::RegisterBenchmark(("FoldCase/" + name).c_str(), foldCase, &text);
+        benchmark::RegisterBenchmark(("Compress/" + name).c_str(), compress, &text);
+        benchmark::RegisterBenchmark(("Decompress/" + name).c_str(), decompress, &text);
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include "async_logger.h"
+#include <iostream>
+
+AsyncLogger::AsyncLogger()
+    : ring_(kCapacity)
+{
+    thread_ = std::thread([this] { run(); });
+}
+
+AsyncLogger::~AsyncLogger() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void AsyncLogger::write(Level level, std::string line) {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (size_ == ring_.size()) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        Entry& entry = ring_[(head_ + size_) % ring_.size()];
+        entry.level = level;
+        entry.line = std::move(line);
+        ++size_;
+    }
+    wake_.notify_one();
+}
+
+void AsyncLogger::flush() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    drained_.wait(lock, [this] { return (size_ == 0 && !writing_) || stop_; });
+}
+
+void AsyncLogger::run() {
+    std::vector<Entry> batch;
+    uint64_t reportedDrops = 0;
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (true) {
+        wake_.wait(lock, [this] { return size_ > 0 || stop_; });
+        if (size_ == 0 && stop_) {
+            break;
+        }
+
+        // Take everything queued so far, then write without holding the lock
+        batch.clear();
+        while (size_ > 0) {
+            batch.push_back(std::move(ring_[head_]));
+            head_ = (head_ + 1) % ring_.size();
+            --size_;
+        }
+        writing_ = true;
+        lock.unlock();
+
+        bool errors = false;
+        for (const Entry& entry : batch) {
+            if (entry.level == Level::Error) {
+                std::cerr << entry.line << '\n';
+                errors = true;
+            } else {
+                std::cout << entry.line << '\n';
+            }
+        }
+        uint64_t drops = dropped_.load(std::memory_order_relaxed);
+        if (drops != reportedDrops) {
+            std::cerr << "⚠️  Log buffer full, dropped " << drops - reportedDrops << " lines" << '\n';
+            reportedDrops = drops;
+            errors = true;
+        }
+        std::cout.flush();
+        if (errors) {
+            std::cerr.flush();
+        }
+
+        lock.lock();
+        writing_ = false;
+        drained_.notify_all();
+    }
+    drained_.notify_all();
+}
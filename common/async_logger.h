@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Log lines go into a bounded ring buffer and are written by one
+// background thread, so worker threads never block on console I/O or
+// per-line flushes. When the ring is full new lines are dropped and
+// counted rather than stalling the caller.
+class AsyncLogger {
+public:
+    enum class Level { Info, Error };
+
+    void write(Level level, std::string line);
+    // Blocks until every queued line has been written
+    void flush();
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    static AsyncLogger& getInstance() {
+        static AsyncLogger instance;
+        return instance;
+    }
+
+private:
+    static constexpr size_t kCapacity = 8192;
+
+    struct Entry {
+        Level level = Level::Info;
+        std::string line;
+    };
+
+    AsyncLogger();
+    ~AsyncLogger();
+    void run();
+
+    std::mutex mtx_;
+    std::condition_variable wake_;
+    std::condition_variable drained_;
+    std::vector<Entry> ring_;
+    size_t head_ = 0;
+    size_t size_ = 0;
+    bool writing_ = false;
+    bool stop_ = false;
+    std::atomic<uint64_t> dropped_{0};
+    std::thread thread_;
+};
+
+// One log line, queued when the statement ends:
+//   Log::info() << "🌐 Fetching: " << url;
+class LogLine {
+public:
+    explicit LogLine(AsyncLogger::Level level) : level_(level) {}
+    ~LogLine() { AsyncLogger::getInstance().write(level_, stream_.str()); }
+
+    LogLine(const LogLine&) = delete;
+    LogLine& operator=(const LogLine&) = delete;
+
+    template <class T>
+    LogLine& operator<<(const T& value) {
+        stream_ << value;
+        return *this;
+    }
+
+private:
+    AsyncLogger::Level level_;
+    std::ostringstream stream_;
+};
+
+class Log {
+public:
+    static LogLine info() { return LogLine(AsyncLogger::Level::Info); }
+    static LogLine error() { return LogLine(AsyncLogger::Level::Error); }
+};
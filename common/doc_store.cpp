@@ -0,0 +1,140 @@
+﻿#include "doc_store.h"
+#include <zlib.h>
+#include <stdexcept>
+
+namespace {
+
+constexpr unsigned char kFormatVersion = 1;
+
+// Preset dictionary, version 1. Deflate looks back from the end of it,
+// so the most frequent strings come last. Never change it in place:
+// stored texts depend on it, add a new version instead.
+constexpr std::string_view kDictionary =
+    "copyright privacy policy terms of use cookies contact us about us subscribe newsletter "
+    "login sign in sign up register password search menu navigation skip to content "
+    "read more share facebook twitter email print comments reply previous next page "
+    "home news blog articles category tags archive posted by published updated "
+    "все права защищены политика конфиденциальности контакты о компании подписаться "
+    "войти регистрация поиск главная новости статьи комментарии читать далее "
+    "который которые также может если было были будет этого этот только после "
+    "information available however between through because without against during "
+    "should would could there their which about other these those after before "
+    "that with this from have are was were will your more what when where been "
+    "для что это как так все или его она они был при есть уже ещё еще "
+    " the and of to in is for on that by with as at from ";
+
+void appendVarint(std::basic_string<std::byte>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<std::byte>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::byte>(value));
+}
+
+uint64_t readVarint(std::basic_string_view<std::byte> data, size_t& pos) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= data.size()) {
+            throw std::runtime_error("Truncated document text");
+        }
+        auto byte = static_cast<uint8_t>(data[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+    throw std::runtime_error("Malformed document text");
+}
+
+const Bytef* dictionaryBytes() {
+    return reinterpret_cast<const Bytef*>(kDictionary.data());
+}
+
+}
+
+std::basic_string<std::byte> DocumentStore::compress(std::string_view text) {
+    std::basic_string<std::byte> out;
+    out.push_back(static_cast<std::byte>(kFormatVersion));
+    appendVarint(out, (text.size() + kBlockSize - 1) / kBlockSize);
+
+    z_stream zs{};
+    if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("deflateInit2 failed");
+    }
+
+    std::string packed;
+    for (size_t offset = 0; offset < text.size(); offset += kBlockSize) {
+        std::string_view block = text.substr(offset, kBlockSize);
+
+        deflateReset(&zs);
+        deflateSetDictionary(&zs, dictionaryBytes(), static_cast<uInt>(kDictionary.size()));
+
+        packed.resize(deflateBound(&zs, static_cast<uLong>(block.size())));
+        zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(block.data()));
+        zs.avail_in = static_cast<uInt>(block.size());
+        zs.next_out = reinterpret_cast<Bytef*>(packed.data());
+        zs.avail_out = static_cast<uInt>(packed.size());
+
+        if (deflate(&zs, Z_FINISH) != Z_STREAM_END) {
+            deflateEnd(&zs);
+            throw std::runtime_error("deflate failed");
+        }
+        packed.resize(packed.size() - zs.avail_out);
+
+        appendVarint(out, block.size());
+        appendVarint(out, packed.size());
+        out.append(reinterpret_cast<const std::byte*>(packed.data()), packed.size());
+    }
+
+    deflateEnd(&zs);
+    return out;
+}
+
+std::string DocumentStore::decompress(std::basic_string_view<std::byte> data, size_t maxBytes) {
+    std::string text;
+    if (data.empty()) {
+        return text;
+    }
+    if (static_cast<unsigned char>(data[0]) != kFormatVersion) {
+        throw std::runtime_error("Unknown document text format");
+    }
+
+    size_t pos = 1;
+    uint64_t blocks = readVarint(data, pos);
+
+    z_stream zs{};
+    if (inflateInit2(&zs, -15) != Z_OK) {
+        throw std::runtime_error("inflateInit2 failed");
+    }
+
+    try {
+        for (uint64_t i = 0; i < blocks && text.size() < maxBytes; ++i) {
+            uint64_t rawSize = readVarint(data, pos);
+            uint64_t packedSize = readVarint(data, pos);
+            if (rawSize > kBlockSize || packedSize > data.size() - pos) {
+                throw std::runtime_error("Corrupt document text block");
+            }
+
+            inflateReset(&zs);
+            inflateSetDictionary(&zs, dictionaryBytes(), static_cast<uInt>(kDictionary.size()));
+
+            size_t start = text.size();
+            text.resize(start + rawSize);
+            zs.next_in = reinterpret_cast<Bytef*>(const_cast<std::byte*>(data.data() + pos));
+            zs.avail_in = static_cast<uInt>(packedSize);
+            zs.next_out = reinterpret_cast<Bytef*>(text.data() + start);
+            zs.avail_out = static_cast<uInt>(rawSize);
+
+            if (inflate(&zs, Z_FINISH) != Z_STREAM_END || zs.avail_out != 0) {
+                throw std::runtime_error("Corrupt document text block");
+            }
+            pos += packedSize;
+        }
+    } catch (...) {
+        inflateEnd(&zs);
+        throw;
+    }
+
+    inflateEnd(&zs);
+    return text;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Codec for extracted page text kept in document_texts.
+//
+// Text is cut into independent blocks of kBlockSize bytes, each compressed
+// as raw deflate primed with a built-in dictionary of common words, which
+// pays off on the short texts typical of crawled pages. Readers can stop
+// after the blocks they need. Layout:
+//   [version][varint block count] { [varint raw size][varint packed size][data] }*
+class DocumentStore {
+public:
+    static constexpr size_t kBlockSize = 16 * 1024;
+
+    static std::basic_string<std::byte> compress(std::string_view text);
+
+    // Decodes whole blocks until at least maxBytes of text are produced.
+    // Throws std::runtime_error on corrupt data.
+    static std::string decompress(std::basic_string_view<std::byte> data, size_t maxBytes = SIZE_MAX);
+};
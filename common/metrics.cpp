@@ -0,0 +1,184 @@
+#include "metrics.h"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <stdexcept>
+
+namespace metrics {
+
+size_t shardIndex() {
+    static std::atomic<size_t> next{0};
+    thread_local size_t index = next.fetch_add(1, std::memory_order_relaxed) % kShards;
+    return index;
+}
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+Histogram::Histogram()
+    : shards_(std::make_unique<Shard[]>(kShards))
+{
+}
+
+size_t Histogram::bucketIndex(uint64_t micros) {
+    if (micros < kSubBuckets) {
+        return static_cast<size_t>(micros);
+    }
+    int msb = 63 - std::countl_zero(micros);
+    if (msb >= kMaxBits) {
+        return kBuckets - 1;
+    }
+    int shift = msb - kSubBucketBits;
+    return static_cast<size_t>((shift + 1) * kSubBuckets + ((micros >> shift) & (kSubBuckets - 1)));
+}
+
+uint64_t Histogram::upperBound(size_t bucket) {
+    if (bucket < kSubBuckets) {
+        return bucket + 1;
+    }
+    uint64_t shift = bucket / kSubBuckets - 1;
+    uint64_t sub = bucket % kSubBuckets;
+    return (kSubBuckets + sub + 1) << shift;
+}
+
+void Histogram::record(uint64_t micros) {
+    Shard& shard = shards_[shardIndex()];
+    shard.counts[bucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(micros, std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot snap;
+    snap.counts.assign(kBuckets, 0);
+    for (size_t s = 0; s < kShards; ++s) {
+        const Shard& shard = shards_[s];
+        for (size_t i = 0; i < kBuckets; ++i) {
+            snap.counts[i] += shard.counts[i].load(std::memory_order_relaxed);
+        }
+        snap.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    for (uint64_t c : snap.counts) {
+        snap.count += c;
+    }
+    return snap;
+}
+
+uint64_t Histogram::Snapshot::percentile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    auto rank = static_cast<uint64_t>(std::clamp(q, 0.0, 1.0) * static_cast<double>(count - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return upperBound(i);
+        }
+    }
+    return upperBound(counts.size() - 1);
+}
+
+Registry::Series& Registry::series(const std::string& name, const std::string& help, Type type, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mtx_);
+
+    Family* family = nullptr;
+    for (auto& f : families_) {
+        if (f->name == name) {
+            family = f.get();
+            break;
+        }
+    }
+    if (!family) {
+        families_.push_back(std::make_unique<Family>(Family{name, help, type, {}}));
+        family = families_.back().get();
+    } else if (family->type != type) {
+        throw std::logic_error("Metric " + name + " registered with a different type");
+    }
+
+    for (auto& s : family->series) {
+        if (s->labels == labels) {
+            return *s;
+        }
+    }
+
+    auto created = std::make_unique<Series>();
+    created->labels = labels;
+    switch (type) {
+    case Type::Counter: created->counter = std::make_unique<Counter>(); break;
+    case Type::Gauge: created->gauge = std::make_unique<Gauge>(); break;
+    case Type::Histogram: created->histogram = std::make_unique<Histogram>(); break;
+    }
+    family->series.push_back(std::move(created));
+    return *family->series.back();
+}
+
+Counter& Registry::counter(const std::string& name, const std::string& help, const std::string& labels) {
+    return *series(name, help, Type::Counter, labels).counter;
+}
+
+Gauge& Registry::gauge(const std::string& name, const std::string& help, const std::string& labels) {
+    return *series(name, help, Type::Gauge, labels).gauge;
+}
+
+Histogram& Registry::histogram(const std::string& name, const std::string& help, const std::string& labels) {
+    return *series(name, help, Type::Histogram, labels).histogram;
+}
+
+void Registry::renderPrometheus(std::string& out) const {
+    // Exported bucket bounds in seconds; fine buckets are folded into them
+    static const double kBounds[] = {
+        0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05,
+        0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60,
+    };
+
+    auto number = [](double value) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+        return std::string(buffer);
+    };
+    auto seriesName = [](const std::string& name, const std::string& labels, const std::string& extra = "") {
+        std::string all = labels;
+        if (!extra.empty()) {
+            all += all.empty() ? extra : "," + extra;
+        }
+        return all.empty() ? name : name + "{" + all + "}";
+    };
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (const auto& family : families_) {
+        const char* type = family->type == Type::Counter ? "counter"
+            : family->type == Type::Gauge ? "gauge" : "histogram";
+        out += "# HELP " + family->name + " " + family->help + "\n";
+        out += "# TYPE " + family->name + " " + type + "\n";
+
+        for (const auto& s : family->series) {
+            if (s->counter) {
+                out += seriesName(family->name, s->labels) + " " + std::to_string(s->counter->value()) + "\n";
+            } else if (s->gauge) {
+                out += seriesName(family->name, s->labels) + " " + std::to_string(s->gauge->value()) + "\n";
+            } else {
+                Histogram::Snapshot snap = s->histogram->snapshot();
+                size_t bucket = 0;
+                uint64_t cumulative = 0;
+                for (double bound : kBounds) {
+                    auto limit = static_cast<uint64_t>(bound * 1e6);
+                    while (bucket < snap.counts.size() && Histogram::upperBound(bucket) <= limit) {
+                        cumulative += snap.counts[bucket++];
+                    }
+                    out += seriesName(family->name + "_bucket", s->labels, "le=\"" + number(bound) + "\"") +
+                        " " + std::to_string(cumulative) + "\n";
+                }
+                out += seriesName(family->name + "_bucket", s->labels, "le=\"+Inf\"") + " " + std::to_string(snap.count) + "\n";
+                out += seriesName(family->name + "_sum", s->labels) + " " + number(static_cast<double>(snap.sum) / 1e6) + "\n";
+                out += seriesName(family->name + "_count", s->labels) + " " + std::to_string(snap.count) + "\n";
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Process-wide counters, gauges and latency histograms with Prometheus
+// text exposition. Hot-path updates are relaxed atomic adds on a shard
+// owned by the calling thread, so workers never contend on a cache line;
+// shards are only summed when the metrics are scraped.
+namespace metrics {
+
+constexpr size_t kShards = 16;
+
+// Shard of the calling thread; threads are assigned round-robin
+size_t shardIndex();
+
+class Counter {
+public:
+    void add(uint64_t n = 1) {
+        shards_[shardIndex()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+    uint64_t value() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+    std::array<Shard, kShards> shards_;
+};
+
+class Gauge {
+public:
+    void set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+    void add(int64_t delta) { value_.fetch_add(delta, std::memory_order_relaxed); }
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_{0};
+};
+
+// HDR-style histogram of durations in microseconds: every power of two
+// is split into kSubBuckets linear buckets, so a recorded value is off by
+// at most 1/kSubBuckets (12.5%) at any magnitude, from 1 us to ~12 days.
+class Histogram {
+public:
+    static constexpr int kSubBucketBits = 3;
+    static constexpr uint64_t kSubBuckets = 1 << kSubBucketBits;
+    static constexpr int kMaxBits = 40;
+    static constexpr size_t kBuckets = (kMaxBits - kSubBucketBits + 1) * kSubBuckets;
+
+    Histogram();
+
+    void record(uint64_t micros);
+    void record(std::chrono::steady_clock::duration elapsed) {
+        record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+    }
+
+    struct Snapshot {
+        std::vector<uint64_t> counts;   // per fine bucket
+        uint64_t count = 0;
+        uint64_t sum = 0;               // microseconds
+
+        // Upper bound of the bucket holding the q-th value (q in [0, 1])
+        uint64_t percentile(double q) const;
+    };
+    Snapshot snapshot() const;
+
+    // Exclusive upper bound of a fine bucket, in microseconds
+    static uint64_t upperBound(size_t bucket);
+
+private:
+    static size_t bucketIndex(uint64_t micros);
+
+    struct alignas(64) Shard {
+        std::array<std::atomic<uint64_t>, kBuckets> counts{};
+        std::atomic<uint64_t> sum{0};
+    };
+    std::unique_ptr<Shard[]> shards_;
+};
+
+// Records the time from construction to stop() (or destruction)
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram& histogram)
+        : histogram_(&histogram), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() { stop(); }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    void stop() {
+        if (histogram_) {
+            histogram_->record(std::chrono::steady_clock::now() - start_);
+            histogram_ = nullptr;
+        }
+    }
+
+private:
+    Histogram* histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Owns every metric; lookups by name and labels are meant for startup,
+// keep the returned reference instead of looking it up per event
+class Registry {
+public:
+    // labels are preformatted, e.g. R"(type="fetch")"; empty for none
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+    Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+    Histogram& histogram(const std::string& name, const std::string& help, const std::string& labels = "");
+
+    // Prometheus text format 0.0.4; histograms are exported in seconds
+    void renderPrometheus(std::string& out) const;
+
+    static Registry& getInstance() {
+        static Registry instance;
+        return instance;
+    }
+
+private:
+    enum class Type { Counter, Gauge, Histogram };
+
+    struct Series {
+        std::string labels;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+    };
+
+    struct Family {
+        std::string name;
+        std::string help;
+        Type type;
+        std::vector<std::unique_ptr<Series>> series;
+    };
+
+    Series& series(const std::string& name, const std::string& help, Type type, const std::string& labels);
+
+    mutable std::mutex mtx_;
+    std::vector<std::unique_ptr<Family>> families_;
+};
+
+}
@@ -0,0 +1,161 @@
+#include "posting_block.h"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace {
+
+void appendVarint(std::basic_string<std::byte>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<std::byte>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::byte>(value));
+}
+
+uint64_t readVarint(std::basic_string_view<std::byte> data, size_t& pos) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= data.size()) {
+            throw std::runtime_error("Truncated posting block");
+        }
+        auto byte = static_cast<uint8_t>(data[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+    throw std::runtime_error("Malformed posting block");
+}
+
+// One group: the bit width, then the values LSB first, padded to a byte
+void packGroup(std::basic_string<std::byte>& out, const uint32_t* values, size_t count) {
+    uint32_t all = 0;
+    for (size_t i = 0; i < count; ++i) {
+        all |= values[i];
+    }
+    int width = std::bit_width(all);
+    out.push_back(static_cast<std::byte>(width));
+    if (width == 0) {
+        return;
+    }
+
+    uint64_t buffer = 0;
+    int bits = 0;
+    for (size_t i = 0; i < count; ++i) {
+        buffer |= static_cast<uint64_t>(values[i]) << bits;
+        bits += width;
+        while (bits >= 8) {
+            out.push_back(static_cast<std::byte>(buffer & 0xFF));
+            buffer >>= 8;
+            bits -= 8;
+        }
+    }
+    if (bits > 0) {
+        out.push_back(static_cast<std::byte>(buffer & 0xFF));
+    }
+}
+
+void unpackGroup(std::basic_string_view<std::byte> data, size_t& pos, uint32_t* values, size_t count) {
+    if (pos >= data.size()) {
+        throw std::runtime_error("Truncated posting block");
+    }
+    int width = static_cast<int>(data[pos++]);
+    if (width > 32) {
+        throw std::runtime_error("Malformed posting block");
+    }
+    if (width == 0) {
+        std::fill(values, values + count, 0u);
+        return;
+    }
+    size_t bytes = (count * width + 7) / 8;
+    if (data.size() - pos < bytes) {
+        throw std::runtime_error("Truncated posting block");
+    }
+
+    uint64_t mask = (uint64_t{1} << width) - 1;
+    uint64_t buffer = 0;
+    int bits = 0;
+    for (size_t i = 0; i < count; ++i) {
+        while (bits < width) {
+            buffer |= static_cast<uint64_t>(data[pos++]) << bits;
+            bits += 8;
+        }
+        values[i] = static_cast<uint32_t>(buffer & mask);
+        buffer >>= width;
+        bits -= width;
+    }
+}
+
+}
+
+std::basic_string<std::byte> PostingBlock::encode(const Posting* postings, size_t count) {
+    std::basic_string<std::byte> out;
+    appendVarint(out, count);
+    if (count == 0) {
+        return out;
+    }
+    appendVarint(out, postings[0].documentId);
+
+    // Ids strictly increase, so a gap is at least 1; a frequency too
+    uint32_t group[kGroupSize];
+    for (size_t start = 1; start < count; start += kGroupSize) {
+        size_t n = std::min(kGroupSize, count - start);
+        for (size_t i = 0; i < n; ++i) {
+            group[i] = postings[start + i].documentId - postings[start + i - 1].documentId - 1;
+        }
+        packGroup(out, group, n);
+    }
+    for (size_t start = 0; start < count; start += kGroupSize) {
+        size_t n = std::min(kGroupSize, count - start);
+        for (size_t i = 0; i < n; ++i) {
+            group[i] = std::max<uint32_t>(postings[start + i].frequency, 1) - 1;
+        }
+        packGroup(out, group, n);
+    }
+    return out;
+}
+
+void PostingBlock::decode(std::basic_string_view<std::byte> data, std::vector<Posting>& out) {
+    size_t pos = 0;
+    uint64_t count = readVarint(data, pos);
+    if (count == 0) {
+        return;
+    }
+    if (count > kBlockPostings) {
+        throw std::runtime_error("Malformed posting block");
+    }
+    uint64_t first = readVarint(data, pos);
+
+    size_t base = out.size();
+    out.resize(base + count);
+    Posting* postings = out.data() + base;
+
+    // Corrupt data leaves out as it was
+    try {
+        uint32_t group[kGroupSize];
+        uint64_t id = first;
+        postings[0].documentId = static_cast<uint32_t>(id);
+        for (size_t start = 1; start < count; start += kGroupSize) {
+            size_t n = std::min<size_t>(kGroupSize, count - start);
+            unpackGroup(data, pos, group, n);
+            for (size_t i = 0; i < n; ++i) {
+                id += static_cast<uint64_t>(group[i]) + 1;
+                postings[start + i].documentId = static_cast<uint32_t>(id);
+            }
+        }
+        if (id > UINT32_MAX) {
+            throw std::runtime_error("Malformed posting block");
+        }
+        for (size_t start = 0; start < count; start += kGroupSize) {
+            size_t n = std::min<size_t>(kGroupSize, count - start);
+            unpackGroup(data, pos, group, n);
+            for (size_t i = 0; i < n; ++i) {
+                postings[start + i].frequency = group[i] + 1;
+            }
+        }
+    } catch (...) {
+        out.resize(base);
+        throw;
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// How the index stores term postings ([index] postings):
+//   rows   - word_frequencies, one row per (document, word)
+//   blocks - posting_blocks, the postings of a term packed into blocks
+//            of consecutive document ids, one bytea row per block
+enum class PostingLayout { Rows, Blocks };
+
+struct Posting {
+    uint32_t documentId;
+    uint32_t frequency;
+};
+
+// Codec for one posting_blocks row: up to kBlockPostings postings of one
+// term, by ascending document id. Document ids are stored as the first id
+// and then gaps, frequencies as is; both go in groups of 128 values
+// bit-packed at the width of the group's largest value. Layout:
+//   [varint count][varint first id] { [width][packed gaps - 1] }* { [width][packed frequencies - 1] }*
+class PostingBlock {
+public:
+    static constexpr size_t kBlockPostings = 1024;
+    static constexpr size_t kGroupSize = 128;
+
+    // postings sorted by document id, without duplicates
+    static std::basic_string<std::byte> encode(const Posting* postings, size_t count);
+    static std::basic_string<std::byte> encode(const std::vector<Posting>& postings) {
+        return encode(postings.data(), postings.size());
+    }
+
+    // Appends the postings to out. Throws std::runtime_error on corrupt data.
+    static void decode(std::basic_string_view<std::byte> data, std::vector<Posting>& out);
+};
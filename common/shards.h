@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Document-partitioned index: every shard is a database of its own. The
+// spider places a page by its URL hash and hands out document ids so that
+// id % count is the shard, which keeps ids unique across the cluster and
+// lets the server find a document's shard from its id alone.
+namespace shards {
+
+// [shards] databases: comma separated "name" or "host:port/name" entries,
+// each applied on top of the base connection string (later libpq
+// keywords override earlier ones)
+inline std::vector<std::string> connectionStrings(const std::string& base, const std::string& list) {
+    std::vector<std::string> result;
+    size_t start = 0;
+    while (start < list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) end = list.size();
+        std::string item = list.substr(start, end - start);
+        start = end + 1;
+
+        item.erase(0, item.find_first_not_of(" \t"));
+        item.erase(item.find_last_not_of(" \t") + 1);
+        if (item.empty()) {
+            continue;
+        }
+
+        std::string connection = base;
+        size_t slash = item.find('/');
+        if (slash != std::string::npos) {
+            std::string address = item.substr(0, slash);
+            size_t colon = address.rfind(':');
+            connection += " host=" + address.substr(0, colon);
+            if (colon != std::string::npos) {
+                connection += " port=" + address.substr(colon + 1);
+            }
+            item.erase(0, slash + 1);
+        }
+        connection += " dbname=" + item;
+        result.push_back(std::move(connection));
+    }
+    return result;
+}
+
+inline size_t shardOfDocument(long long documentId, size_t count) {
+    return count > 1 ? static_cast<size_t>(documentId % static_cast<long long>(count)) : 0;
+}
+
+inline size_t shardOfUrl(std::string_view url, size_t count) {
+    if (count <= 1) {
+        return 0;
+    }
+    // FNV-1a; every spider must place a URL the same way
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : url) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    hash ^= hash >> 33;
+    return static_cast<size_t>(hash % count);
+}
+
+}
@@ -0,0 +1,367 @@
+﻿#include "stemmer.h"
+#include "utf8.h"
+#include <string_view>
+
+namespace {
+
+// ---------------------------------------------------------------- English
+
+struct Rule {
+    std::string_view suffix;
+    std::string_view replacement;
+};
+
+bool isVowel(char c) {
+    return c == 'a' || c == 'e' || c == 'i' || c == 'o' || c == 'u' || c == 'y';
+}
+
+bool endsWith(const std::string& word, std::string_view suffix) {
+    return word.size() >= suffix.size() &&
+        std::string_view(word).substr(word.size() - suffix.size()) == suffix;
+}
+
+bool hasVowel(const std::string& word, size_t end) {
+    for (size_t i = 0; i < end; ++i) {
+        if (isVowel(word[i])) return true;
+    }
+    return false;
+}
+
+// Region after the first non-vowel that follows a vowel, starting at from
+size_t regionAfter(const std::string& word, size_t from) {
+    for (size_t i = from + 1; i < word.size(); ++i) {
+        if (!isVowel(word[i]) && isVowel(word[i - 1])) return i + 1;
+    }
+    return word.size();
+}
+
+// Short syllable ending at the end of word[0, end)
+bool endsWithShortSyllable(const std::string& word, size_t end) {
+    if (end == 2) {
+        return isVowel(word[0]) && !isVowel(word[1]);
+    }
+    if (end >= 3) {
+        char last = word[end - 1];
+        return !isVowel(word[end - 3]) && isVowel(word[end - 2]) && !isVowel(last) &&
+            last != 'w' && last != 'x' && last != 'Y';
+    }
+    return false;
+}
+
+// Longest rule whose suffix ends the word, or nullptr
+template <size_t N>
+const Rule* longestRule(const std::string& word, const Rule (&rules)[N]) {
+    const Rule* best = nullptr;
+    for (const Rule& rule : rules) {
+        if ((!best || rule.suffix.size() > best->suffix.size()) && endsWith(word, rule.suffix)) {
+            best = &rule;
+        }
+    }
+    return best;
+}
+
+void replaceSuffix(std::string& word, const Rule& rule) {
+    word.resize(word.size() - rule.suffix.size());
+    word.append(rule.replacement);
+}
+
+const Rule kExceptions[] = {
+    {"skis", "ski"}, {"skies", "sky"}, {"dying", "die"}, {"lying", "lie"}, {"tying", "tie"},
+    {"idly", "idl"}, {"gently", "gentl"}, {"ugly", "ugli"}, {"early", "earli"}, {"only", "onli"},
+    {"singly", "singl"}, {"sky", "sky"}, {"news", "news"}, {"howe", "howe"}, {"atlas", "atlas"},
+    {"cosmos", "cosmos"}, {"bias", "bias"}, {"andes", "andes"},
+};
+
+const std::string_view kInvariantAfterStep1a[] = {
+    "inning", "outing", "canning", "herring", "earring", "proceed", "exceed", "succeed",
+};
+
+const Rule kStep2[] = {
+    {"tional", "tion"}, {"enci", "ence"}, {"anci", "ance"}, {"abli", "able"}, {"entli", "ent"},
+    {"izer", "ize"}, {"ization", "ize"}, {"ational", "ate"}, {"ation", "ate"}, {"ator", "ate"},
+    {"alism", "al"}, {"aliti", "al"}, {"alli", "al"}, {"fulness", "ful"}, {"ousli", "ous"},
+    {"ousness", "ous"}, {"iveness", "ive"}, {"iviti", "ive"}, {"biliti", "ble"}, {"bli", "ble"},
+    {"ogi", "og"}, {"fulli", "ful"}, {"lessli", "less"}, {"li", ""},
+};
+
+const Rule kStep3[] = {
+    {"tional", "tion"}, {"ational", "ate"}, {"alize", "al"}, {"icate", "ic"}, {"iciti", "ic"},
+    {"ical", "ic"}, {"ful", ""}, {"ness", ""}, {"ative", ""},
+};
+
+const Rule kStep4[] = {
+    {"al", ""}, {"ance", ""}, {"ence", ""}, {"er", ""}, {"ic", ""}, {"able", ""}, {"ible", ""},
+    {"ant", ""}, {"ement", ""}, {"ment", ""}, {"ent", ""}, {"ism", ""}, {"ate", ""}, {"iti", ""},
+    {"ous", ""}, {"ive", ""}, {"ize", ""}, {"ion", ""},
+};
+
+bool isValidLiEnding(char c) {
+    return c == 'c' || c == 'd' || c == 'e' || c == 'g' || c == 'h' ||
+        c == 'k' || c == 'm' || c == 'n' || c == 'r' || c == 't';
+}
+
+void step1a(std::string& word) {
+    size_t n = word.size();
+    if (endsWith(word, "sses")) {
+        word.resize(n - 2);
+    } else if (endsWith(word, "ied") || endsWith(word, "ies")) {
+        word.resize(n > 4 ? n - 2 : n - 1);
+    } else if (endsWith(word, "us") || endsWith(word, "ss")) {
+        return;
+    } else if (endsWith(word, "s") && hasVowel(word, n - 2)) {
+        word.resize(n - 1);
+    }
+}
+
+void step1b(std::string& word, size_t r1) {
+    static const Rule rules[] = {
+        {"eed", "ee"}, {"eedly", "ee"}, {"ed", ""}, {"edly", ""}, {"ing", ""}, {"ingly", ""},
+    };
+    const Rule* rule = longestRule(word, rules);
+    if (!rule) return;
+
+    size_t stem = word.size() - rule->suffix.size();
+    if (rule->suffix[0] == 'e' && rule->suffix[1] == 'e') {
+        if (stem >= r1) replaceSuffix(word, *rule);
+        return;
+    }
+    if (!hasVowel(word, stem)) return;
+
+    word.resize(stem);
+    if (endsWith(word, "at") || endsWith(word, "bl") || endsWith(word, "iz")) {
+        word.push_back('e');
+    } else if (word.size() >= 2 && word.back() == word[word.size() - 2] &&
+        std::string_view("bdfgmnprt").find(word.back()) != std::string_view::npos) {
+        word.pop_back();
+    } else if (r1 >= word.size() && endsWithShortSyllable(word, word.size())) {
+        word.push_back('e');
+    }
+}
+
+void step1c(std::string& word) {
+    size_t n = word.size();
+    if (n > 2 && (word[n - 1] == 'y' || word[n - 1] == 'Y') && !isVowel(word[n - 2])) {
+        word[n - 1] = 'i';
+    }
+}
+
+void step2(std::string& word, size_t r1) {
+    const Rule* rule = longestRule(word, kStep2);
+    if (!rule) return;
+
+    size_t stem = word.size() - rule->suffix.size();
+    if (stem < r1) return;
+    if (rule->suffix == "ogi" && (stem == 0 || word[stem - 1] != 'l')) return;
+    if (rule->suffix == "li" && (stem == 0 || !isValidLiEnding(word[stem - 1]))) return;
+    replaceSuffix(word, *rule);
+}
+
+void step3(std::string& word, size_t r1, size_t r2) {
+    const Rule* rule = longestRule(word, kStep3);
+    if (!rule) return;
+
+    size_t stem = word.size() - rule->suffix.size();
+    if (stem < r1) return;
+    if (rule->suffix == "ative" && stem < r2) return;
+    replaceSuffix(word, *rule);
+}
+
+void step4(std::string& word, size_t r2) {
+    const Rule* rule = longestRule(word, kStep4);
+    if (!rule) return;
+
+    size_t stem = word.size() - rule->suffix.size();
+    if (stem < r2) return;
+    if (rule->suffix == "ion" && (stem == 0 || (word[stem - 1] != 's' && word[stem - 1] != 't'))) return;
+    replaceSuffix(word, *rule);
+}
+
+void step5(std::string& word, size_t r1, size_t r2) {
+    size_t n = word.size();
+    if (n == 0) return;
+    if (word[n - 1] == 'e') {
+        if (n - 1 >= r2 || (n - 1 >= r1 && !endsWithShortSyllable(word, n - 1))) {
+            word.pop_back();
+        }
+    } else if (word[n - 1] == 'l') {
+        if (n - 1 >= r2 && n >= 2 && word[n - 2] == 'l') {
+            word.pop_back();
+        }
+    }
+}
+
+// ---------------------------------------------------------------- Russian
+
+using Word = std::u32string;
+
+bool isRussianVowel(char32_t c) {
+    return c == U'а' || c == U'е' || c == U'и' || c == U'о' || c == U'у' ||
+        c == U'ы' || c == U'э' || c == U'ю' || c == U'я';
+}
+
+const std::u32string_view kPerfectiveGerund1[] = {U"в", U"вши", U"вшись"};
+const std::u32string_view kPerfectiveGerund2[] = {U"ив", U"ивши", U"ившись", U"ыв", U"ывши", U"ывшись"};
+const std::u32string_view kReflexive[] = {U"ся", U"сь"};
+const std::u32string_view kAdjective[] = {
+    U"ее", U"ие", U"ые", U"ое", U"ими", U"ыми", U"ей", U"ий", U"ый", U"ой", U"ем", U"им", U"ым",
+    U"ом", U"его", U"ого", U"ему", U"ому", U"их", U"ых", U"ую", U"юю", U"ая", U"яя", U"ою", U"ею",
+};
+const std::u32string_view kParticiple1[] = {U"ем", U"нн", U"вш", U"ющ", U"щ"};
+const std::u32string_view kParticiple2[] = {U"ивш", U"ывш", U"ующ"};
+const std::u32string_view kVerb1[] = {
+    U"ла", U"на", U"ете", U"йте", U"ли", U"й", U"л", U"ем", U"н", U"ло", U"но", U"ет", U"ют",
+    U"ны", U"ть", U"ешь", U"нно",
+};
+const std::u32string_view kVerb2[] = {
+    U"ила", U"ыла", U"ена", U"ейте", U"уйте", U"ите", U"или", U"ыли", U"ей", U"уй", U"ил", U"ыл",
+    U"им", U"ым", U"ен", U"ило", U"ыло", U"ено", U"ят", U"ует", U"уют", U"ит", U"ыт", U"ены",
+    U"ить", U"ыть", U"ишь", U"ую", U"ю",
+};
+const std::u32string_view kNoun[] = {
+    U"а", U"ев", U"ов", U"ие", U"ье", U"е", U"иями", U"ями", U"ами", U"еи", U"ии", U"и", U"ией",
+    U"ей", U"ой", U"ий", U"й", U"иям", U"ям", U"ием", U"ем", U"ам", U"ом", U"о", U"у", U"ах",
+    U"иях", U"ях", U"ы", U"ь", U"ию", U"ью", U"ю", U"ия", U"ья", U"я",
+};
+const std::u32string_view kSuperlative[] = {U"ейш", U"ейше"};
+const std::u32string_view kDerivational[] = {U"ост", U"ость"};
+
+// Length of the longest listed ending that lies within [limit, end), or 0
+template <size_t N>
+size_t longestEnding(const Word& word, size_t limit, const std::u32string_view (&endings)[N]) {
+    size_t best = 0;
+    for (std::u32string_view ending : endings) {
+        if (ending.size() > best && word.size() >= limit + ending.size() &&
+            std::u32string_view(word).substr(word.size() - ending.size()) == ending) {
+            best = ending.size();
+        }
+    }
+    return best;
+}
+
+// Endings of the first group only count after а or я (which stays in the word)
+template <size_t N1, size_t N2>
+size_t groupedEnding(const Word& word, size_t limit,
+    const std::u32string_view (&group1)[N1], const std::u32string_view (&group2)[N2]) {
+    size_t first = longestEnding(word, limit, group1);
+    size_t second = longestEnding(word, limit, group2);
+    if (second >= first) {
+        return second;
+    }
+    size_t before = word.size() - first;
+    if (before > limit && (word[before - 1] == U'а' || word[before - 1] == U'я')) {
+        return first;
+    }
+    return 0;
+}
+
+void removeEnding(Word& word, size_t length) {
+    word.resize(word.size() - length);
+}
+
+}
+
+void stemEnglish(std::string& word) {
+    if (word.size() <= 2) return;
+
+    for (const Rule& exception : kExceptions) {
+        if (word == exception.suffix) {
+            word = exception.replacement;
+            return;
+        }
+    }
+
+    // y acting as a consonant is marked as Y while the steps run
+    if (word[0] == 'y') word[0] = 'Y';
+    for (size_t i = 1; i < word.size(); ++i) {
+        if (word[i] == 'y' && isVowel(word[i - 1])) word[i] = 'Y';
+    }
+
+    size_t r1;
+    if (word.rfind("gener", 0) == 0 || word.rfind("arsen", 0) == 0) {
+        r1 = 5;
+    } else if (word.rfind("commun", 0) == 0) {
+        r1 = 6;
+    } else {
+        r1 = regionAfter(word, 0);
+    }
+    size_t r2 = regionAfter(word, r1);
+
+    step1a(word);
+    for (std::string_view invariant : kInvariantAfterStep1a) {
+        if (word == invariant) return;
+    }
+    step1b(word, r1);
+    step1c(word);
+    step2(word, r1);
+    step3(word, r1, r2);
+    step4(word, r2);
+    step5(word, r1, r2);
+
+    for (char& c : word) {
+        if (c == 'Y') c = 'y';
+    }
+}
+
+void stemRussian(std::string& text) {
+    Word word = utf8::toUtf32(text);
+
+    size_t rv = word.size();
+    for (size_t i = 0; i < word.size(); ++i) {
+        if (isRussianVowel(word[i])) {
+            rv = i + 1;
+            break;
+        }
+    }
+    size_t r1 = word.size();
+    for (size_t i = 1; i < word.size(); ++i) {
+        if (!isRussianVowel(word[i]) && isRussianVowel(word[i - 1])) {
+            r1 = i + 1;
+            break;
+        }
+    }
+    size_t r2 = word.size();
+    for (size_t i = r1 + 1; i < word.size(); ++i) {
+        if (!isRussianVowel(word[i]) && isRussianVowel(word[i - 1])) {
+            r2 = i + 1;
+            break;
+        }
+    }
+
+    // Step 1: perfective gerund, or reflexive followed by adjectival, verb or noun
+    if (size_t n = groupedEnding(word, rv, kPerfectiveGerund1, kPerfectiveGerund2)) {
+        removeEnding(word, n);
+    } else {
+        removeEnding(word, longestEnding(word, rv, kReflexive));
+        if (size_t adjective = longestEnding(word, rv, kAdjective)) {
+            removeEnding(word, adjective);
+            removeEnding(word, groupedEnding(word, rv, kParticiple1, kParticiple2));
+        } else if (size_t verb = groupedEnding(word, rv, kVerb1, kVerb2)) {
+            removeEnding(word, verb);
+        } else {
+            removeEnding(word, longestEnding(word, rv, kNoun));
+        }
+    }
+
+    // Step 2
+    if (word.size() > rv && word.back() == U'и') {
+        word.pop_back();
+    }
+
+    // Step 3: derivational ending inside R2
+    removeEnding(word, longestEnding(word, r2, kDerivational));
+
+    // Step 4: superlative, double н, soft sign
+    auto endsWithDoubleN = [&]() {
+        return word.size() >= rv + 2 && word[word.size() - 1] == U'н' && word[word.size() - 2] == U'н';
+    };
+    if (size_t n = longestEnding(word, rv, kSuperlative)) {
+        removeEnding(word, n);
+        if (endsWithDoubleN()) word.pop_back();
+    } else if (endsWithDoubleN()) {
+        word.pop_back();
+    } else if (word.size() > rv && word.back() == U'ь') {
+        word.pop_back();
+    }
+
+    text = utf8::fromUtf32(word);
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include <string>
+
+// Snowball stemmers working in place on case-folded UTF-8 words.
+// stemEnglish is Porter2 for lowercase ASCII words, stemRussian follows the
+// Snowball Russian algorithm (expects ё already folded to е).
+void stemEnglish(std::string& word);
+void stemRussian(std::string& word);
@@ -0,0 +1,103 @@
+#include "tokenizer.h"
+#include "stemmer.h"
+
+namespace {
+
+constexpr std::array<char16_t, 0x500> buildFoldTable() {
+    std::array<char16_t, 0x500> table{};
+
+    // ASCII: digits and letters only
+    for (char16_t c = '0'; c <= '9'; ++c) table[c] = c;
+    for (char16_t c = 'a'; c <= 'z'; ++c) table[c] = c;
+    for (char16_t c = 'A'; c <= 'Z'; ++c) table[c] = c + 0x20;
+
+    // Latin-1 letters; U+0080..U+00BF are controls and punctuation
+    for (char16_t c = 0xC0; c <= 0xDE; ++c) table[c] = c + 0x20;
+    for (char16_t c = 0xDF; c <= 0xFF; ++c) table[c] = c;
+    table[0xD7] = 0;    // multiplication sign
+    table[0xF7] = 0;    // division sign
+
+    // Latin Extended-A: mostly upper/lower pairs, with the parity flipping
+    // around U+0139..U+0148 and U+0179..U+017E
+    for (char16_t c = 0x100; c <= 0x17F; ++c) table[c] = c;
+    for (char16_t c = 0x100; c <= 0x137; c += 2) table[c] = c + 1;
+    for (char16_t c = 0x139; c <= 0x148; c += 2) table[c] = c + 1;
+    for (char16_t c = 0x14A; c <= 0x177; c += 2) table[c] = c + 1;
+    for (char16_t c = 0x179; c <= 0x17E; c += 2) table[c] = c + 1;
+    table[0x130] = 'i';     // dotted capital I
+    table[0x178] = 0xFF;    // Y with diaeresis
+    table[0x17F] = 's';     // long s
+
+    // Latin Extended-B, IPA, combining marks and Greek are kept unfolded;
+    // spacing modifier letters (U+02B0..U+02FF) separate words
+    for (char16_t c = 0x180; c <= 0x2AF; ++c) table[c] = c;
+    for (char16_t c = 0x300; c <= 0x3FF; ++c) table[c] = c;
+    table[0x37E] = 0;       // Greek question mark
+    table[0x387] = 0;       // Greek ano teleia
+
+    // Cyrillic
+    for (char16_t c = 0x400; c <= 0x4FF; ++c) table[c] = c;
+    for (char16_t c = 0x400; c <= 0x40F; ++c) table[c] = c + 0x50;
+    for (char16_t c = 0x410; c <= 0x42F; ++c) table[c] = c + 0x20;
+    for (char16_t c = 0x460; c <= 0x481; c += 2) table[c] = c + 1;
+    for (char16_t c = 0x48A; c <= 0x4BF; c += 2) table[c] = c + 1;
+    for (char16_t c = 0x4C1; c <= 0x4CE; c += 2) table[c] = c + 1;
+    for (char16_t c = 0x4D0; c <= 0x4FF; c += 2) table[c] = c + 1;
+    table[0x482] = 0;       // thousands sign
+    table[0x4C0] = 0x4CF;   // palochka
+    table[0x401] = 0x435;   // Ё -> е
+    table[0x451] = 0x435;   // ё -> е
+
+    return table;
+}
+
+}
+
+const std::array<char16_t, Tokenizer::kFoldTableSize> Tokenizer::kFoldTable = buildFoldTable();
+
+bool Tokenizer::isSeparatorAbove(char32_t cp) {
+    return (cp >= 0x2000 && cp <= 0x2BFF)       // punctuation, symbols, arrows, shapes
+        || (cp >= 0x2E00 && cp <= 0x2E7F)       // supplemental punctuation
+        || (cp >= 0x3000 && cp <= 0x303F)       // CJK punctuation
+        || (cp >= 0xFE10 && cp <= 0xFE6F)       // vertical and small forms
+        || (cp >= 0xFF00 && cp <= 0xFF0F)       // fullwidth punctuation
+        || (cp >= 0xFF1A && cp <= 0xFF20)
+        || (cp >= 0xFF3B && cp <= 0xFF40)
+        || (cp >= 0xFF5B && cp <= 0xFF65)
+        || cp == 0xFEFF                         // byte order mark
+        || (cp >= 0xFFF0 && cp <= 0xFFFF)       // specials
+        || (cp >= 0x1F000 && cp <= 0x1FAFF);    // emoji and pictographs
+}
+
+std::string Tokenizer::foldCase(std::string_view text) {
+    std::string out;
+    out.reserve(text.size());
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(text.data());
+    const unsigned char* end = p + text.size();
+    while (p < end) {
+        char32_t cp = utf8::decode(p, end);
+        if (cp == utf8::kInvalid) continue;
+        char32_t folded = fold(cp);
+        utf8::append(out, folded ? folded : cp);
+    }
+    return out;
+}
+
+void Tokenizer::stem(std::string& word) const {
+    // Pure ASCII words go to the English stemmer, words with Cyrillic
+    // letters to the Russian one; anything else is left alone
+    bool ascii = true;
+    bool cyrillic = false;
+    for (unsigned char c : word) {
+        if (c >= 0x80) {
+            ascii = false;
+            if (c == 0xD0 || c == 0xD1) cyrillic = true;
+        }
+    }
+
+    if (ascii) {
+        stemEnglish(word);
+    } else if (cyrillic) {
+        stemRussian(word);
+    }
+}
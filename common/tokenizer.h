@@ -0,0 +1,121 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "utf8.h"
+
+// Word splitter shared by the spider (indexing) and the server (queries),
+// so both sides always agree on what a term is.
+//
+// Text is decoded as UTF-8; letters and digits form words, everything
+// else separates them. Latin and Cyrillic letters are case folded via a
+// precomputed table (ё is folded to е), other scripts are kept as is.
+// Stemming (English Porter2 / Russian Snowball) is optional.
+class Tokenizer {
+public:
+    struct Options {
+        bool stemming = false;
+        size_t minLength = 3;   // in code points
+        size_t maxLength = 32;
+    };
+
+    Tokenizer() = default;
+    explicit Tokenizer(Options options) : options_(options) {}
+
+    // Calls emit(std::string_view term, uint32_t position) for every
+    // indexable term. Positions count all tokens, including ones too short
+    // or too long to be indexed, so phrase gaps are preserved.
+    template <class Emit>
+    void tokenize(std::string_view text, Emit&& emit) const {
+        tokenizeSpans(text, [&](std::string_view term, uint32_t position, size_t, size_t) {
+            emit(term, position);
+        });
+    }
+
+    // Same, but emit also gets the [begin, end) byte range of the word in text
+    template <class Emit>
+    void tokenizeSpans(std::string_view text, Emit&& emit) const;
+
+    // Case folding only, for prefixes and other partial input
+    static std::string foldCase(std::string_view text);
+
+    // Folded code point, or 0 for separators
+    static char32_t fold(char32_t cp) {
+        if (cp < kFoldTableSize) return kFoldTable[cp];
+        return isSeparatorAbove(cp) ? 0 : cp;
+    }
+
+    const Options& options() const { return options_; }
+
+    static void configure(Options options) { instance() = Tokenizer(options); }
+    static const Tokenizer& getInstance() { return instance(); }
+
+private:
+    static constexpr size_t kFoldTableSize = 0x500;
+    static const std::array<char16_t, kFoldTableSize> kFoldTable;
+
+    static bool isSeparatorAbove(char32_t cp);
+    void stem(std::string& word) const;
+
+    static Tokenizer& instance() {
+        static Tokenizer tokenizer;
+        return tokenizer;
+    }
+
+    Options options_;
+};
+
+template <class Emit>
+void Tokenizer::tokenizeSpans(std::string_view text, Emit&& emit) const {
+    std::string word;
+    word.reserve(64);
+    size_t length = 0;
+    uint32_t position = 0;
+
+    const unsigned char* begin = reinterpret_cast<const unsigned char*>(text.data());
+    const unsigned char* wordBegin = begin;
+    const unsigned char* wordEnd = begin;
+
+    auto flush = [&]() {
+        if (length >= options_.minLength && length <= options_.maxLength) {
+            if (options_.stemming) stem(word);
+            emit(std::string_view(word), position,
+                static_cast<size_t>(wordBegin - begin), static_cast<size_t>(wordEnd - begin));
+        }
+        ++position;
+        word.clear();
+        length = 0;
+    };
+
+    const unsigned char* p = begin;
+    const unsigned char* end = p + text.size();
+    while (p < end) {
+        const unsigned char* start = p;
+        char32_t folded;
+        if (*p < 0x80) {
+            folded = kFoldTable[*p++];
+            if (folded) {
+                if (length == 0) wordBegin = start;
+                word.push_back(static_cast<char>(folded));
+                wordEnd = p;
+                ++length;
+                continue;
+            }
+        } else {
+            char32_t cp = utf8::decode(p, end);
+            folded = cp == utf8::kInvalid ? 0 : fold(cp);
+            if (folded) {
+                if (length == 0) wordBegin = start;
+                utf8::append(word, folded);
+                wordEnd = p;
+                ++length;
+                continue;
+            }
+        }
+
+        if (length > 0) flush();
+    }
+
+    if (length > 0) flush();
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+namespace utf8 {
+
+constexpr char32_t kInvalid = 0xFFFFFFFF;
+
+// Decodes one code point starting at p and advances p past it. Malformed,
+// overlong or truncated sequences consume a single byte and yield kInvalid.
+inline char32_t decode(const unsigned char*& p, const unsigned char* end) {
+    unsigned char c = *p;
+    if (c < 0x80) {
+        ++p;
+        return c;
+    }
+
+    size_t length;
+    char32_t cp;
+    char32_t minimum;
+    if ((c & 0xE0) == 0xC0) {
+        length = 2; cp = c & 0x1F; minimum = 0x80;
+    } else if ((c & 0xF0) == 0xE0) {
+        length = 3; cp = c & 0x0F; minimum = 0x800;
+    } else if ((c & 0xF8) == 0xF0) {
+        length = 4; cp = c & 0x07; minimum = 0x10000;
+    } else {
+        ++p;
+        return kInvalid;
+    }
+
+    if (static_cast<size_t>(end - p) < length) {
+        ++p;
+        return kInvalid;
+    }
+    for (size_t i = 1; i < length; ++i) {
+        unsigned char next = p[i];
+        if ((next & 0xC0) != 0x80) {
+            ++p;
+            return kInvalid;
+        }
+        cp = (cp << 6) | (next & 0x3F);
+    }
+    if (cp < minimum || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+        ++p;
+        return kInvalid;
+    }
+
+    p += length;
+    return cp;
+}
+
+inline void append(std::string& out, char32_t cp) {
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+inline std::u32string toUtf32(const std::string& text) {
+    std::u32string out;
+    out.reserve(text.size());
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(text.data());
+    const unsigned char* end = p + text.size();
+    while (p < end) {
+        char32_t cp = decode(p, end);
+        if (cp != kInvalid) out.push_back(cp);
+    }
+    return out;
+}
+
+inline std::string fromUtf32(const std::u32string& text) {
+    std::string out;
+    out.reserve(text.size() * 2);
+    for (char32_t cp : text) {
+        append(out, cp);
+    }
+    return out;
+}
+
+}
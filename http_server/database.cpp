@@ -1,89 +1,593 @@
 #include "database.h"
+#include "config.h"
+#include "positional.h"
 #include <sstream>
 #include <iostream>
-#include <cctype>
+#include <algorithm>
+#include <cstdio>
+#include <chrono>
+#include <map>
+#include <unordered_map>
 
 SearchDatabase::SearchDatabase(const std::string& connection_string) {
     try {
         conn_ = std::make_unique<pqxx::connection>(connection_string);
         std::cout << "✅ Database connected: " << conn_->dbname() << std::endl;
+        if (Config::getInstance().getString("index", "postings", "rows") == "blocks") {
+            postingLayout_ = PostingLayout::Blocks;
+        }
     } catch (const std::exception& e) {
         std::cerr << "❌ Database connection error: " << e.what() << std::endl;
         throw;
     }
 }
 
-std::vector<SearchResult> SearchDatabase::search(const std::string& query) {
-    std::vector<SearchResult> results;
+namespace {
+    // Guards against hand-edited tokens; not a security measure
+    uint8_t cursorChecksum(uint64_t score, uint32_t documentId) {
+        uint64_t h = score * 0x9E3779B97F4A7C15ull ^ documentId;
+        h ^= h >> 29;
+        return static_cast<uint8_t>(h ^ (h >> 8) ^ (h >> 16));
+    }
+}
 
-    try {
-        // Split query into words
-        std::vector<std::string> words;
-        std::string word;
-        for (unsigned char c : query) {
-            if (std::isalnum(c)) {
-                word += static_cast<char>(std::tolower(c));
-            } else if (!word.empty()) {
-                if (word.length() >= 3 && word.length() <= 32) {
-                    words.push_back(word);
-                }
-                word.clear();
+std::string SearchCursor::encode() const {
+    uint64_t s = static_cast<uint64_t>(score);
+    uint32_t id = static_cast<uint32_t>(documentId);
+    char buf[40];
+    std::snprintf(buf, sizeof(buf), "%016llx%08x%02x",
+        static_cast<unsigned long long>(s), id, cursorChecksum(s, id));
+    return buf;
+}
+
+bool SearchCursor::decode(const std::string& token, SearchCursor& cursor) {
+    if (token.size() != 26 ||
+        token.find_first_not_of("0123456789abcdef") != std::string::npos) {
+        return false;
+    }
+
+    uint64_t s = std::stoull(token.substr(0, 16), nullptr, 16);
+    uint32_t id = static_cast<uint32_t>(std::stoul(token.substr(16, 8), nullptr, 16));
+    unsigned check = static_cast<unsigned>(std::stoul(token.substr(24, 2), nullptr, 16));
+    if (check != cursorChecksum(s, id)) {
+        return false;
+    }
+
+    cursor.score = static_cast<long long>(s);
+    cursor.documentId = static_cast<int>(id);
+    return true;
+}
+
+std::string SearchDatabase::connectionString() {
+    Config& config = Config::getInstance();
+    return "host=" + config.getString("database", "host") +
+        " port=" + std::to_string(config.getInt("database", "port")) +
+        " dbname=" + config.getString("database", "name") +
+        " user=" + config.getString("database", "username") +
+        " password=" + config.getString("database", "password");
+}
+
+namespace {
+    void collectTerms(const QueryNode& node, std::vector<std::string>& terms) {
+        if (node.kind == QueryNode::Kind::Term) {
+            if (std::find(terms.begin(), terms.end(), node.term) == terms.end()) {
+                terms.push_back(node.term);
             }
+            return;
         }
-        if (!word.empty() && word.length() >= 3 && word.length() <= 32) {
-            words.push_back(word);
+        for (const auto& child : node.children) {
+            collectTerms(child, terms);
         }
+    }
 
-        if (words.empty()) {
-            return results;
+    std::string integerArray(const std::vector<uint32_t>& values) {
+        std::string text = "{";
+        for (size_t i = 0; i < values.size(); ++i) {
+            if (i > 0) text += ',';
+            text += std::to_string(values[i]);
         }
+        return text + '}';
+    }
 
-        if (words.size() > 4) {
-            words.resize(4);
+    // Static part of the score: the spider's PageRank, which averages 1.0
+    // (and counts as 1.0 until the job has ranked a page). Logarithmic, so
+    // a hub page cannot outrank documents that actually match the query.
+    // Empty when rank_weight is 0.
+    std::string rankBonusSql() {
+        int rankWeight = Config::getInstance().getInt("server", "rank_weight", 10);
+        if (rankWeight <= 0) {
+            return {};
         }
+        return " + ROUND(" + std::to_string(rankWeight) + " * LN(1 + COALESCE(d.page_rank, 1)))::bigint";
+    }
 
-        std::stringstream sql;
-        sql << "SELECT d.url, d.title, SUM(wf.frequency) as relevance "
-            << "FROM documents d "
-            << "JOIN word_frequencies wf ON d.id = wf.document_id "
-            << "JOIN words w ON wf.word_id = w.id "
-            << "WHERE w.word IN (";
+    // The server cancels whatever statement is running when the budget is spent
+    void applyDeadline(pqxx::transaction_base& txn, std::chrono::steady_clock::time_point deadline) {
+        if (deadline == std::chrono::steady_clock::time_point::max()) {
+            return;
+        }
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) {
+            throw SearchTimeout("Search deadline exceeded");
+        }
+        txn.exec("SET LOCAL statement_timeout = " + std::to_string(left.count()));
+    }
 
-        for (size_t i = 0; i < words.size(); ++i) {
-            if (i > 0) sql << ", ";
-            sql << "$" << i + 1;
+    std::vector<SearchResult> readResults(const pqxx::result& r) {
+        std::vector<SearchResult> results;
+        results.reserve(r.size());
+        for (const auto& row : r) {
+            SearchResult result;
+            result.documentId = row["id"].as<int>();
+            result.url = row["url"].c_str();
+            result.title = row["title"].c_str();
+            result.relevance = row["relevance"].as<int>();
+            results.push_back(result);
         }
+        return results;
+    }
 
-        sql << ") "
-            << "GROUP BY d.url, d.title "
-            << "HAVING COUNT(DISTINCT w.word) = " << words.size() << " "
-            << "ORDER BY relevance DESC "
-            << "LIMIT 10";
+    // Posting blocks of one query. A term's block starts come from the
+    // primary key alone; blocks are fetched only when the plan needs them
+    // (all of them for a driving term, else those that can hold one of
+    // the candidates) and stay decoded for the rest of the query.
+    class BlockPostings : public PostingSource {
+    public:
+        explicit BlockPostings(pqxx::work& txn) : txn_(txn) {}
 
-        pqxx::work txn(*conn_);
+        std::vector<Posting> load(int wordId, const std::vector<uint32_t>* documents) override {
+            Term& term = terms_[wordId];
+            if (!documents) {
+                if (!term.complete) {
+                    fetch(term, txn_.exec_params(
+                        "SELECT first_document, data FROM posting_blocks WHERE word_id = $1", wordId));
+                    term.complete = true;
+                }
+            } else if (!term.complete) {
+                if (!term.listed) {
+                    pqxx::result r = txn_.exec_params(
+                        "SELECT first_document FROM posting_blocks WHERE word_id = $1 ORDER BY first_document",
+                        wordId);
+                    for (const auto& row : r) {
+                        term.firsts.push_back(static_cast<uint32_t>(row[0].as<int>()));
+                    }
+                    term.listed = true;
+                }
 
-        pqxx::params params;
-        for (const auto& w : words) {
-            params.append(w);
+                // The block of a document is the last one starting at or before it
+                std::vector<uint32_t> wanted;
+                auto block = term.firsts.begin();
+                for (uint32_t documentId : *documents) {
+                    while (block != term.firsts.end() && *block <= documentId) ++block;
+                    if (block == term.firsts.begin()) {
+                        continue;
+                    }
+                    uint32_t first = *(block - 1);
+                    if (!term.blocks.count(first) && (wanted.empty() || wanted.back() != first)) {
+                        wanted.push_back(first);
+                    }
+                }
+                if (!wanted.empty()) {
+                    fetch(term, txn_.exec_params(
+                        "SELECT first_document, data FROM posting_blocks "
+                        "WHERE word_id = $1 AND first_document = ANY($2::integer[])",
+                        wordId, integerArray(wanted)));
+                }
+            }
+
+            std::vector<Posting> postings;
+            for (const auto& [first, block] : term.blocks) {
+                postings.insert(postings.end(), block.begin(), block.end());
+            }
+            return postings;
         }
 
-        pqxx::result r = txn.exec_params(sql.str(), params);
+    private:
+        struct Term {
+            bool complete = false;                  // every block is loaded
+            bool listed = false;
+            std::vector<uint32_t> firsts;           // block starts, ascending
+            std::map<uint32_t, std::vector<Posting>> blocks;
+        };
 
+        static void fetch(Term& term, const pqxx::result& r) {
+            for (const auto& row : r) {
+                auto [it, added] = term.blocks.try_emplace(static_cast<uint32_t>(row[0].as<int>()));
+                if (added) {
+                    PostingBlock::decode(row[1].as<std::basic_string<std::byte>>(), it->second);
+                }
+            }
+        }
+
+        pqxx::work& txn_;
+        std::unordered_map<int, Term> terms_;
+    };
+}
+
+QueryPlan SearchDatabase::planQuery(pqxx::work& txn, const ParsedQuery& query) {
+    std::vector<std::string> terms;
+    collectTerms(query.root, terms);
+
+    std::stringstream list;
+    list << '{';
+    for (size_t i = 0; i < terms.size(); ++i) {
+        if (i > 0) list << ',';
+        list << '"';
+        for (char c : terms[i]) {
+            if (c == '"' || c == '\\') list << '\\';
+            list << c;
+        }
+        list << '"';
+    }
+    list << '}';
+
+    // Counting stops at the cap: past it a term is common, and only the
+    // order of the rare ones matters. Blocks are counted whole, at most
+    // cap / kBlockPostings + 1 of them.
+    int cap = std::max(1, Config::getInstance().getInt("server", "df_probe_limit", 10000));
+    pqxx::result r = postingLayout_ == PostingLayout::Blocks
+        ? txn.exec_params(
+            "SELECT w.word, w.id, "
+            "(SELECT COALESCE(SUM(s.postings), 0) FROM (SELECT b.postings FROM posting_blocks b "
+            "WHERE b.word_id = w.id ORDER BY b.first_document LIMIT $2) s) "
+            "FROM words w WHERE w.word = ANY($1::text[])",
+            list.str(), static_cast<int>(cap / PostingBlock::kBlockPostings + 1))
+        : txn.exec_params(
+            "SELECT w.word, w.id, "
+            "(SELECT COUNT(*) FROM (SELECT 1 FROM word_frequencies f WHERE f.word_id = w.id LIMIT $2) s) "
+            "FROM words w WHERE w.word = ANY($1::text[])",
+            list.str(), cap);
+
+    std::unordered_map<std::string, TermStats> stats;
+    for (const auto& row : r) {
+        stats[row[0].c_str()] = TermStats{row[1].as<int>(), row[2].as<long long>()};
+    }
+    return QueryPlan(query.root, stats);
+}
+
+std::vector<SearchResult> SearchDatabase::rankByPlan(pqxx::work& txn, const QueryPlan& plan,
+    size_t limit, const SearchCursor* after) {
+    if (postingLayout_ == PostingLayout::Blocks) {
+        return rankByBlocks(txn, plan, limit, after);
+    }
+
+    std::string relevance = "c.score";
+    std::string extra = plan.extraScoreSql();
+    if (!extra.empty()) {
+        relevance += " + " + extra;
+    }
+    relevance += rankBonusSql();
+
+    std::stringstream sql;
+    sql << "SELECT id, url, title, relevance FROM ("
+        << "SELECT d.id, d.url, d.title, " << relevance << " AS relevance "
+        << "FROM (" << plan.driverSql() << ") c "
+        << "JOIN documents d ON d.id = c.document_id "
+        << "WHERE " << plan.filterSql()
+        << ") r ";
+
+    // Keyset continuation instead of OFFSET: deep pages skip nothing
+    pqxx::params params;
+    if (after) {
+        sql << "WHERE (relevance, id) < ($1::bigint, $2::integer) ";
+        params.append(after->score);
+        params.append(after->documentId);
+    }
+
+    sql << "ORDER BY relevance DESC, id DESC "
+        << "LIMIT " << limit;
+
+    return readResults(txn.exec_params(sql.str(), params));
+}
+
+std::vector<SearchResult> SearchDatabase::rankByBlocks(pqxx::work& txn, const QueryPlan& plan,
+    size_t limit, const SearchCursor* after) {
+    BlockPostings source(txn);
+    std::vector<PlanMatch> matches = plan.execute(source);
+    if (matches.empty()) {
+        return {};
+    }
+
+    std::string bonus = rankBonusSql();
+    if (bonus.empty()) {
+        // The scores are final: the page is cut here and only its documents are read
+        if (after) {
+            std::erase_if(matches, [after](const PlanMatch& m) {
+                return m.score > after->score ||
+                    (m.score == after->score && static_cast<int>(m.documentId) >= after->documentId);
+            });
+        }
+        size_t count = std::min(limit, matches.size());
+        std::partial_sort(matches.begin(), matches.begin() + static_cast<std::ptrdiff_t>(count), matches.end(),
+            [](const PlanMatch& a, const PlanMatch& b) {
+                return a.score != b.score ? a.score > b.score : a.documentId > b.documentId;
+            });
+        matches.resize(count);
+
+        std::vector<uint32_t> ids;
+        for (const auto& match : matches) {
+            ids.push_back(match.documentId);
+        }
+        pqxx::result r = txn.exec_params(
+            "SELECT id, url, title FROM documents WHERE id = ANY($1::integer[])", integerArray(ids));
+        std::unordered_map<int, pqxx::row> rows;
         for (const auto& row : r) {
+            rows.emplace(row["id"].as<int>(), row);
+        }
+
+        std::vector<SearchResult> results;
+        for (const auto& match : matches) {
+            auto it = rows.find(static_cast<int>(match.documentId));
+            if (it == rows.end()) {
+                continue;
+            }
             SearchResult result;
-            result.url = row["url"].c_str();
-            result.title = row["title"].c_str();
-            result.relevance = row["relevance"].as<int>();
+            result.documentId = static_cast<int>(match.documentId);
+            result.url = it->second["url"].c_str();
+            result.title = it->second["title"].c_str();
+            result.relevance = static_cast<int>(match.score);
             results.push_back(result);
         }
+        return results;
+    }
+
+    std::string ids = "{", scores = "{";
+    for (size_t i = 0; i < matches.size(); ++i) {
+        if (i > 0) {
+            ids += ',';
+            scores += ',';
+        }
+        ids += std::to_string(matches[i].documentId);
+        scores += std::to_string(matches[i].score);
+    }
+    ids += '}';
+    scores += '}';
+
+    std::stringstream sql;
+    sql << "SELECT id, url, title, relevance FROM ("
+        << "SELECT d.id, d.url, d.title, c.score" << bonus << " AS relevance "
+        << "FROM unnest($1::integer[], $2::bigint[]) AS c(document_id, score) "
+        << "JOIN documents d ON d.id = c.document_id"
+        << ") r ";
+
+    pqxx::params params;
+    params.append(ids);
+    params.append(scores);
+    if (after) {
+        sql << "WHERE (relevance, id) < ($3::bigint, $4::integer) ";
+        params.append(after->score);
+        params.append(after->documentId);
+    }
+
+    sql << "ORDER BY relevance DESC, id DESC "
+        << "LIMIT " << limit;
+
+    return readResults(txn.exec_params(sql.str(), params));
+}
+
+std::vector<SearchResult> SearchDatabase::applyPhrases(pqxx::work& txn, const ParsedQuery& query,
+    std::vector<SearchResult> candidates, const SearchCursor* after) {
+    if (candidates.empty()) {
+        return candidates;
+    }
+
+    std::vector<std::string> terms;
+    for (const auto& phrase : query.phrases) {
+        for (const auto& term : phrase.terms) {
+            if (std::find(terms.begin(), terms.end(), term) == terms.end()) terms.push_back(term);
+        }
+    }
+
+    std::stringstream ids;
+    ids << '{';
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (i > 0) ids << ',';
+        ids << candidates[i].documentId;
+    }
+    ids << '}';
+
+    std::stringstream sql;
+    sql << "SELECT wp.document_id, w.word, wp.positions "
+        << "FROM word_positions wp "
+        << "JOIN words w ON wp.word_id = w.id "
+        << "WHERE wp.document_id = ANY($1::integer[]) AND w.word IN (";
+    for (size_t i = 0; i < terms.size(); ++i) {
+        if (i > 0) sql << ", ";
+        sql << "$" << i + 2;
+    }
+    sql << ")";
+
+    pqxx::params params;
+    params.append(ids.str());
+    for (const auto& term : terms) {
+        params.append(term);
+    }
+
+    // Only the phrase terms of the candidate documents are decoded
+    std::unordered_map<int, std::unordered_map<std::string, PositionList>> positions;
+    for (const auto& row : txn.exec_params(sql.str(), params)) {
+        auto data = row[2].as<std::basic_string<std::byte>>();
+        positions[row[0].as<int>()][row[1].c_str()] = decodePositions(data);
+    }
+
+    int boost = Config::getInstance().getInt("server", "phrase_boost", 10);
+    static const PositionList empty;
+
+    std::vector<SearchResult> matched;
+    for (auto& candidate : candidates) {
+        auto& docPositions = positions[candidate.documentId];
+        long long bonus = 0;
+        bool ok = true;
+
+        for (const auto& phrase : query.phrases) {
+            std::vector<const PositionList*> lists;
+            for (const auto& term : phrase.terms) {
+                auto it = docPositions.find(term);
+                lists.push_back(it == docPositions.end() ? &empty : &it->second);
+            }
+
+            if (phrase.slop == 0) {
+                size_t matches = countPhraseMatches(lists, phrase.offsets);
+                ok = matches > 0;
+                bonus += static_cast<long long>(boost) * static_cast<long long>(matches);
+            } else {
+                uint32_t width = phrase.offsets.back() - phrase.offsets.front() + 1;
+                uint32_t span = minimumSpan(lists);
+                ok = span != 0 && span <= width + phrase.slop;
+                if (ok) bonus += boost * static_cast<long long>(phrase.terms.size()) / span;
+            }
+            if (!ok) break;
+        }
+
+        if (ok) {
+            candidate.relevance += static_cast<int>(bonus);
+            matched.push_back(std::move(candidate));
+        }
+    }
+
+    std::sort(matched.begin(), matched.end(), [](const SearchResult& a, const SearchResult& b) {
+        return a.relevance != b.relevance ? a.relevance > b.relevance : a.documentId > b.documentId;
+    });
+
+    if (after) {
+        auto first = std::find_if(matched.begin(), matched.end(), [after](const SearchResult& r) {
+            return r.relevance < after->score ||
+                (r.relevance == after->score && r.documentId < after->documentId);
+        });
+        matched.erase(matched.begin(), first);
+    }
+
+    return matched;
+}
+
+SearchPage SearchDatabase::search(const ParsedQuery& query, size_t limit,
+    const SearchCursor* after, SearchTimings* timings, std::chrono::steady_clock::time_point deadline) {
+    SearchPage page;
+
+    try {
+        if (query.words.empty() || limit == 0) {
+            return page;
+        }
+
+        pqxx::work txn(*conn_);
+        applyDeadline(txn, deadline);
+
+        auto start = std::chrono::steady_clock::now();
+        QueryPlan plan = planQuery(txn, query);
+        std::vector<SearchResult> ranked;
+        if (plan.matchesNothing()) {
+            // an unknown required term, nothing to run
+        } else if (query.phrases.empty()) {
+            // One extra row tells whether another page exists
+            ranked = rankByPlan(txn, plan, limit + 1, after);
+        } else {
+            // Phrase filtering reorders results, so the keyset is applied
+            // after positional matching over a bounded candidate pool
+            size_t pool = static_cast<size_t>(std::max(1, Config::getInstance().getInt("server", "phrase_candidates", 1000)));
+            ranked = rankByPlan(txn, plan, pool, nullptr);
+        }
+        auto retrieved = std::chrono::steady_clock::now();
+
+        if (!query.phrases.empty() && !ranked.empty()) {
+            ranked = applyPhrases(txn, query, std::move(ranked), after);
+        }
+
+        if (ranked.size() > limit) {
+            ranked.resize(limit);
+            const SearchResult& last = ranked.back();
+            page.nextCursor = SearchCursor{last.relevance, last.documentId}.encode();
+        }
+        page.results = std::move(ranked);
 
         txn.commit();
 
-        std::cout << "🔍 Search for '" << query << "' found " << results.size() << " results" << std::endl;
+        if (timings) {
+            using ms = std::chrono::duration<double, std::milli>;
+            timings->retrieveMs += ms(retrieved - start).count();
+            timings->rankMs += ms(std::chrono::steady_clock::now() - retrieved).count();
+        }
 
+        std::cout << "🔍 Search " << plan.describe() << " found " << page.results.size() << " results" << std::endl;
+
+    } catch (const pqxx::query_canceled& e) {
+        std::cerr << "⏱️ Search cancelled: " << e.what() << std::endl;
+        throw SearchTimeout("Search deadline exceeded");
+    } catch (const SearchTimeout&) {
+        throw;
     } catch (const std::exception& e) {
         std::cerr << "❌ Search error: " << e.what() << std::endl;
+        throw;
+    }
+
+    return page;
+}
+
+uint64_t SearchDatabase::indexGeneration() {
+    // The spider advances this sequence after every indexed document
+    pqxx::nontransaction txn(*conn_);
+    pqxx::result r = txn.exec("SELECT last_value FROM index_generation");
+    return r.empty() ? 0 : r[0][0].as<uint64_t>();
+}
+
+void SearchDatabase::setStatementTimeout(int milliseconds) {
+    pqxx::nontransaction txn(*conn_);
+    txn.exec("SET statement_timeout = " + std::to_string(std::max(0, milliseconds)));
+}
+
+std::unordered_map<int, std::basic_string<std::byte>> SearchDatabase::loadDocumentTexts(const std::vector<int>& documentIds,
+    std::chrono::steady_clock::time_point deadline) {
+    std::unordered_map<int, std::basic_string<std::byte>> texts;
+    if (documentIds.empty()) {
+        return texts;
+    }
+
+    std::stringstream ids;
+    ids << '{';
+    for (size_t i = 0; i < documentIds.size(); ++i) {
+        if (i > 0) ids << ',';
+        ids << documentIds[i];
+    }
+    ids << '}';
+
+    try {
+        pqxx::read_transaction txn(*conn_);
+        applyDeadline(txn, deadline);
+        pqxx::result r = txn.exec_params(
+            "SELECT document_id, body FROM document_texts WHERE document_id = ANY($1::integer[])",
+            ids.str()
+        );
+        for (const auto& row : r) {
+            texts.emplace(row[0].as<int>(), row[1].as<std::basic_string<std::byte>>());
+        }
+    } catch (const pqxx::query_canceled&) {
+        throw SearchTimeout("Snippet deadline exceeded");
+    } catch (const SearchTimeout&) {
+        // The deadline had passed before the query
+        throw;
+    } catch (const std::exception& e) {
+        std::cerr << "❌ Error loading document texts: " << e.what() << std::endl;
+        throw;
     }
+    return texts;
+}
 
-    return results;
+std::vector<std::pair<std::string, uint32_t>> SearchDatabase::loadTermDictionary() {
+    pqxx::read_transaction txn(*conn_);
+    pqxx::result r = txn.exec(postingLayout_ == PostingLayout::Blocks
+        ? "SELECT w.word, SUM(b.postings) AS df "
+          "FROM words w "
+          "JOIN posting_blocks b ON b.word_id = w.id "
+          "GROUP BY w.word"
+        : "SELECT w.word, COUNT(*) AS df "
+          "FROM words w "
+          "JOIN word_frequencies wf ON wf.word_id = w.id "
+          "GROUP BY w.word"
+    );
+
+    std::vector<std::pair<std::string, uint32_t>> terms;
+    terms.reserve(r.size());
+    for (const auto& row : r) {
+        terms.emplace_back(row[0].c_str(), row[1].as<uint32_t>());
+    }
+    return terms;
 }
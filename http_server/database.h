@@ -1,20 +1,91 @@
 #pragma once
+#include <chrono>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <memory>
+#include <cstdint>
+#include <utility>
+#include <cstddef>
+#include <unordered_map>
 #include <pqxx/pqxx>
+#include "query_plan.h"
 
 struct SearchResult {
+    int documentId = 0;
     std::string url;
     std::string title;
-    int relevance;
+    int relevance = 0;
+    std::string snippet;                                // plain text, empty if none
+    std::vector<std::pair<uint32_t, uint32_t>> highlights;  // (offset, length) in snippet
+};
+
+// Keyset position of the last result on a page: results are ordered by
+// (relevance DESC, document id DESC), so the next page starts strictly after it
+struct SearchCursor {
+    long long score = 0;
+    int documentId = 0;
+
+    std::string encode() const;
+    static bool decode(const std::string& token, SearchCursor& cursor);
+};
+
+struct SearchPage {
+    std::vector<SearchResult> results;
+    std::string nextCursor;     // empty on the last page
+    bool partial = false;       // some index shards did not answer in time
+};
+
+// The search ran out of its time budget; the database has cancelled it
+struct SearchTimeout : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+// Per-stage durations of one search, in milliseconds
+struct SearchTimings {
+    double queueMs = 0;         // waiting for a search worker
+    double parseMs = 0;
+    double retrieveMs = 0;
+    double rankMs = 0;
+    double snippetMs = 0;
+    double serializeMs = 0;
+    bool cached = false;
 };
 
 class SearchDatabase {
 private:
     std::unique_ptr<pqxx::connection> conn_;
+    PostingLayout postingLayout_ = PostingLayout::Rows;    // [index] postings
+
+    // Word ids and capped document frequencies of every term in the query
+    QueryPlan planQuery(pqxx::work& txn, const ParsedQuery& query);
+    std::vector<SearchResult> rankByPlan(pqxx::work& txn, const QueryPlan& plan,
+        size_t limit, const SearchCursor* after);
+    // rankByPlan for the block layout: the plan runs in memory over the
+    // fetched blocks and only the matches go back to the database
+    std::vector<SearchResult> rankByBlocks(pqxx::work& txn, const QueryPlan& plan,
+        size_t limit, const SearchCursor* after);
+    std::vector<SearchResult> applyPhrases(pqxx::work& txn, const ParsedQuery& query,
+        std::vector<SearchResult> candidates, const SearchCursor* after);
 
 public:
     SearchDatabase(const std::string& connection_string);
-    std::vector<SearchResult> search(const std::string& query);
+
+    static std::string connectionString();
+    bool isOpen() const { return conn_ && conn_->is_open(); }
+
+    // Statements are cancelled once the deadline passes, which surfaces
+    // as SearchTimeout
+    SearchPage search(const ParsedQuery& query, size_t limit,
+        const SearchCursor* after = nullptr, SearchTimings* timings = nullptr,
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+    uint64_t indexGeneration();
+    // Server-side limit for every later statement on this connection, 0 for none
+    void setStatementTimeout(int milliseconds);
+    // Compressed page texts (DocumentStore format) of the given documents;
+    // cancelled with SearchTimeout past the deadline
+    std::unordered_map<int, std::basic_string<std::byte>> loadDocumentTexts(const std::vector<int>& documentIds,
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+    // Every indexed word with its document frequency
+    std::vector<std::pair<std::string, uint32_t>> loadTermDictionary();
 };
@@ -1,20 +1,41 @@
 ﻿#include "http_connection.h"
 #include "database.h"
 #include "config.h"
+#include "query_cache.h"
+#include "page_templates.h"
+#include "search_service.h"
+#include "search_admission.h"
+#include "json_writer.h"
+#include "search_json.h"
+#include "suggest_trie.h"
+#include "tokenizer.h"
+#include "request_metrics.h"
 #include <sstream>
 #include <iomanip>
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cctype>
 
 std::string url_decode(const std::string& encoded) {
+    auto hexValue = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+
     std::string res;
-    std::istringstream iss(encoded);
-    char ch;
+    res.reserve(encoded.size());
 
-    while (iss.get(ch)) {
+    for (size_t i = 0; i < encoded.size(); ++i) {
+        char ch = encoded[i];
         if (ch == '%') {
-            int hex;
-            if (iss >> std::hex >> hex) {
-                res += static_cast<char>(hex);
+            int hi = i + 2 < encoded.size() ? hexValue(encoded[i + 1]) : -1;
+            int lo = hi >= 0 ? hexValue(encoded[i + 2]) : -1;
+            if (hi >= 0 && lo >= 0) {
+                res += static_cast<char>(hi * 16 + lo);
+                i += 2;
             }
         }
         else if (ch == '+') {
@@ -28,18 +49,57 @@ std::string url_decode(const std::string& encoded) {
     return res;
 }
 
+std::unordered_map<std::string, std::string> parse_form_fields(const std::string& body) {
+    std::unordered_map<std::string, std::string> fields;
+    size_t pos = 0;
+    while (pos <= body.size()) {
+        size_t end = body.find('&', pos);
+        if (end == std::string::npos) end = body.size();
+
+        std::string pair = body.substr(pos, end - pos);
+        size_t eq = pair.find('=');
+        if (eq != std::string::npos) {
+            fields[url_decode(pair.substr(0, eq))] = url_decode(pair.substr(eq + 1));
+        }
+        pos = end + 1;
+    }
+    return fields;
+}
+
 std::string convert_to_utf8(const std::string& str) {
     std::string url_decoded = url_decode(str);
     return url_decoded;
 }
 
+namespace {
+    double elapsedMs(std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+    }
+}
+
+struct HttpConnection::ChunkedJson {
+    http::response<http::empty_body> header;
+    http::response_serializer<http::empty_body> serializer{header};
+    std::string chunk;
+    std::unique_ptr<SearchJsonSerializer> json;
+    size_t resultsPerChunk = 100;
+    bool done = false;
+};
+
 HttpConnection::HttpConnection(tcp::socket socket)
     : socket_(std::move(socket))
 {
+    RequestMetrics::getInstance().connectionOpened();
+}
+
+HttpConnection::~HttpConnection()
+{
+    RequestMetrics::getInstance().connectionClosed();
 }
 
 void HttpConnection::start()
 {
+    acceptedAt_ = std::chrono::steady_clock::now();
     readRequest();
     checkDeadline();
 }
@@ -63,6 +123,9 @@ void HttpConnection::readRequest()
 
 void HttpConnection::processRequest()
 {
+    trace_.readMs = elapsedMs(acceptedAt_);
+    RequestMetrics::getInstance().requestStarted();
+
     response_.version(request_.version());
     response_.keep_alive(false);
 
@@ -82,221 +145,460 @@ void HttpConnection::processRequest()
     default:
         response_.result(http::status::bad_request);
         response_.set(http::field::content_type, "text/plain");
-        beast::ostream(response_.body())
-            << "Invalid request-method '"
-            << std::string(request_.method_string())
-            << "'";
+        response_.body() = "Invalid request-method '" + std::string(request_.method_string()) + "'";
         break;
     }
 
-    writeResponse();
+    // A queued search writes its response when a worker has finished it
+    if (searchPending_)
+        return;
+    sendResponse();
+}
+
+void HttpConnection::sendResponse()
+{
+    if (staticPage_)
+        writeResponse(staticResponse_);
+    else if (chunked_)
+        writeChunkedResponse();
+    else
+        writeResponse(response_);
 }
 
 void HttpConnection::createResponseGet()
 {
-    if (request_.target() == "/")
+    std::string target(request_.target());
+    size_t queryPos = target.find('?');
+    std::string path = target.substr(0, queryPos);
+    std::string queryString = queryPos == std::string::npos ? "" : target.substr(queryPos + 1);
+
+    if (path == "/")
     {
-        response_.set(http::field::content_type, "text/html; charset=utf-8");
-        beast::ostream(response_.body())
-            << "<!DOCTYPE html>"
-            << "<html>"
-            << "<head>"
-            << "<meta charset=\"UTF-8\">"
-            << "<title>Search Engine</title>"
-            << "<style>"
-            << "body { font-family: Arial, sans-serif; margin: 40px; background: linear-gradient(135deg, #667eea 0%, #764ba2 100%); min-height: 100vh; }"
-            << ".container { max-width: 800px; margin: 0 auto; background: white; padding: 40px; border-radius: 15px; box-shadow: 0 10px 30px rgba(0,0,0,0.2); }"
-            << "h1 { color: #333; text-align: center; margin-bottom: 30px; font-size: 2.5em; }"
-            << ".subtitle { text-align: center; color: #666; margin-bottom: 40px; font-size: 1.2em; }"
-            << "form { text-align: center; }"
-            << "input[type=text] { padding: 15px; width: 500px; font-size: 16px; border: 2px solid #ddd; border-radius: 25px; outline: none; transition: border-color 0.3s; }"
-            << "input[type=text]:focus { border-color: #667eea; }"
-            << "input[type=submit] { padding: 15px 30px; font-size: 16px; background: linear-gradient(135deg, #667eea 0%, #764ba2 100%); color: white; border: none; border-radius: 25px; cursor: pointer; margin-left: 10px; transition: transform 0.2s; }"
-            << "input[type=submit]:hover { transform: translateY(-2px); }"
-            << ".features { display: grid; grid-template-columns: repeat(auto-fit, minmax(200px, 1fr)); gap: 20px; margin: 40px 0; }"
-            << ".feature { text-align: center; padding: 20px; background: #f8f9fa; border-radius: 10px; }"
-            << ".feature h3 { color: #333; margin-bottom: 10px; }"
-            << ".feature p { color: #666; font-size: 0.9em; }"
-            << "</style>"
-            << "</head>"
-            << "<body>"
-            << "<div class=\"container\">"
-            << "<h1>рџ”Ќ Search Engine</h1>"
-            << "<div class=\"subtitle\">Search through indexed web pages with intelligent ranking</div>"
-            << "<form action=\"/\" method=\"post\">"
-            << "<input type=\"text\" id=\"search\" name=\"search\" placeholder=\"Enter your search query...\">"
-            << "<input type=\"submit\" value=\"Search\">"
-            << "</form>"
-            << "<div class=\"features\">"
-            << "<div class=\"feature\">"
-            << "<h3>рџ“Љ Real Database</h3>"
-            << "<p>Powered by PostgreSQL with full-text indexing</p>"
-            << "</div>"
-            << "<div class=\"feature\">"
-            << "<h3>рџЋЇ Smart Ranking</h3>"
-            << "<p>Results sorted by relevance score</p>"
-            << "</div>"
-            << "<div class=\"feature\">"
-            << "<h3>рџЊђ Web Crawling</h3>"
-            << "<p>Automatically indexes web pages</p>"
-            << "</div>"
-            << "</div>"
-            << "</div>"
-            << "</body>"
-            << "</html>";
+        trace_.route = Route::Landing;
+        serveStaticPage(PageTemplates::getInstance().landingPage());
+    }
+    else if (path == "/api/search")
+    {
+        trace_.route = Route::ApiSearch;
+        createResponseApiSearch(parse_form_fields(queryString));
+    }
+    else if (path == "/api/suggest")
+    {
+        trace_.route = Route::ApiSuggest;
+        createResponseApiSuggest(parse_form_fields(queryString));
+    }
+    else if (path == "/metrics")
+    {
+        trace_.route = Route::Metrics;
+        createResponseMetrics();
+    }
+    else if (path == "/debug/slow")
+    {
+        trace_.route = Route::DebugSlow;
+        createResponseSlowLog();
     }
     else
     {
         response_.result(http::status::not_found);
         response_.set(http::field::content_type, "text/plain");
-        beast::ostream(response_.body()) << "File not found\r\n";
+        response_.body() = "File not found\r\n";
     }
 }
 
+void HttpConnection::serveStaticPage(const StaticPage& page)
+{
+    staticPage_ = &page;
+    staticResponse_.version(response_.version());
+    staticResponse_.keep_alive(response_.keep_alive());
+    staticResponse_.set(http::field::server, "SearchEngine");
+    staticResponse_.set(http::field::content_type, page.contentType);
+    staticResponse_.set(http::field::cache_control, "public, max-age=3600");
+
+    bool gzip = !page.gzipBody.empty() &&
+        request_[http::field::accept_encoding].find("gzip") != beast::string_view::npos;
+    const std::string& etag = gzip ? page.gzipEtag : page.etag;
+    staticResponse_.set(http::field::etag, etag);
+    if (!page.gzipBody.empty())
+        staticResponse_.set(http::field::vary, "Accept-Encoding");
+
+    if (request_[http::field::if_none_match] == etag)
+    {
+        staticResponse_.result(http::status::not_modified);
+        return;
+    }
+
+    staticResponse_.result(http::status::ok);
+    if (gzip)
+        staticResponse_.set(http::field::content_encoding, "gzip");
+
+    // The body points into the shared page, nothing is copied per request
+    const std::string& body = gzip ? page.gzipBody : page.body;
+    staticResponse_.body() = http::span_body<const char>::value_type(body.data(), body.size());
+}
+
 void HttpConnection::createResponsePost()
 {
     if (request_.target() == "/")
     {
+        trace_.route = Route::SearchPage;
         std::string body = beast::buffers_to_string(request_.body().data());
         std::cout << "рџ”Ќ Search request: " << body << std::endl;
 
-        size_t pos = body.find('=');
-        if (pos == std::string::npos)
+        if (body.find('=') == std::string::npos)
         {
             response_.result(http::status::bad_request);
             response_.set(http::field::content_type, "text/plain");
-            beast::ostream(response_.body()) << "Invalid request format\r\n";
+            response_.body() = "Invalid request format\r\n";
             return;
         }
 
-        std::string key = body.substr(0, pos);
-        std::string value = body.substr(pos + 1);
-
-        std::string searchQuery = convert_to_utf8(value);
-
-        if (key != "search")
+        auto fields = parse_form_fields(body);
+        auto searchIt = fields.find("search");
+        if (searchIt == fields.end())
         {
             response_.result(http::status::bad_request);
             response_.set(http::field::content_type, "text/plain");
-            beast::ostream(response_.body()) << "Invalid search parameter\r\n";
+            response_.body() = "Invalid search parameter\r\n";
             return;
         }
 
-        try {
-            Config& config = Config::getInstance();
-            std::string dbConnection =
-                "host=" + config.getString("database", "host") +
-                " port=" + std::to_string(config.getInt("database", "port")) +
-                " dbname=" + config.getString("database", "name") +
-                " user=" + config.getString("database", "username") +
-                " password=" + config.getString("database", "password");
-
-            SearchDatabase db(dbConnection);
-            auto searchResults = db.search(searchQuery);
-
-            response_.set(http::field::content_type, "text/html; charset=utf-8");
-
-            beast::ostream(response_.body())
-                << "<!DOCTYPE html>"
-                << "<html>"
-                << "<head>"
-                << "<meta charset=\"UTF-8\">"
-                << "<title>Search Results</title>"
-                << "<style>"
-                << "body { font-family: Arial, sans-serif; margin: 40px; background: linear-gradient(135deg, #667eea 0%, #764ba2 100%); min-height: 100vh; }"
-                << ".container { max-width: 900px; margin: 0 auto; background: white; padding: 40px; border-radius: 15px; box-shadow: 0 10px 30px rgba(0,0,0,0.2); }"
-                << "h1 { color: #333; margin-bottom: 10px; }"
-                << ".back-link { display: inline-block; margin-bottom: 30px; color: #667eea; text-decoration: none; font-weight: bold; }"
-                << ".back-link:hover { text-decoration: underline; }"
-                << ".query { color: #666; margin-bottom: 30px; font-size: 1.1em; }"
-                << ".results-count { color: #28a745; margin-bottom: 20px; font-weight: bold; }"
-                << ".result-item { background: #f8f9fa; padding: 20px; margin: 15px 0; border-radius: 10px; border-left: 4px solid #667eea; transition: transform 0.2s; }"
-                << ".result-item:hover { transform: translateX(5px); background: #e9ecef; }"
-                << ".result-title { margin: 0 0 8px 0; }"
-                << ".result-title a { color: #1a0dab; text-decoration: none; font-size: 1.2em; font-weight: bold; }"
-                << ".result-title a:hover { text-decoration: underline; }"
-                << ".result-url { color: #006621; font-size: 0.9em; margin: 0 0 8px 0; }"
-                << ".result-relevance { color: #70757a; font-size: 0.8em; }"
-                << ".no-results { text-align: center; padding: 40px; color: #666; }"
-                << "form { margin: 30px 0; }"
-                << "input[type=text] { padding: 12px; width: 400px; font-size: 16px; border: 2px solid #ddd; border-radius: 20px; outline: none; }"
-                << "input[type=submit] { padding: 12px 25px; font-size: 16px; background: linear-gradient(135deg, #667eea 0%, #764ba2 100%); color: white; border: none; border-radius: 20px; cursor: pointer; margin-left: 10px; }"
-                << "</style>"
-                << "</head>"
-                << "<body>"
-                << "<div class=\"container\">"
-                << "<a href=\"/\" class=\"back-link\">в†ђ Back to search</a>"
-                << "<h1>Search Results</h1>"
-                << "<div class=\"query\">Query: <strong>" << searchQuery << "</strong></div>";
-
-            if (searchResults.empty()) {
-                beast::ostream(response_.body())
-                    << "<div class=\"no-results\">"
-                    << "<h3>рџ”Ќ No results found</h3>"
-                    << "<p>Try different keywords or check the spelling</p>"
-                    << "</div>";
-            } else {
-                beast::ostream(response_.body())
-                    << "<div class=\"results-count\">Found " << searchResults.size() << " results</div>";
-
-                for (const auto& result : searchResults) {
-                    beast::ostream(response_.body())
-                        << "<div class=\"result-item\">"
-                        << "<h3 class=\"result-title\"><a href=\"" << result.url << "\" target=\"_blank\">"
-                        << (result.title.empty() ? result.url : result.title)
-                        << "</a></h3>"
-                        << "<div class=\"result-url\">" << result.url << "</div>"
-                        << "<div class=\"result-relevance\">Relevance score: " << result.relevance << "</div>"
-                        << "</div>";
-                }
-            }
-
-            beast::ostream(response_.body())
-                << "<form action=\"/\" method=\"post\">"
-                << "<input type=\"text\" name=\"search\" value=\"" << searchQuery << "\" placeholder=\"Enter your search query...\">"
-                << "<input type=\"submit\" value=\"Search Again\">"
-                << "</form>"
-                << "</div>"
-                << "</body>"
-                << "</html>";
-        } catch (const std::exception& e) {
-            response_.result(http::status::internal_server_error);
-            response_.set(http::field::content_type, "text/html");
-            beast::ostream(response_.body())
-                << "<html>"
-                << "<head><title>Error</title></head>"
-                << "<body>"
-                << "<h1>Internal Server Error</h1>"
-                << "<p>" << e.what() << "</p>"
-                << "<a href=\"/\">Back to search</a>"
-                << "</body>"
-                << "</html>";
-        }
+        SearchRequest searchRequest = makeSearchRequest(fields, searchIt->second,
+            Config::getInstance().getInt("server", "max_page_size", 100));
+        trace_.query = searchRequest.query;
+        startSearch(std::move(searchRequest));
     }
     else
     {
         response_.result(http::status::not_found);
         response_.set(http::field::content_type, "text/plain");
-        beast::ostream(response_.body()) << "File not found\r\n";
+        response_.body() = "File not found\r\n";
+    }
+}
+
+void HttpConnection::createResponseApiSearch(const std::unordered_map<std::string, std::string>& params)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    response_.set(http::field::content_type, "application/json");
+    response_.set(http::field::cache_control, "no-store");
+
+    auto queryIt = params.find("q");
+    if (queryIt == params.end())
+    {
+        response_.result(http::status::bad_request);
+        JsonWriter(response_.body()).beginObject().key("error").value("Missing q parameter").endObject();
+        return;
+    }
+
+    SearchRequest searchRequest = makeSearchRequest(params, queryIt->second,
+        Config::getInstance().getInt("server", "max_api_k", 1000));
+    trace_.query = searchRequest.query;
+    trace_.search.parseMs = elapsedMs(start);
+    startSearch(std::move(searchRequest));
+}
+
+void HttpConnection::startSearch(SearchRequest request)
+{
+    Config& config = Config::getInstance();
+    auto now = std::chrono::steady_clock::now();
+    request.deadline = now + std::chrono::milliseconds(std::max(1, config.getInt("server", "search_timeout_ms", 2000)));
+
+    // Parsed once here; cache hits cost no database work, so they never wait for a worker
+    auto prepared = std::make_shared<SearchService::Prepared>();
+    try {
+        *prepared = SearchService::prepare(request, &trace_.search);
+        if (QueryCache::Results page = SearchService::cached(*prepared, &trace_.search)) {
+            renderSearch(request, page);
+            return;
+        }
+    } catch (const std::invalid_argument& e) {
+        renderSearchError(http::status::bad_request, e.what());
+        return;
+    }
+
+    auto self = shared_from_this();
+    auto shared = std::make_shared<const SearchRequest>(std::move(request));
+
+    SearchAdmission::Job job;
+    job.deadline = shared->deadline;
+    job.run = [self, shared, prepared, now]
+        {
+            self->trace_.search.queueMs = elapsedMs(now);
+            self->executeSearch(*shared, *prepared);
+            self->resumeResponse();
+        };
+    job.expired = [self, now]
+        {
+            self->trace_.search.queueMs = elapsedMs(now);
+            self->renderSearchError(http::status::service_unavailable, "Search timed out waiting for a worker");
+            self->resumeResponse();
+        };
+
+    if (!SearchAdmission::getInstance().submit(std::move(job)))
+    {
+        renderSearchError(http::status::service_unavailable, "Server is overloaded, try again later");
+        return;
     }
+    searchPending_ = true;
 }
 
-void HttpConnection::writeResponse()
+void HttpConnection::executeSearch(const SearchRequest& request, const SearchService::Prepared& prepared)
 {
+    try {
+        renderSearch(request, SearchService::execute(request, prepared, &trace_.search));
+    } catch (const SearchTimeout& e) {
+        SearchAdmission::getInstance().recordTimeout();
+        renderSearchError(http::status::service_unavailable, e.what());
+    } catch (const std::exception& e) {
+        renderSearchError(http::status::internal_server_error, e.what());
+    }
+}
+
+void HttpConnection::resumeResponse()
+{
+    // Back from a search worker: the socket belongs to the I/O thread
     auto self = shared_from_this();
+    net::post(socket_.get_executor(), [self] { self->sendResponse(); });
+}
 
-    response_.content_length(response_.body().size());
+void HttpConnection::renderSearch(const SearchRequest& request, QueryCache::Results page)
+{
+    auto renderStart = std::chrono::steady_clock::now();
+
+    if (trace_.route == Route::SearchPage)
+    {
+        response_.set(http::field::content_type, "text/html; charset=utf-8");
+        PageTemplates::getInstance().renderResults(response_.body(), request, *page);
+        trace_.renderMs = elapsedMs(renderStart);
+        return;
+    }
+
+    SearchTimings& timings = trace_.search;
+    size_t chunkResults = static_cast<size_t>(std::max(1, Config::getInstance().getInt("server", "json_chunk_results", 100)));
+    if (page->results.size() <= chunkResults)
+    {
+        SearchJsonSerializer(response_.body(), request, page, timings).writeAll();
+        trace_.renderMs = elapsedMs(renderStart);
+        return;
+    }
+
+    // Large k: stream the document so the first results leave before the last are serialized
+    chunked_ = std::make_unique<ChunkedJson>();
+    chunked_->resultsPerChunk = chunkResults;
+    chunked_->header.version(response_.version());
+    chunked_->header.keep_alive(false);
+    chunked_->header.result(http::status::ok);
+    chunked_->header.set(http::field::server, "SearchEngine");
+    chunked_->header.set(http::field::content_type, "application/json");
+    chunked_->header.set(http::field::cache_control, "no-store");
+    chunked_->header.chunked(true);
+    chunked_->json = std::make_unique<SearchJsonSerializer>(chunked_->chunk, request, page, timings);
+}
+
+void HttpConnection::renderSearchError(http::status status, const std::string& message)
+{
+    response_.result(status);
+    response_.body().clear();
+    if (status == http::status::service_unavailable)
+    {
+        // Shed quickly and tell clients when to come back
+        response_.set(http::field::retry_after,
+            std::to_string(std::max(1, Config::getInstance().getInt("server", "retry_after_seconds", 1))));
+    }
+
+    if (trace_.route == Route::ApiSearch)
+    {
+        JsonWriter(response_.body()).beginObject().key("error").value(message).endObject();
+    }
+    else if (status == http::status::bad_request)
+    {
+        response_.set(http::field::content_type, "text/plain");
+        response_.body() = message + "\r\n";
+    }
+    else
+    {
+        response_.set(http::field::content_type, "text/html");
+        std::string& out = response_.body();
+        std::string reason(http::obsolete_reason(status));
+        out.append("<html>"
+            "<head><title>Error</title></head>"
+            "<body>"
+            "<h1>");
+        out.append(reason);
+        out.append("</h1>"
+            "<p>");
+        appendHtmlEscaped(out, message);
+        out.append("</p>"
+            "<a href=\"/\">Back to search</a>"
+            "</body>"
+            "</html>");
+    }
+}
+
+void HttpConnection::createResponseApiSuggest(const std::unordered_map<std::string, std::string>& params)
+{
+    response_.set(http::field::content_type, "application/json");
+    response_.set(http::field::cache_control, "public, max-age=60");
+
+    std::string prefix;
+    auto prefixIt = params.find("prefix");
+    if (prefixIt != params.end())
+        prefix = Tokenizer::foldCase(prefixIt->second);
+
+    int k = 10;
+    auto kIt = params.find("k");
+    if (kIt != params.end()) {
+        try {
+            k = std::clamp(std::stoi(kIt->second), 1, 50);
+        } catch (...) {
+        }
+    }
+
+    std::vector<Suggestion> suggestions;
+    auto trie = SuggestIndex::getInstance().current();
+    if (trie && !prefix.empty())
+        suggestions = trie->complete(prefix, static_cast<size_t>(k));
+
+    JsonWriter json(response_.body());
+    json.beginObject()
+        .key("prefix").value(prefix)
+        .key("ready").value(trie != nullptr)
+        .key("suggestions").beginArray();
+    for (const auto& suggestion : suggestions) {
+        json.beginObject()
+            .key("term").value(suggestion.term)
+            .key("df").value(static_cast<long long>(suggestion.weight))
+            .endObject();
+    }
+    json.endArray().endObject();
+}
+
+void HttpConnection::createResponseMetrics()
+{
+    auto renderStart = std::chrono::steady_clock::now();
+    response_.set(http::field::content_type, "text/plain; version=0.0.4");
+    response_.set(http::field::cache_control, "no-store");
+    RequestMetrics::getInstance().renderPrometheus(response_.body());
+    trace_.renderMs = elapsedMs(renderStart);
+}
+
+void HttpConnection::createResponseSlowLog()
+{
+    auto renderStart = std::chrono::steady_clock::now();
+    response_.set(http::field::content_type, "application/json");
+    response_.set(http::field::cache_control, "no-store");
+    RequestMetrics::getInstance().renderSlowLog(response_.body());
+    trace_.renderMs = elapsedMs(renderStart);
+}
+
+SearchRequest HttpConnection::makeSearchRequest(
+    const std::unordered_map<std::string, std::string>& params, const std::string& query, int maxSize)
+{
+    auto intParam = [&params](const char* name, int defaultValue) {
+        auto it = params.find(name);
+        if (it == params.end() || it->second.empty())
+            return defaultValue;
+        try {
+            return std::stoi(it->second);
+        } catch (...) {
+            return defaultValue;
+        }
+    };
+
+    SearchRequest searchRequest;
+    searchRequest.query = query;
+    searchRequest.page = std::max(1, intParam("page", 1));
+    // k is the API name for the page size
+    searchRequest.size = SearchService::clampPageSize(
+        intParam("k", intParam("size", Config::getInstance().getInt("server", "page_size", 10))), maxSize);
+
+    auto cursorIt = params.find("cursor");
+    if (cursorIt != params.end())
+        searchRequest.cursor = cursorIt->second;
+
+    return searchRequest;
+}
+
+template <class Body>
+void HttpConnection::writeResponse(http::response<Body>& response)
+{
+    auto self = shared_from_this();
+
+    response.prepare_payload();
+    trace_.status = static_cast<int>(response.result_int());
+    writeStartedAt_ = std::chrono::steady_clock::now();
 
     http::async_write(
         socket_,
-        response_,
+        response,
+        [self](beast::error_code ec, std::size_t)
+        {
+            self->finishResponse(ec);
+        });
+}
+
+void HttpConnection::writeChunkedResponse()
+{
+    auto self = shared_from_this();
+    trace_.status = static_cast<int>(chunked_->header.result_int());
+    writeStartedAt_ = std::chrono::steady_clock::now();
+
+    http::async_write_header(
+        socket_,
+        chunked_->serializer,
         [self](beast::error_code ec, std::size_t)
         {
-            self->socket_.shutdown(tcp::socket::shutdown_send, ec);
-            self->deadline_.cancel();
+            if (ec)
+                self->finishResponse(ec);
+            else
+                self->writeNextChunk();
         });
 }
 
+void HttpConnection::writeNextChunk()
+{
+    auto self = shared_from_this();
+    ChunkedJson& chunked = *chunked_;
+
+    if (chunked.done)
+    {
+        net::async_write(
+            socket_,
+            http::make_chunk_last(),
+            [self](beast::error_code ec, std::size_t)
+            {
+                self->finishResponse(ec);
+            });
+        return;
+    }
+
+    chunked.chunk.clear();
+    chunked.done = !chunked.json->writeNext(chunked.resultsPerChunk);
+
+    net::async_write(
+        socket_,
+        http::make_chunk(net::buffer(chunked.chunk)),
+        [self](beast::error_code ec, std::size_t)
+        {
+            if (ec)
+                self->finishResponse(ec);
+            else
+                self->writeNextChunk();
+        });
+}
+
+void HttpConnection::finishResponse(beast::error_code ec)
+{
+    socket_.shutdown(tcp::socket::shutdown_send, ec);
+    deadline_.cancel();
+
+    // Chunked JSON is serialized while writing, so its serialization lands in the write stage
+    trace_.writeMs = elapsedMs(writeStartedAt_);
+    trace_.totalMs = elapsedMs(acceptedAt_);
+    trace_.finishedAt = std::chrono::system_clock::now();
+    RequestMetrics::getInstance().requestFinished(trace_);
+}
+
 void HttpConnection::checkDeadline()
 {
     auto self = shared_from_this();
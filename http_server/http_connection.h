@@ -4,6 +4,13 @@
 #include <boost/beast/http.hpp>
 #include <boost/beast/version.hpp>
 #include <boost/asio.hpp>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "request_metrics.h"
+#include "search_service.h"
+
+struct StaticPage;
 
 namespace beast = boost::beast;
 namespace http = beast::http;
@@ -16,21 +23,49 @@ protected:
     tcp::socket socket_;
     beast::flat_buffer buffer_{8192};
     http::request<http::dynamic_body> request_;
-    http::response<http::dynamic_body> response_;
+    http::response<http::string_body> response_;
+    http::response<http::span_body<const char>> staticResponse_;
+    const StaticPage* staticPage_ = nullptr;
+    struct ChunkedJson;
+    std::unique_ptr<ChunkedJson> chunked_;
     net::steady_timer deadline_{
         socket_.get_executor(), std::chrono::seconds(60)};
+    bool searchPending_ = false;    // response written once a search worker is done
+    RequestTrace trace_;
+    std::chrono::steady_clock::time_point acceptedAt_;
+    std::chrono::steady_clock::time_point writeStartedAt_;
 
     void readRequest();
     void processRequest();
     void createResponseGet();
     void createResponsePost();
-    void writeResponse();
+    void createResponseApiSearch(const std::unordered_map<std::string, std::string>& params);
+    void startSearch(SearchRequest request);
+    void executeSearch(const SearchRequest& request, const SearchService::Prepared& prepared);
+    void resumeResponse();
+    void renderSearch(const SearchRequest& request, std::shared_ptr<const SearchPage> page);
+    void renderSearchError(http::status status, const std::string& message);
+    void createResponseApiSuggest(const std::unordered_map<std::string, std::string>& params);
+    void createResponseMetrics();
+    void createResponseSlowLog();
+    void serveStaticPage(const StaticPage& page);
+    void sendResponse();
+    template <class Body>
+    void writeResponse(http::response<Body>& response);
+    void writeChunkedResponse();
+    void writeNextChunk();
+    void finishResponse(beast::error_code ec);
     void checkDeadline();
 
+    static SearchRequest makeSearchRequest(
+        const std::unordered_map<std::string, std::string>& params, const std::string& query, int maxSize);
+
 public:
     HttpConnection(tcp::socket socket);
+    ~HttpConnection();
     void start();
 };
 
 std::string url_decode(const std::string& encoded);
+std::unordered_map<std::string, std::string> parse_form_fields(const std::string& body);
 std::string convert_to_utf8(const std::string& str);
\ No newline at end of file
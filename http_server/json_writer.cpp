@@ -0,0 +1,111 @@
+#include "json_writer.h"
+#include <cstdio>
+#include <cmath>
+
+void JsonWriter::separate() {
+    if (afterKey_) {
+        afterKey_ = false;
+        return;
+    }
+    if (!hasItems_.empty()) {
+        if (hasItems_.back()) out_.push_back(',');
+        hasItems_.back() = true;
+    }
+}
+
+JsonWriter& JsonWriter::beginObject() {
+    separate();
+    out_.push_back('{');
+    hasItems_.push_back(false);
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+    out_.push_back('}');
+    hasItems_.pop_back();
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+    separate();
+    out_.push_back('[');
+    hasItems_.push_back(false);
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+    out_.push_back(']');
+    hasItems_.pop_back();
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(std::string_view name) {
+    separate();
+    out_.push_back('"');
+    appendJsonEscaped(out_, name);
+    out_.append("\":");
+    afterKey_ = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(std::string_view text) {
+    separate();
+    out_.push_back('"');
+    appendJsonEscaped(out_, text);
+    out_.push_back('"');
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(long long number) {
+    separate();
+    char buf[24];
+    int n = std::snprintf(buf, sizeof(buf), "%lld", number);
+    out_.append(buf, static_cast<size_t>(n));
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(double number) {
+    if (!std::isfinite(number)) {
+        return null();
+    }
+    separate();
+    char buf[32];
+    int n = std::snprintf(buf, sizeof(buf), "%.6g", number);
+    out_.append(buf, static_cast<size_t>(n));
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(bool flag) {
+    separate();
+    out_.append(flag ? "true" : "false");
+    return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+    separate();
+    out_.append("null");
+    return *this;
+}
+
+void appendJsonEscaped(std::string& out, std::string_view text) {
+    static const char* const hex = "0123456789abcdef";
+    for (char ch : text) {
+        unsigned char c = static_cast<unsigned char>(ch);
+        switch (c) {
+        case '"': out.append("\\\""); break;
+        case '\\': out.append("\\\\"); break;
+        case '\n': out.append("\\n"); break;
+        case '\r': out.append("\\r"); break;
+        case '\t': out.append("\\t"); break;
+        default:
+            if (c < 0x20) {
+                out.append("\\u00");
+                out.push_back(hex[c >> 4]);
+                out.push_back(hex[c & 0xF]);
+            } else {
+                out.push_back(ch);
+            }
+            break;
+        }
+    }
+}
@@ -1,11 +1,24 @@
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 
+#include <algorithm>
+#include <condition_variable>
 #include <iostream>
+#include <mutex>
+#include <stop_token>
 #include <string>
+#include <thread>
 
 #include "http_connection.h"
 #include "config.h"
+#include "tokenizer.h"
+#include "database.h"
+#include "query_cache.h"
+#include "page_templates.h"
+#include "suggest_trie.h"
+#include "shard_broker.h"
+#include "shards.h"
+#include "search_admission.h"
 
 void httpServer(tcp::acceptor& acceptor, tcp::socket& socket)
 {
@@ -18,6 +31,69 @@ void httpServer(tcp::acceptor& acceptor, tcp::socket& socket)
         });
 }
 
+// The dictionary scan behind the suggest trie is heavy, so rebuilds after
+// index changes are spaced at least suggest_rebuild_seconds apart
+void refreshSuggestIndex(bool indexChanged)
+{
+    static bool stale = true;
+    static std::chrono::steady_clock::time_point lastRebuild;
+
+    stale = stale || indexChanged;
+    auto minInterval = std::chrono::seconds(
+        Config::getInstance().getInt("server", "suggest_rebuild_seconds", 60));
+    auto now = std::chrono::steady_clock::now();
+
+    if (stale && (lastRebuild.time_since_epoch().count() == 0 || now - lastRebuild >= minInterval))
+    {
+        SuggestIndex::getInstance().rebuildAsync();
+        lastRebuild = now;
+        stale = false;
+    }
+}
+
+// Polls the index generation published by the spider on a thread of its
+// own, so a slow or unreachable database never stalls socket I/O. Only
+// the cache invalidation is posted to the I/O thread.
+void pollIndexGeneration(std::stop_token stop, net::io_context& ioc, std::chrono::milliseconds interval)
+{
+    std::unique_ptr<SearchDatabase> db;
+    std::mutex mtx;
+    std::condition_variable_any wake;
+
+    while (!stop.stop_requested())
+    {
+        try
+        {
+            ShardBroker& broker = ShardBroker::getInstance();
+            if (!db && !broker.enabled())
+                db = std::make_unique<SearchDatabase>(SearchDatabase::connectionString());
+
+            uint64_t generation = broker.enabled() ? broker.indexGeneration() : db->indexGeneration();
+            net::post(ioc, [generation]
+                {
+                    QueryCache& cache = QueryCache::getInstance();
+                    bool changed = cache.setGeneration(generation);
+                    refreshSuggestIndex(changed);
+                    if (changed)
+                    {
+                        QueryCacheStats stats = cache.stats();
+                        std::cout << "🔄 Index generation " << stats.generation
+                                  << ", cache hit rate " << static_cast<int>(stats.hitRate() * 100) << "% ("
+                                  << stats.hits << " hits, " << stats.misses << " misses)" << std::endl;
+                    }
+                });
+        }
+        catch (std::exception const& e)
+        {
+            std::cerr << "⚠️  Cannot read index generation: " << e.what() << std::endl;
+            db.reset();
+        }
+
+        std::unique_lock<std::mutex> lock(mtx);
+        wake.wait_for(lock, stop, interval, [] { return false; });
+    }
+}
+
 int main(int argc, char* argv[])
 {
     SetConsoleCP(CP_UTF8);
@@ -34,8 +110,32 @@ int main(int argc, char* argv[])
         auto const address = net::ip::make_address("0.0.0.0");
         unsigned short port = static_cast<unsigned short>(config.getInt("server", "port", 8080));
 
+        // Spider and server must tokenize identically
+        Tokenizer::Options tokenizerOptions;
+        tokenizerOptions.stemming = config.getInt("tokenizer", "stemming", 0) != 0;
+        Tokenizer::configure(tokenizerOptions);
+
+        PageTemplates::getInstance().initialize(config.getInt("server", "gzip_static", 1) != 0);
+
+        QueryCache::getInstance().configure(
+            static_cast<size_t>(config.getInt("server", "cache_capacity", 4096)),
+            std::chrono::seconds(config.getInt("server", "cache_ttl", 300)));
+
+        // Broker mode when the index is split over shard databases
+        ShardBroker::getInstance().configure(
+            shards::connectionStrings(SearchDatabase::connectionString(), config.getString("shards", "databases")),
+            std::chrono::milliseconds(config.getInt("shards", "timeout_ms", 500)));
+
+        // Searches run on a bounded worker pool, the I/O thread only moves bytes
+        SearchAdmission::getInstance().configure(
+            static_cast<size_t>(std::max(1, config.getInt("server", "search_workers", 8))),
+            static_cast<size_t>(std::max(0, config.getInt("server", "search_queue", 64))));
+
         net::io_context ioc{1};
 
+        std::jthread generationPoller(pollIndexGeneration, std::ref(ioc),
+            std::chrono::milliseconds(config.getInt("server", "cache_refresh_ms", 1000)));
+
         tcp::acceptor acceptor{ioc, { address, port }};
         tcp::socket socket{ioc};
         httpServer(acceptor, socket);
@@ -0,0 +1,331 @@
+#include "page_templates.h"
+#include <zlib.h>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdint>
+
+namespace {
+    const char* const kLandingPage =
+        "<!DOCTYPE html>"
+        "<html>"
+        "<head>"
+        "<meta charset=\"UTF-8\">"
+        "<title>Search Engine</title>"
+        "<style>"
+        "body { font-family: Arial, sans-serif; margin: 40px; background: linear-gradient(135deg, #667eea 0%, #764ba2 100%); min-height: 100vh; }"
+        ".container { max-width: 800px; margin: 0 auto; background: white; padding: 40px; border-radius: 15px; box-shadow: 0 10px 30px rgba(0,0,0,0.2); }"
+        "h1 { color: #333; text-align: center; margin-bottom: 30px; font-size: 2.5em; }"
+        ".subtitle { text-align: center; color: #666; margin-bottom: 40px; font-size: 1.2em; }"
+        "form { text-align: center; }"
+        "input[type=text] { padding: 15px; width: 500px; font-size: 16px; border: 2px solid #ddd; border-radius: 25px; outline: none; transition: border-color 0.3s; }"
+        "input[type=text]:focus { border-color: #667eea; }"
+        "input[type=submit] { padding: 15px 30px; font-size: 16px; background: linear-gradient(135deg, #667eea 0%, #764ba2 100%); color: white; border: none; border-radius: 25px; cursor: pointer; margin-left: 10px; transition: transform 0.2s; }"
+        "input[type=submit]:hover { transform: translateY(-2px); }"
+        ".features { display: grid; grid-template-columns: repeat(auto-fit, minmax(200px, 1fr)); gap: 20px; margin: 40px 0; }"
+        ".feature { text-align: center; padding: 20px; background: #f8f9fa; border-radius: 10px; }"
+        ".feature h3 { color: #333; margin-bottom: 10px; }"
+        ".feature p { color: #666; font-size: 0.9em; }"
+        "</style>"
+        "</head>"
+        "<body>"
+        "<div class=\"container\">"
+        "<h1>рџ”Ќ Search Engine</h1>"
+        "<div class=\"subtitle\">Search through indexed web pages with intelligent ranking</div>"
+        "<form action=\"/\" method=\"post\">"
+        "<input type=\"text\" id=\"search\" name=\"search\" placeholder=\"Enter your search query...\">"
+        "<input type=\"submit\" value=\"Search\">"
+        "</form>"
+        "<div class=\"features\">"
+        "<div class=\"feature\">"
+        "<h3>рџ“Љ Real Database</h3>"
+        "<p>Powered by PostgreSQL with full-text indexing</p>"
+        "</div>"
+        "<div class=\"feature\">"
+        "<h3>рџЋЇ Smart Ranking</h3>"
+        "<p>Results sorted by relevance score</p>"
+        "</div>"
+        "<div class=\"feature\">"
+        "<h3>рџЊђ Web Crawling</h3>"
+        "<p>Automatically indexes web pages</p>"
+        "</div>"
+        "</div>"
+        "</div>"
+        "</body>"
+        "</html>";
+
+    const char* const kResultsPage =
+        "<!DOCTYPE html>"
+        "<html>"
+        "<head>"
+        "<meta charset=\"UTF-8\">"
+        "<title>Search Results</title>"
+        "<style>"
+        "body { font-family: Arial, sans-serif; margin: 40px; background: linear-gradient(135deg, #667eea 0%, #764ba2 100%); min-height: 100vh; }"
+        ".container { max-width: 900px; margin: 0 auto; background: white; padding: 40px; border-radius: 15px; box-shadow: 0 10px 30px rgba(0,0,0,0.2); }"
+        "h1 { color: #333; margin-bottom: 10px; }"
+        ".back-link { display: inline-block; margin-bottom: 30px; color: #667eea; text-decoration: none; font-weight: bold; }"
+        ".back-link:hover { text-decoration: underline; }"
+        ".query { color: #666; margin-bottom: 30px; font-size: 1.1em; }"
+        ".results-count { color: #28a745; margin-bottom: 20px; font-weight: bold; }"
+        ".result-item { background: #f8f9fa; padding: 20px; margin: 15px 0; border-radius: 10px; border-left: 4px solid #667eea; transition: transform 0.2s; }"
+        ".result-item:hover { transform: translateX(5px); background: #e9ecef; }"
+        ".result-title { margin: 0 0 8px 0; }"
+        ".result-title a { color: #1a0dab; text-decoration: none; font-size: 1.2em; font-weight: bold; }"
+        ".result-title a:hover { text-decoration: underline; }"
+        ".result-url { color: #006621; font-size: 0.9em; margin: 0 0 8px 0; }"
+        ".result-snippet { color: #4d5156; font-size: 0.95em; line-height: 1.4; margin: 0 0 8px 0; }"
+        ".result-snippet b { color: #202124; }"
+        ".result-relevance { color: #70757a; font-size: 0.8em; }"
+        ".no-results { text-align: center; padding: 40px; color: #666; }"
+        ".pager { display: flex; align-items: center; gap: 20px; color: #666; }"
+        ".pager form { margin: 0; }"
+        "form { margin: 30px 0; }"
+        "input[type=text] { padding: 12px; width: 400px; font-size: 16px; border: 2px solid #ddd; border-radius: 20px; outline: none; }"
+        "input[type=submit] { padding: 12px 25px; font-size: 16px; background: linear-gradient(135deg, #667eea 0%, #764ba2 100%); color: white; border: none; border-radius: 20px; cursor: pointer; margin-left: 10px; }"
+        "</style>"
+        "</head>"
+        "<body>"
+        "<div class=\"container\">"
+        "<a href=\"/\" class=\"back-link\">в†ђ Back to search</a>"
+        "<h1>Search Results</h1>"
+        "<div class=\"query\">Query: <strong>{{query}}</strong></div>"
+        "{{results}}"
+        "{{pager}}"
+        "<form action=\"/\" method=\"post\">"
+        "<input type=\"text\" name=\"search\" value=\"{{query}}\" placeholder=\"Enter your search query...\">"
+        "<input type=\"submit\" value=\"Search Again\">"
+        "</form>"
+        "</div>"
+        "</body>"
+        "</html>";
+
+    const char* const kResultItem =
+        "<div class=\"result-item\">"
+        "<h3 class=\"result-title\"><a href=\"{{url}}\" target=\"_blank\">{{title}}</a></h3>"
+        "<div class=\"result-url\">{{url}}</div>"
+        "{{snippet}}"
+        "<div class=\"result-relevance\">Relevance score: {{relevance}}</div>"
+        "</div>";
+
+    const char* const kNoResults =
+        "<div class=\"no-results\">"
+        "<h3>рџ”Ќ No results found</h3>"
+        "<p>Try different keywords or check the spelling</p>"
+        "</div>";
+
+    const char* const kNextPage =
+        "<form action=\"/\" method=\"post\">"
+        "<input type=\"hidden\" name=\"search\" value=\"{{query}}\">"
+        "<input type=\"hidden\" name=\"size\" value=\"{{size}}\">"
+        "<input type=\"hidden\" name=\"page\" value=\"{{page}}\">"
+        "<input type=\"hidden\" name=\"cursor\" value=\"{{cursor}}\">"
+        "<input type=\"submit\" value=\"Next page &rarr;\">"
+        "</form>";
+
+    // FNV-1a, enough to tell page versions apart
+    std::string makeEtag(std::string_view data, const char* suffix) {
+        uint64_t hash = 14695981039346656037ull;
+        for (unsigned char c : data) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "\"%016llx%s\"", static_cast<unsigned long long>(hash), suffix);
+        return buf;
+    }
+}
+
+CompiledTemplate::CompiledTemplate(std::string_view source) {
+    std::string literal;
+    size_t pos = 0;
+    while (pos < source.size()) {
+        size_t open = source.find("{{", pos);
+        size_t close = open == std::string_view::npos ? open : source.find("}}", open + 2);
+        if (close == std::string_view::npos) {
+            literal.append(source.substr(pos));
+            break;
+        }
+
+        literal.append(source.substr(pos, open - pos));
+        std::string name(source.substr(open + 2, close - open - 2));
+
+        size_t slot = 0;
+        while (slot < slotNames_.size() && slotNames_[slot] != name) ++slot;
+        if (slot == slotNames_.size()) slotNames_.push_back(name);
+
+        literalSize_ += literal.size();
+        segments_.push_back(Segment{std::move(literal), slot});
+        literal.clear();
+        pos = close + 2;
+    }
+
+    literalSize_ += literal.size();
+    segments_.push_back(Segment{std::move(literal), kNoSlot});
+}
+
+size_t CompiledTemplate::slotIndex(std::string_view name) const {
+    for (size_t i = 0; i < slotNames_.size(); ++i) {
+        if (slotNames_[i] == name) return i;
+    }
+    throw std::invalid_argument("Unknown template slot: " + std::string(name));
+}
+
+PageTemplates::PageTemplates()
+    : resultsPage_(kResultsPage)
+    , resultItem_(kResultItem)
+    , noResults_(kNoResults)
+    , nextPage_(kNextPage)
+{
+    pageQuerySlot_ = resultsPage_.slotIndex("query");
+    pageBodySlot_ = resultsPage_.slotIndex("results");
+    pagePagerSlot_ = resultsPage_.slotIndex("pager");
+    nextQuerySlot_ = nextPage_.slotIndex("query");
+    nextSizeSlot_ = nextPage_.slotIndex("size");
+    nextPageSlot_ = nextPage_.slotIndex("page");
+    nextCursorSlot_ = nextPage_.slotIndex("cursor");
+    itemUrlSlot_ = resultItem_.slotIndex("url");
+    itemTitleSlot_ = resultItem_.slotIndex("title");
+    itemSnippetSlot_ = resultItem_.slotIndex("snippet");
+    itemRelevanceSlot_ = resultItem_.slotIndex("relevance");
+}
+
+void PageTemplates::initialize(bool gzip) {
+    landingPage_.contentType = "text/html; charset=utf-8";
+    landingPage_.body = kLandingPage;
+    landingPage_.etag = makeEtag(landingPage_.body, "");
+    if (gzip) {
+        landingPage_.gzipBody = gzipCompress(landingPage_.body);
+        landingPage_.gzipEtag = makeEtag(landingPage_.body, "-gz");
+    }
+}
+
+void PageTemplates::renderResults(std::string& out, const SearchRequest& request, const SearchPage& page) const {
+    const std::string& query = request.query;
+
+    // Escaping grows text only for markup characters, so the estimate is usually exact
+    size_t estimate = resultsPage_.literalSize() + noResults_.literalSize() + nextPage_.literalSize()
+        + 3 * query.size() + page.nextCursor.size() + 128;
+    for (const auto& result : page.results) {
+        estimate += resultItem_.literalSize() + 2 * result.url.size() + result.title.size() + 12;
+    }
+    out.reserve(out.size() + estimate);
+
+    resultsPage_.render(out, [&](std::string& o, size_t slot) {
+        if (slot == pageQuerySlot_) {
+            appendHtmlEscaped(o, query);
+        } else if (slot == pageBodySlot_) {
+            renderResultList(o, page.results);
+        } else if (slot == pagePagerSlot_) {
+            renderPager(o, request, page);
+        }
+    });
+}
+
+void PageTemplates::renderResultList(std::string& out, const std::vector<SearchResult>& results) const {
+    if (results.empty()) {
+        noResults_.render(out, [](std::string&, size_t) {});
+        return;
+    }
+
+    out.append("<div class=\"results-count\">Found ");
+    out.append(std::to_string(results.size()));
+    out.append(" results</div>");
+
+    for (const auto& result : results) {
+        resultItem_.render(out, [&](std::string& o, size_t slot) {
+            if (slot == itemUrlSlot_) {
+                appendHtmlEscaped(o, result.url);
+            } else if (slot == itemTitleSlot_) {
+                appendHtmlEscaped(o, result.title.empty() ? result.url : result.title);
+            } else if (slot == itemSnippetSlot_) {
+                renderSnippet(o, result);
+            } else if (slot == itemRelevanceSlot_) {
+                o.append(std::to_string(result.relevance));
+            }
+        });
+    }
+}
+
+void PageTemplates::renderSnippet(std::string& out, const SearchResult& result) const {
+    if (result.snippet.empty()) {
+        return;
+    }
+
+    std::string_view text = result.snippet;
+    out.append("<div class=\"result-snippet\">");
+    size_t pos = 0;
+    for (const auto& [offset, length] : result.highlights) {
+        if (offset < pos || offset + length > text.size()) {
+            continue;
+        }
+        appendHtmlEscaped(out, text.substr(pos, offset - pos));
+        out.append("<b>");
+        appendHtmlEscaped(out, text.substr(offset, length));
+        out.append("</b>");
+        pos = offset + length;
+    }
+    appendHtmlEscaped(out, text.substr(pos));
+    out.append("</div>");
+}
+
+void PageTemplates::renderPager(std::string& out, const SearchRequest& request, const SearchPage& page) const {
+    if (request.page <= 1 && page.nextCursor.empty()) {
+        return;
+    }
+
+    out.append("<div class=\"pager\"><span>Page ");
+    out.append(std::to_string(request.page));
+    out.append("</span>");
+
+    if (!page.nextCursor.empty()) {
+        nextPage_.render(out, [&](std::string& o, size_t slot) {
+            if (slot == nextQuerySlot_) {
+                appendHtmlEscaped(o, request.query);
+            } else if (slot == nextSizeSlot_) {
+                o.append(std::to_string(request.size));
+            } else if (slot == nextPageSlot_) {
+                o.append(std::to_string(request.page + 1));
+            } else if (slot == nextCursorSlot_) {
+                o.append(page.nextCursor);
+            }
+        });
+    }
+
+    out.append("</div>");
+}
+
+void appendHtmlEscaped(std::string& out, std::string_view text) {
+    for (char c : text) {
+        switch (c) {
+        case '&': out.append("&amp;"); break;
+        case '<': out.append("&lt;"); break;
+        case '>': out.append("&gt;"); break;
+        case '"': out.append("&quot;"); break;
+        case '\'': out.append("&#39;"); break;
+        default: out.push_back(c); break;
+        }
+    }
+}
+
+std::string gzipCompress(std::string_view data) {
+    z_stream zs{};
+    // 15 window bits + 16 selects the gzip wrapper instead of raw zlib
+    if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("deflateInit2 failed");
+    }
+
+    std::string out(deflateBound(&zs, static_cast<uLong>(data.size())) + 32, '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    zs.avail_in = static_cast<uInt>(data.size());
+    zs.next_out = reinterpret_cast<Bytef*>(out.data());
+    zs.avail_out = static_cast<uInt>(out.size());
+
+    int rc = deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+
+    if (rc != Z_STREAM_END) {
+        throw std::runtime_error("gzip compression failed");
+    }
+    return out;
+}
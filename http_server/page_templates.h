@@ -0,0 +1,91 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include "database.h"
+#include "search_service.h"
+
+// Immutable pre-rendered page shared by all connections
+struct StaticPage {
+    std::string contentType;
+    std::string body;
+    std::string gzipBody;   // empty when compression is disabled
+    std::string etag;
+    std::string gzipEtag;
+};
+
+// Template split once into literal segments and named slots,
+// so rendering is a sequence of appends into a pre-sized buffer
+class CompiledTemplate {
+public:
+    explicit CompiledTemplate(std::string_view source);
+
+    size_t slotIndex(std::string_view name) const;
+    size_t literalSize() const { return literalSize_; }
+
+    // emit(out, slot) is called for every slot occurrence in template order
+    template <class Emit>
+    void render(std::string& out, Emit&& emit) const {
+        for (const auto& segment : segments_) {
+            out.append(segment.literal);
+            if (segment.slot != kNoSlot) {
+                emit(out, segment.slot);
+            }
+        }
+    }
+
+private:
+    static constexpr size_t kNoSlot = static_cast<size_t>(-1);
+
+    struct Segment {
+        std::string literal;
+        size_t slot;
+    };
+
+    std::vector<Segment> segments_;
+    std::vector<std::string> slotNames_;
+    size_t literalSize_ = 0;
+};
+
+class PageTemplates {
+public:
+    // Renders the static pages; call once before serving requests
+    void initialize(bool gzip);
+
+    const StaticPage& landingPage() const { return landingPage_; }
+
+    void renderResults(std::string& out, const SearchRequest& request, const SearchPage& page) const;
+
+    static PageTemplates& getInstance() {
+        static PageTemplates instance;
+        return instance;
+    }
+
+private:
+    PageTemplates();
+
+    void renderResultList(std::string& out, const std::vector<SearchResult>& results) const;
+    void renderSnippet(std::string& out, const SearchResult& result) const;
+    void renderPager(std::string& out, const SearchRequest& request, const SearchPage& page) const;
+
+    StaticPage landingPage_;
+
+    CompiledTemplate resultsPage_;
+    CompiledTemplate resultItem_;
+    CompiledTemplate noResults_;
+    CompiledTemplate nextPage_;
+    size_t pageQuerySlot_;
+    size_t pageBodySlot_;
+    size_t pagePagerSlot_;
+    size_t nextQuerySlot_;
+    size_t nextSizeSlot_;
+    size_t nextPageSlot_;
+    size_t nextCursorSlot_;
+    size_t itemUrlSlot_;
+    size_t itemTitleSlot_;
+    size_t itemSnippetSlot_;
+    size_t itemRelevanceSlot_;
+};
+
+void appendHtmlEscaped(std::string& out, std::string_view text);
+std::string gzipCompress(std::string_view data);
@@ -0,0 +1,96 @@
+#include "positional.h"
+#include <algorithm>
+
+PositionList decodePositions(std::basic_string_view<std::byte> data) {
+    PositionList positions;
+    positions.reserve(data.size());
+
+    uint32_t current = 0;
+    uint32_t delta = 0;
+    int shift = 0;
+    for (std::byte b : data) {
+        uint32_t value = static_cast<uint32_t>(b);
+        delta |= (value & 0x7F) << shift;
+        if (value & 0x80) {
+            shift += 7;
+            continue;
+        }
+        current += delta;
+        positions.push_back(current);
+        delta = 0;
+        shift = 0;
+    }
+
+    return positions;
+}
+
+size_t countPhraseMatches(const std::vector<const PositionList*>& lists, const std::vector<uint32_t>& offsets) {
+    if (lists.empty()) {
+        return 0;
+    }
+
+    // One forward cursor per list: candidate starts only ever increase
+    std::vector<size_t> cursors(lists.size(), 0);
+    size_t matches = 0;
+
+    for (uint32_t first : *lists[0]) {
+        if (first < offsets[0]) {
+            continue;
+        }
+        uint32_t start = first - offsets[0];
+
+        bool matched = true;
+        for (size_t i = 1; i < lists.size() && matched; ++i) {
+            const PositionList& list = *lists[i];
+            uint32_t wanted = start + offsets[i];
+            size_t& cursor = cursors[i];
+            while (cursor < list.size() && list[cursor] < wanted) {
+                ++cursor;
+            }
+            if (cursor == list.size()) {
+                return matches;
+            }
+            matched = list[cursor] == wanted;
+        }
+
+        if (matched) {
+            ++matches;
+        }
+    }
+
+    return matches;
+}
+
+uint32_t minimumSpan(const std::vector<const PositionList*>& lists) {
+    if (lists.empty()) {
+        return 0;
+    }
+    for (const PositionList* list : lists) {
+        if (list->empty()) return 0;
+    }
+
+    std::vector<size_t> cursors(lists.size(), 0);
+    uint32_t best = UINT32_MAX;
+
+    // Advance the list holding the smallest position until one runs out
+    while (true) {
+        uint32_t low = UINT32_MAX;
+        uint32_t high = 0;
+        size_t lowList = 0;
+        for (size_t i = 0; i < lists.size(); ++i) {
+            uint32_t position = (*lists[i])[cursors[i]];
+            if (position < low) {
+                low = position;
+                lowList = i;
+            }
+            high = std::max(high, position);
+        }
+
+        best = std::min(best, high - low + 1);
+        if (++cursors[lowList] == lists[lowList]->size()) {
+            break;
+        }
+    }
+
+    return best;
+}
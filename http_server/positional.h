@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+using PositionList = std::vector<uint32_t>;
+
+// Inverse of the spider's Database::encodePositions (LEB128 varint gaps)
+PositionList decodePositions(std::basic_string_view<std::byte> data);
+
+// Number of start positions p such that list i contains p + offsets[i]
+// for every i; offsets are relative to the first term
+size_t countPhraseMatches(const std::vector<const PositionList*>& lists, const std::vector<uint32_t>& offsets);
+
+// Length of the smallest window holding one position from every list,
+// or 0 when some list is empty
+uint32_t minimumSpan(const std::vector<const PositionList*>& lists);
@@ -0,0 +1,91 @@
+#include "query_cache.h"
+#include <algorithm>
+#include <functional>
+
+void QueryCache::configure(size_t capacity, std::chrono::seconds ttl) {
+    shardCapacity_ = std::max<size_t>(1, (capacity + kShardCount - 1) / kShardCount);
+    ttl_ = ttl;
+    clear();
+}
+
+QueryCache::Shard& QueryCache::shardFor(const std::string& key) {
+    return shards_[std::hash<std::string>{}(key) % kShardCount];
+}
+
+QueryCache::Results QueryCache::get(const std::string& key) {
+    Shard& shard = shardFor(key);
+    auto now = std::chrono::steady_clock::now();
+    uint64_t currentGeneration = generation();
+
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    auto entryIt = it->second;
+    if (entryIt->generation != currentGeneration || now - entryIt->storedAt > ttl_) {
+        shard.lru.erase(entryIt);
+        shard.index.erase(it);
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    shard.lru.splice(shard.lru.begin(), shard.lru, entryIt);
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return entryIt->results;
+}
+
+QueryCache::Results QueryCache::put(const std::string& key, SearchPage page, uint64_t generation) {
+    auto shared = std::make_shared<const SearchPage>(std::move(page));
+    if (generation != this->generation()) {
+        return shared;
+    }
+
+    Shard& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+    }
+
+    shard.lru.push_front(Entry{key, shared, std::chrono::steady_clock::now(), generation});
+    shard.index[key] = shard.lru.begin();
+
+    while (shard.lru.size() > shardCapacity_) {
+        shard.index.erase(shard.lru.back().key);
+        shard.lru.pop_back();
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return shared;
+}
+
+bool QueryCache::setGeneration(uint64_t generation) {
+    // Stale entries are dropped lazily on lookup or by LRU eviction
+    return generation_.exchange(generation, std::memory_order_acq_rel) != generation;
+}
+
+void QueryCache::clear() {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        shard.lru.clear();
+        shard.index.clear();
+    }
+}
+
+QueryCacheStats QueryCache::stats() const {
+    QueryCacheStats s;
+    s.hits = hits_.load(std::memory_order_relaxed);
+    s.misses = misses_.load(std::memory_order_relaxed);
+    s.evictions = evictions_.load(std::memory_order_relaxed);
+    s.generation = generation();
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        s.entries += shard.lru.size();
+    }
+    return s;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "database.h"
+
+struct QueryCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t entries = 0;
+    uint64_t generation = 0;
+
+    double hitRate() const {
+        uint64_t total = hits + misses;
+        return total == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(total);
+    }
+};
+
+// Sharded LRU cache: normalized query (ParsedQuery::canonical plus page
+// position) -> result page.
+// An entry is served only while it is younger than the TTL and was stored
+// under the current index generation; the generation is bumped by the
+// spider whenever it finishes indexing a document.
+class QueryCache {
+public:
+    using Results = std::shared_ptr<const SearchPage>;
+
+    void configure(size_t capacity, std::chrono::seconds ttl);
+
+    Results get(const std::string& key);
+    // generation is the value observed before the search was executed, so
+    // results computed against an older index never get stored as fresh
+    Results put(const std::string& key, SearchPage page, uint64_t generation);
+
+    uint64_t generation() const { return generation_.load(std::memory_order_acquire); }
+    // Returns true if the generation changed (all cached entries become stale)
+    bool setGeneration(uint64_t generation);
+    void clear();
+
+    QueryCacheStats stats() const;
+
+    static QueryCache& getInstance() {
+        static QueryCache instance;
+        return instance;
+    }
+
+private:
+    static constexpr size_t kShardCount = 16;
+
+    struct Entry {
+        std::string key;
+        Results results;
+        std::chrono::steady_clock::time_point storedAt;
+        uint64_t generation;
+    };
+
+    struct Shard {
+        mutable std::mutex mtx;
+        std::list<Entry> lru;
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    };
+
+    Shard& shardFor(const std::string& key);
+
+    std::array<Shard, kShardCount> shards_;
+    size_t shardCapacity_ = 256;
+    std::chrono::seconds ttl_{300};
+
+    std::atomic<uint64_t> generation_{0};
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> evictions_{0};
+};
@@ -0,0 +1,700 @@
+#include "query_plan.h"
+#include "tokenizer.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <string_view>
+
+namespace {
+    // Deeper parentheses are ignored, which keeps the recursion bounded
+    constexpr int kMaxNesting = 32;
+
+    struct Token {
+        enum class Type { Word, Phrase, Open, Close, And, Or, Not, End };
+
+        Type type = Type::End;
+        std::string text;
+        uint32_t slop = 0;
+    };
+
+    bool isSpace(char c) {
+        return std::isspace(static_cast<unsigned char>(c)) != 0;
+    }
+
+    std::vector<Token> lex(const std::string& query) {
+        std::vector<Token> tokens;
+        std::vector<bool> opened;   // per open parenthesis: whether it was kept
+        int nesting = 0;
+
+        size_t pos = 0;
+        while (pos < query.size()) {
+            char c = query[pos];
+            if (isSpace(c)) {
+                ++pos;
+                continue;
+            }
+
+            if (c == '(') {
+                ++pos;
+                opened.push_back(nesting < kMaxNesting);
+                if (opened.back()) {
+                    ++nesting;
+                    tokens.push_back(Token{Token::Type::Open, {}, 0});
+                }
+                continue;
+            }
+            if (c == ')') {
+                ++pos;
+                // A stray closing parenthesis is dropped
+                if (!opened.empty()) {
+                    if (opened.back()) {
+                        --nesting;
+                        tokens.push_back(Token{Token::Type::Close, {}, 0});
+                    }
+                    opened.pop_back();
+                }
+                continue;
+            }
+            if (c == '-' && pos + 1 < query.size() && !isSpace(query[pos + 1])) {
+                ++pos;
+                tokens.push_back(Token{Token::Type::Not, {}, 0});
+                continue;
+            }
+
+            if (c == '"') {
+                size_t end = query.find('"', pos + 1);
+                if (end == std::string::npos) end = query.size();
+                Token token{Token::Type::Phrase, query.substr(pos + 1, end - pos - 1), 0};
+                pos = std::min(query.size(), end + 1);
+
+                // "a b"~N allows the terms to be spread over N extra positions
+                if (pos < query.size() && query[pos] == '~') {
+                    size_t digits = pos + 1;
+                    while (digits < query.size() && std::isdigit(static_cast<unsigned char>(query[digits]))) ++digits;
+                    if (digits > pos + 1) {
+                        token.slop = static_cast<uint32_t>(std::min(1000, std::stoi(query.substr(pos + 1, std::min<size_t>(digits - pos - 1, 6)))));
+                    }
+                    pos = digits;
+                }
+                tokens.push_back(std::move(token));
+                continue;
+            }
+
+            size_t end = pos;
+            while (end < query.size() && !isSpace(query[end]) && query[end] != '(' && query[end] != ')' && query[end] != '"') {
+                ++end;
+            }
+            std::string word = query.substr(pos, end - pos);
+            pos = end;
+
+            if (word == "AND") {
+                tokens.push_back(Token{Token::Type::And, {}, 0});
+            } else if (word == "OR") {
+                tokens.push_back(Token{Token::Type::Or, {}, 0});
+            } else if (word == "NOT") {
+                tokens.push_back(Token{Token::Type::Not, {}, 0});
+            } else {
+                tokens.push_back(Token{Token::Type::Word, std::move(word), 0});
+            }
+        }
+
+        tokens.push_back(Token{Token::Type::End, {}, 0});
+        return tokens;
+    }
+
+    std::string canonical(const QueryNode& node) {
+        switch (node.kind) {
+        case QueryNode::Kind::Term:
+            return node.term;
+        case QueryNode::Kind::Phrase: {
+            std::string text = "\"";
+            for (size_t i = 0; i < node.phrase.terms.size(); ++i) {
+                if (i > 0) text += ' ';
+                text += node.phrase.terms[i] + '@' + std::to_string(node.phrase.offsets[i]);
+            }
+            return text + "\"~" + std::to_string(node.phrase.slop);
+        }
+        case QueryNode::Kind::Not:
+            return "(NOT " + canonical(node.children.front()) + ")";
+        case QueryNode::Kind::And:
+        case QueryNode::Kind::Or: {
+            // Operands commute, so their order does not make a new query
+            std::vector<std::string> parts;
+            for (const auto& child : node.children) {
+                parts.push_back(canonical(child));
+            }
+            std::sort(parts.begin(), parts.end());
+            std::string text = node.kind == QueryNode::Kind::And ? "(AND" : "(OR";
+            for (const auto& part : parts) {
+                text += ' ' + part;
+            }
+            return text + ')';
+        }
+        }
+        return {};
+    }
+
+    // Flattens nested groups of the same kind and drops repeated operands
+    std::optional<QueryNode> group(QueryNode::Kind kind, std::vector<QueryNode> operands) {
+        QueryNode node;
+        node.kind = kind;
+        std::vector<std::string> seen;
+        auto add = [&](QueryNode operand) {
+            std::string key = canonical(operand);
+            if (std::find(seen.begin(), seen.end(), key) == seen.end()) {
+                seen.push_back(std::move(key));
+                node.children.push_back(std::move(operand));
+            }
+        };
+        for (auto& operand : operands) {
+            if (operand.kind == kind) {
+                for (auto& child : operand.children) {
+                    add(std::move(child));
+                }
+            } else {
+                add(std::move(operand));
+            }
+        }
+
+        if (node.children.empty()) {
+            return std::nullopt;
+        }
+        if (node.children.size() == 1) {
+            return std::move(node.children.front());
+        }
+        return node;
+    }
+
+    QueryNode term(std::string_view word) {
+        QueryNode node;
+        node.term = std::string(word);
+        return node;
+    }
+
+    class Parser {
+    public:
+        explicit Parser(std::vector<Token> tokens) : tokens_(std::move(tokens)) {}
+
+        std::optional<QueryNode> parse() { return parseOr(); }
+
+    private:
+        const Token& peek() const { return tokens_[pos_]; }
+
+        std::optional<QueryNode> parseOr() {
+            std::vector<QueryNode> operands;
+            while (true) {
+                if (auto operand = parseAnd()) {
+                    operands.push_back(std::move(*operand));
+                }
+                if (peek().type != Token::Type::Or) {
+                    break;
+                }
+                ++pos_;
+            }
+            return group(QueryNode::Kind::Or, std::move(operands));
+        }
+
+        std::optional<QueryNode> parseAnd() {
+            std::vector<QueryNode> operands;
+            while (true) {
+                Token::Type type = peek().type;
+                if (type == Token::Type::End || type == Token::Type::Close || type == Token::Type::Or) {
+                    break;
+                }
+                if (type == Token::Type::And) {
+                    ++pos_;
+                    continue;
+                }
+                if (auto operand = parseUnary()) {
+                    operands.push_back(std::move(*operand));
+                }
+            }
+            return group(QueryNode::Kind::And, std::move(operands));
+        }
+
+        std::optional<QueryNode> parseUnary() {
+            bool negated = false;
+            while (peek().type == Token::Type::Not) {
+                negated = !negated;
+                ++pos_;
+            }
+
+            std::optional<QueryNode> operand = parsePrimary();
+            if (!operand || !negated) {
+                return operand;
+            }
+            QueryNode node;
+            node.kind = QueryNode::Kind::Not;
+            node.children.push_back(std::move(*operand));
+            return node;
+        }
+
+        std::optional<QueryNode> parsePrimary() {
+            const Token& token = peek();
+            const Tokenizer& tokenizer = Tokenizer::getInstance();
+
+            switch (token.type) {
+            case Token::Type::Open: {
+                ++pos_;
+                std::optional<QueryNode> inner = parseOr();
+                if (peek().type == Token::Type::Close) {
+                    ++pos_;
+                }
+                return inner;
+            }
+            case Token::Type::Word: {
+                ++pos_;
+                std::vector<QueryNode> terms;
+                tokenizer.tokenize(token.text, [&](std::string_view word, uint32_t) {
+                    terms.push_back(term(word));
+                });
+                return group(QueryNode::Kind::And, std::move(terms));
+            }
+            case Token::Type::Phrase: {
+                ++pos_;
+                // Positions count every token, so a phrase such as "city of york"
+                // keeps the gap left by the dropped short word
+                QueryNode node;
+                node.kind = QueryNode::Kind::Phrase;
+                tokenizer.tokenize(token.text, [&](std::string_view word, uint32_t position) {
+                    node.phrase.terms.emplace_back(word);
+                    node.phrase.offsets.push_back(position);
+                    node.children.push_back(term(word));
+                });
+                node.phrase.slop = token.slop;
+                if (node.children.size() < 2) {
+                    return group(QueryNode::Kind::And, std::move(node.children));
+                }
+                return node;
+            }
+            default:
+                // An operator with nothing to apply to
+                return std::nullopt;
+            }
+        }
+
+        std::vector<Token> tokens_;
+        size_t pos_ = 0;
+    };
+
+    void collectWords(const QueryNode& node, bool negated, std::vector<std::string>& words) {
+        if (node.kind == QueryNode::Kind::Term) {
+            if (!negated && std::find(words.begin(), words.end(), node.term) == words.end()) {
+                words.push_back(node.term);
+            }
+            return;
+        }
+        for (const auto& child : node.children) {
+            collectWords(child, negated != (node.kind == QueryNode::Kind::Not), words);
+        }
+    }
+}
+
+ParsedQuery QueryParser::parse(const std::string& query) {
+    ParsedQuery parsed;
+    std::optional<QueryNode> root = Parser(lex(query)).parse();
+    if (!root) {
+        return parsed;
+    }
+
+    parsed.root = std::move(*root);
+    parsed.empty = false;
+    collectWords(parsed.root, false, parsed.words);
+    parsed.canonical = canonical(parsed.root);
+
+    if (parsed.root.kind == QueryNode::Kind::Phrase) {
+        parsed.phrases.push_back(parsed.root.phrase);
+    } else if (parsed.root.kind == QueryNode::Kind::And) {
+        for (const auto& child : parsed.root.children) {
+            if (child.kind == QueryNode::Kind::Phrase) {
+                parsed.phrases.push_back(child.phrase);
+            }
+        }
+    }
+    return parsed;
+}
+
+QueryPlan::QueryPlan(const QueryNode& root, const std::unordered_map<std::string, TermStats>& stats)
+    : root_(compile(root, stats))
+{
+    // Negations and constants cannot enumerate documents
+    if (root_.kind == Node::Kind::False || std::isinf(root_.cost)) {
+        return;
+    }
+
+    collectDriver(root_, driver_);
+    std::sort(driver_.begin(), driver_.end());
+    driver_.erase(std::unique(driver_.begin(), driver_.end()), driver_.end());
+
+    exactDriver_ = exact(root_);
+    if (!exactDriver_ && root_.kind == Node::Kind::And && exact(root_.children.front())) {
+        skipChild_ = 0;
+    }
+
+    std::vector<int> positive;
+    collectPositive(root_, false, positive);
+    std::sort(positive.begin(), positive.end());
+    positive.erase(std::unique(positive.begin(), positive.end()), positive.end());
+    std::set_difference(positive.begin(), positive.end(), driver_.begin(), driver_.end(), std::back_inserter(extra_));
+}
+
+QueryPlan::Node QueryPlan::compile(const QueryNode& node, const std::unordered_map<std::string, TermStats>& stats) {
+    const double infinite = std::numeric_limits<double>::infinity();
+    Node constant;
+    constant.cost = infinite;
+
+    switch (node.kind) {
+    case QueryNode::Kind::Term: {
+        auto it = stats.find(node.term);
+        if (it == stats.end() || it->second.documents == 0) {
+            constant.kind = Node::Kind::False;
+            constant.term = node.term;
+            return constant;
+        }
+        Node out;
+        out.kind = Node::Kind::Term;
+        out.wordId = it->second.wordId;
+        out.term = node.term;
+        out.cost = static_cast<double>(it->second.documents);
+        return out;
+    }
+
+    case QueryNode::Kind::Phrase:
+    case QueryNode::Kind::And: {
+        Node out;
+        out.kind = Node::Kind::And;
+        for (const auto& child : node.children) {
+            Node compiled = compile(child, stats);
+            if (compiled.kind == Node::Kind::False) {
+                return compiled;
+            }
+            if (compiled.kind == Node::Kind::And) {
+                // A phrase inside an AND is just more operands
+                for (auto& grandchild : compiled.children) {
+                    out.children.push_back(std::move(grandchild));
+                }
+            } else if (compiled.kind != Node::Kind::True) {
+                out.children.push_back(std::move(compiled));
+            }
+        }
+        if (out.children.empty()) {
+            constant.kind = Node::Kind::True;
+            return constant;
+        }
+        if (out.children.size() == 1) {
+            return std::move(out.children.front());
+        }
+
+        // Rarest first: it drives, and it rejects most candidates soonest
+        std::stable_sort(out.children.begin(), out.children.end(), [](const Node& a, const Node& b) {
+            return a.cost < b.cost;
+        });
+        out.cost = out.children.front().cost;
+        return out;
+    }
+
+    case QueryNode::Kind::Or: {
+        Node out;
+        out.kind = Node::Kind::Or;
+        for (const auto& child : node.children) {
+            Node compiled = compile(child, stats);
+            if (compiled.kind == Node::Kind::True) {
+                return compiled;
+            }
+            if (compiled.kind == Node::Kind::Or) {
+                for (auto& grandchild : compiled.children) {
+                    out.children.push_back(std::move(grandchild));
+                }
+            } else if (compiled.kind != Node::Kind::False) {
+                out.children.push_back(std::move(compiled));
+            }
+        }
+        if (out.children.empty()) {
+            constant.kind = Node::Kind::False;
+            return constant;
+        }
+        if (out.children.size() == 1) {
+            return std::move(out.children.front());
+        }
+
+        // Most frequent first: it accepts most candidates soonest
+        std::stable_sort(out.children.begin(), out.children.end(), [](const Node& a, const Node& b) {
+            return a.cost > b.cost;
+        });
+        for (const auto& child : out.children) {
+            out.cost += child.cost;
+        }
+        return out;
+    }
+
+    case QueryNode::Kind::Not: {
+        Node compiled = compile(node.children.front(), stats);
+        if (compiled.kind == Node::Kind::True || compiled.kind == Node::Kind::False) {
+            constant.kind = compiled.kind == Node::Kind::True ? Node::Kind::False : Node::Kind::True;
+            return constant;
+        }
+        Node out;
+        out.kind = Node::Kind::Not;
+        out.cost = infinite;
+        out.children.push_back(std::move(compiled));
+        return out;
+    }
+    }
+    return constant;
+}
+
+void QueryPlan::collectDriver(const Node& node, std::vector<int>& wordIds) {
+    switch (node.kind) {
+    case Node::Kind::Term:
+        wordIds.push_back(node.wordId);
+        break;
+    case Node::Kind::And:
+        collectDriver(node.children.front(), wordIds);
+        break;
+    case Node::Kind::Or:
+        for (const auto& child : node.children) {
+            collectDriver(child, wordIds);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void QueryPlan::collectPositive(const Node& node, bool negated, std::vector<int>& wordIds) {
+    if (node.kind == Node::Kind::Term) {
+        if (!negated) {
+            wordIds.push_back(node.wordId);
+        }
+        return;
+    }
+    for (const auto& child : node.children) {
+        collectPositive(child, negated != (node.kind == Node::Kind::Not), wordIds);
+    }
+}
+
+bool QueryPlan::exact(const Node& node) {
+    if (node.kind == Node::Kind::Term) {
+        return true;
+    }
+    if (node.kind != Node::Kind::Or) {
+        return false;
+    }
+    return std::all_of(node.children.begin(), node.children.end(), [](const Node& child) { return exact(child); });
+}
+
+std::string QueryPlan::condition(const Node& node, const Node* skip) {
+    switch (node.kind) {
+    case Node::Kind::Term:
+        return "EXISTS (SELECT 1 FROM word_frequencies f WHERE f.document_id = c.document_id AND f.word_id = "
+            + std::to_string(node.wordId) + ")";
+    case Node::Kind::Not:
+        return "NOT " + condition(node.children.front(), nullptr);
+    case Node::Kind::And:
+    case Node::Kind::Or: {
+        std::string text;
+        for (const auto& child : node.children) {
+            if (&child == skip) {
+                continue;
+            }
+            if (!text.empty()) {
+                text += node.kind == Node::Kind::And ? " AND " : " OR ";
+            }
+            text += condition(child, nullptr);
+        }
+        return text.empty() ? "TRUE" : "(" + text + ")";
+    }
+    case Node::Kind::True:
+        return "TRUE";
+    case Node::Kind::False:
+        return "FALSE";
+    }
+    return "FALSE";
+}
+
+std::string QueryPlan::driverSql() const {
+    auto list = [](const std::vector<int>& ids) {
+        std::string text;
+        for (int id : ids) {
+            if (!text.empty()) text += ", ";
+            text += std::to_string(id);
+        }
+        return text;
+    };
+
+    if (driver_.size() == 1) {
+        return "SELECT document_id, frequency::bigint AS score FROM word_frequencies WHERE word_id = "
+            + std::to_string(driver_.front());
+    }
+    return "SELECT document_id, SUM(frequency) AS score FROM word_frequencies WHERE word_id IN ("
+        + list(driver_) + ") GROUP BY document_id";
+}
+
+std::string QueryPlan::filterSql() const {
+    if (exactDriver_) {
+        return "TRUE";
+    }
+    return condition(root_, skipChild_ >= 0 ? &root_.children[static_cast<size_t>(skipChild_)] : nullptr);
+}
+
+std::string QueryPlan::extraScoreSql() const {
+    if (extra_.empty()) {
+        return {};
+    }
+    std::string ids;
+    for (int id : extra_) {
+        if (!ids.empty()) ids += ", ";
+        ids += std::to_string(id);
+    }
+    return "COALESCE((SELECT SUM(s.frequency) FROM word_frequencies s "
+           "WHERE s.document_id = c.document_id AND s.word_id IN (" + ids + ")), 0)";
+}
+
+std::vector<PlanMatch> QueryPlan::execute(PostingSource& source) const {
+    std::vector<PlanMatch> matches;
+    if (matchesNothing()) {
+        return matches;
+    }
+
+    std::vector<Posting> postings;
+    for (int wordId : driver_) {
+        std::vector<Posting> loaded = source.load(wordId, nullptr);
+        postings.insert(postings.end(), loaded.begin(), loaded.end());
+    }
+    if (driver_.size() > 1) {
+        std::sort(postings.begin(), postings.end(), [](const Posting& a, const Posting& b) {
+            return a.documentId < b.documentId;
+        });
+    }
+    for (const auto& posting : postings) {
+        if (!matches.empty() && matches.back().documentId == posting.documentId) {
+            matches.back().score += posting.frequency;
+        } else {
+            matches.push_back({posting.documentId, posting.frequency});
+        }
+    }
+
+    auto documentsOf = [&matches] {
+        std::vector<uint32_t> documents;
+        documents.reserve(matches.size());
+        for (const auto& match : matches) {
+            documents.push_back(match.documentId);
+        }
+        return documents;
+    };
+
+    if (!exactDriver_ && !matches.empty()) {
+        const Node* skip = skipChild_ >= 0 ? &root_.children[static_cast<size_t>(skipChild_)] : nullptr;
+        std::vector<char> keep = evaluate(root_, skip, documentsOf(), source);
+        size_t kept = 0;
+        for (size_t i = 0; i < matches.size(); ++i) {
+            if (keep[i]) {
+                matches[kept++] = matches[i];
+            }
+        }
+        matches.resize(kept);
+    }
+
+    if (!extra_.empty() && !matches.empty()) {
+        std::vector<uint32_t> documents = documentsOf();
+        for (int wordId : extra_) {
+            std::vector<Posting> loaded = source.load(wordId, &documents);
+            auto it = loaded.begin();
+            for (auto& match : matches) {
+                while (it != loaded.end() && it->documentId < match.documentId) ++it;
+                if (it != loaded.end() && it->documentId == match.documentId) {
+                    match.score += it->frequency;
+                }
+            }
+        }
+    }
+    return matches;
+}
+
+std::vector<char> QueryPlan::evaluate(const Node& node, const Node* skip,
+    const std::vector<uint32_t>& documents, PostingSource& source) {
+    std::vector<char> result(documents.size(), 0);
+
+    switch (node.kind) {
+    case Node::Kind::Term: {
+        std::vector<Posting> postings = source.load(node.wordId, &documents);
+        auto it = postings.begin();
+        for (size_t i = 0; i < documents.size(); ++i) {
+            while (it != postings.end() && it->documentId < documents[i]) ++it;
+            result[i] = it != postings.end() && it->documentId == documents[i];
+        }
+        break;
+    }
+    case Node::Kind::Not:
+        result = evaluate(node.children.front(), nullptr, documents, source);
+        for (auto& value : result) {
+            value = !value;
+        }
+        break;
+    case Node::Kind::And:
+    case Node::Kind::Or: {
+        // AND rules documents out, OR lets them in; an operand only sees
+        // the documents the earlier ones left undecided
+        bool isAnd = node.kind == Node::Kind::And;
+        std::fill(result.begin(), result.end(), isAnd);
+        for (const auto& child : node.children) {
+            if (&child == skip) {
+                continue;
+            }
+            std::vector<size_t> open;
+            std::vector<uint32_t> undecided;
+            for (size_t i = 0; i < documents.size(); ++i) {
+                if (static_cast<bool>(result[i]) == isAnd) {
+                    open.push_back(i);
+                    undecided.push_back(documents[i]);
+                }
+            }
+            if (undecided.empty()) {
+                break;
+            }
+            std::vector<char> matched = evaluate(child, nullptr, undecided, source);
+            for (size_t j = 0; j < open.size(); ++j) {
+                if (static_cast<bool>(matched[j]) != isAnd) {
+                    result[open[j]] = !isAnd;
+                }
+            }
+        }
+        break;
+    }
+    case Node::Kind::True:
+        std::fill(result.begin(), result.end(), 1);
+        break;
+    case Node::Kind::False:
+        break;
+    }
+    return result;
+}
+
+std::string QueryPlan::describe() const {
+    return describe(root_);
+}
+
+std::string QueryPlan::describe(const Node& node) {
+    switch (node.kind) {
+    case Node::Kind::Term:
+        return node.term + "[" + std::to_string(static_cast<long long>(node.cost)) + "]";
+    case Node::Kind::Not:
+        return "NOT " + describe(node.children.front());
+    case Node::Kind::And:
+    case Node::Kind::Or: {
+        std::string text = node.kind == Node::Kind::And ? "AND(" : "OR(";
+        for (size_t i = 0; i < node.children.size(); ++i) {
+            if (i > 0) text += ", ";
+            text += describe(node.children[i]);
+        }
+        return text + ")";
+    }
+    case Node::Kind::True:
+        return "TRUE";
+    case Node::Kind::False:
+        return node.term.empty() ? "FALSE" : node.term + "[0]";
+    }
+    return {};
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "posting_block.h"
+
+// Quoted part of a query: "new york" must match adjacent terms,
+// "new york"~N lets them spread over N extra positions in any order
+struct QueryPhrase {
+    std::vector<std::string> terms;     // indexable terms only
+    std::vector<uint32_t> offsets;      // token position of each term inside the quotes
+    uint32_t slop = 0;
+};
+
+// Boolean query tree. Adjacent operands are ANDed; AND, OR and NOT (upper
+// case), parentheses and a leading '-' are operators.
+struct QueryNode {
+    enum class Kind { Term, Phrase, And, Or, Not };
+
+    Kind kind = Kind::Term;
+    std::string term;                   // Term
+    QueryPhrase phrase;                 // Phrase; its terms are also the children
+    std::vector<QueryNode> children;    // Phrase, And, Or, Not (one child)
+};
+
+struct ParsedQuery {
+    QueryNode root;
+    bool empty = true;                  // nothing searchable in the query
+    std::vector<std::string> words;     // terms not under a NOT, deduplicated
+    // Phrases every result must contain, checked against term positions.
+    // Other phrases (under OR or NOT) only require their terms.
+    std::vector<QueryPhrase> phrases;
+    std::string canonical;              // normalized form, equal for equivalent queries
+};
+
+class QueryParser {
+public:
+    // Terms go through the index tokenizer, so "e-mail" is e AND mail and
+    // stop words disappear. Never fails: stray operators and unbalanced
+    // parentheses are ignored.
+    static ParsedQuery parse(const std::string& query);
+};
+
+struct TermStats {
+    int wordId = 0;
+    long long documents = 0;            // document frequency, capped by the lookup
+};
+
+// Postings of one term in a block index, sorted by document id. When
+// documents (sorted) is given only those matter: the source may skip
+// blocks that hold none of them and may return postings of others.
+class PostingSource {
+public:
+    virtual ~PostingSource() = default;
+    virtual std::vector<Posting> load(int wordId, const std::vector<uint32_t>* documents) = 0;
+};
+
+struct PlanMatch {
+    uint32_t documentId;
+    long long score;
+};
+
+// Execution plan of a query against one index database. Every AND is
+// ordered by document frequency, rarest first: the cheapest operand of the
+// root drives (its postings are the candidates) and the rest are checked
+// per candidate through the (document_id, word_id) key, so a frequent term
+// costs one probe per candidate instead of a scan of its postings. ORs
+// try their most frequent operand first.
+class QueryPlan {
+public:
+    // Terms missing from stats are not in the index
+    QueryPlan(const QueryNode& root, const std::unordered_map<std::string, TermStats>& stats);
+
+    // Nothing can match: an unknown required term, or only negations
+    bool matchesNothing() const { return driver_.empty(); }
+
+    // SELECT document_id, score: candidate documents with the summed
+    // frequencies of the driving terms
+    std::string driverSql() const;
+    // Boolean condition on candidate alias c, "TRUE" when the driver is exact
+    std::string filterSql() const;
+    // Frequencies of the other positive terms, to add to c.score; empty if none
+    std::string extraScoreSql() const;
+
+    // The same plan run in memory over posting blocks: every match with
+    // the summed frequencies of its positive terms, by document id
+    std::vector<PlanMatch> execute(PostingSource& source) const;
+
+    std::string describe() const;
+
+private:
+    struct Node {
+        enum class Kind { Term, And, Or, Not, True, False };
+
+        Kind kind = Kind::True;
+        int wordId = 0;
+        std::string term;
+        double cost = 0;                // candidates it yields as a driver; infinite if it cannot drive
+        std::vector<Node> children;
+    };
+
+    static Node compile(const QueryNode& node, const std::unordered_map<std::string, TermStats>& stats);
+    static void collectDriver(const Node& node, std::vector<int>& wordIds);
+    static void collectPositive(const Node& node, bool negated, std::vector<int>& wordIds);
+    static bool exact(const Node& node);
+    static std::string condition(const Node& node, const Node* skip);
+    // Per document, whether it satisfies node
+    static std::vector<char> evaluate(const Node& node, const Node* skip,
+        const std::vector<uint32_t>& documents, PostingSource& source);
+    static std::string describe(const Node& node);
+
+    Node root_;
+    bool exactDriver_ = false;          // the candidates are exactly the matches
+    int skipChild_ = -1;                // root AND operand the driver already guarantees
+    std::vector<int> driver_;
+    std::vector<int> extra_;
+};
@@ -0,0 +1,140 @@
+#include "request_metrics.h"
+#include "config.h"
+#include "json_writer.h"
+#include <algorithm>
+#include <ctime>
+
+const char* routeName(Route route) {
+    switch (route) {
+    case Route::Landing: return "/";
+    case Route::SearchPage: return "POST /";
+    case Route::ApiSearch: return "/api/search";
+    case Route::ApiSuggest: return "/api/suggest";
+    case Route::Metrics: return "/metrics";
+    case Route::DebugSlow: return "/debug/slow";
+    default: return "other";
+    }
+}
+
+namespace {
+    bool slowerThan(const RequestTrace& a, const RequestTrace& b) {
+        return a.totalMs > b.totalMs;
+    }
+
+    uint64_t toMicros(double ms) {
+        return ms > 0 ? static_cast<uint64_t>(ms * 1000.0) : 0;
+    }
+}
+
+void SlowQueryLog::add(const RequestTrace& trace) {
+    if (capacity_ == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (heap_.size() < capacity_) {
+        heap_.push_back(trace);
+        std::push_heap(heap_.begin(), heap_.end(), slowerThan);
+    } else if (trace.totalMs > heap_.front().totalMs) {
+        std::pop_heap(heap_.begin(), heap_.end(), slowerThan);
+        heap_.back() = trace;
+        std::push_heap(heap_.begin(), heap_.end(), slowerThan);
+    }
+}
+
+std::vector<RequestTrace> SlowQueryLog::slowest() const {
+    std::vector<RequestTrace> out;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        out = heap_;
+    }
+    std::sort(out.begin(), out.end(), slowerThan);
+    return out;
+}
+
+RequestMetrics::RequestMetrics()
+    : connections_(metrics::Registry::getInstance().gauge(
+        "http_connections_in_flight", "Open client connections"))
+    , requests_(metrics::Registry::getInstance().gauge(
+        "http_requests_in_flight", "Requests read but not yet fully written"))
+    , slowLog_(static_cast<size_t>(std::max(0, Config::getInstance().getInt("server", "slow_log_size", 50))))
+{
+    auto& registry = metrics::Registry::getInstance();
+
+    for (size_t r = 0; r < kRoutes; ++r) {
+        std::string route = std::string("route=\"") + routeName(static_cast<Route>(r)) + "\"";
+        routeLatency_[r] = &registry.histogram("http_request_duration_seconds",
+            "Time from accepting a request to the last byte written", route);
+        for (size_t c = 0; c < 5; ++c) {
+            responses_[r][c] = &registry.counter("http_responses_total",
+                "Responses by route and status class", route + ",code=\"" + std::to_string(c + 1) + "xx\"");
+        }
+    }
+
+    static const char* const kStageNames[StageCount] = {
+        "read", "queue", "parse", "index", "snippets", "render", "write",
+    };
+    for (size_t s = 0; s < StageCount; ++s) {
+        stageLatency_[s] = &registry.histogram("http_stage_duration_seconds",
+            "Time spent per request stage", std::string("stage=\"") + kStageNames[s] + "\"");
+    }
+}
+
+void RequestMetrics::requestFinished(const RequestTrace& trace) {
+    requests_.add(-1);
+
+    size_t route = static_cast<size_t>(trace.route);
+    routeLatency_[route]->record(toMicros(trace.totalMs));
+    if (trace.status >= 100 && trace.status < 600) {
+        responses_[route][trace.status / 100 - 1]->add();
+    }
+
+    stageLatency_[Read]->record(toMicros(trace.readMs));
+    stageLatency_[Write]->record(toMicros(trace.writeMs));
+
+    bool searched = trace.route == Route::SearchPage || trace.route == Route::ApiSearch;
+    if (searched) {
+        stageLatency_[Queue]->record(toMicros(trace.search.queueMs));
+        stageLatency_[Parse]->record(toMicros(trace.search.parseMs));
+        stageLatency_[Index]->record(toMicros(trace.search.retrieveMs + trace.search.rankMs));
+        stageLatency_[Snippets]->record(toMicros(trace.search.snippetMs));
+        slowLog_.add(trace);
+    }
+    stageLatency_[Render]->record(toMicros(trace.renderMs));
+}
+
+void RequestMetrics::renderPrometheus(std::string& out) const {
+    metrics::Registry::getInstance().renderPrometheus(out);
+}
+
+void RequestMetrics::renderSlowLog(std::string& out) const {
+    JsonWriter json(out);
+    json.beginObject().key("slowest").beginArray();
+
+    for (const auto& trace : slowLog_.slowest()) {
+        std::time_t finished = std::chrono::system_clock::to_time_t(trace.finishedAt);
+        char when[32];
+        std::strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&finished));
+
+        json.beginObject()
+            .key("route").value(routeName(trace.route))
+            .key("query").value(trace.query)
+            .key("status").value(trace.status)
+            .key("finished_at").value(when)
+            .key("cached").value(trace.search.cached)
+            .key("total_ms").value(trace.totalMs)
+            .key("stages_ms").beginObject()
+                .key("read").value(trace.readMs)
+                .key("queue").value(trace.search.queueMs)
+                .key("parse").value(trace.search.parseMs)
+                .key("retrieve").value(trace.search.retrieveMs)
+                .key("rank").value(trace.search.rankMs)
+                .key("snippets").value(trace.search.snippetMs)
+                .key("render").value(trace.renderMs)
+                .key("write").value(trace.writeMs)
+            .endObject()
+            .endObject();
+    }
+
+    json.endArray().endObject();
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "database.h"
+#include "metrics.h"
+
+enum class Route { Landing, SearchPage, ApiSearch, ApiSuggest, Metrics, DebugSlow, Other, Count };
+
+const char* routeName(Route route);
+
+// Timeline of one request, filled in as it moves through HttpConnection
+struct RequestTrace {
+    Route route = Route::Other;
+    std::string query;          // search routes only
+    int status = 0;
+    double readMs = 0;          // request read, from accept
+    SearchTimings search;       // queue / parse / retrieve / rank / snippets, when a search ran
+    double renderMs = 0;        // HTML or JSON body
+    double writeMs = 0;
+    double totalMs = 0;
+    std::chrono::system_clock::time_point finishedAt;
+};
+
+// Keeps the slowest N search requests seen so far, with their stage
+// breakdown; a new trace only evicts the fastest one kept
+class SlowQueryLog {
+public:
+    explicit SlowQueryLog(size_t capacity) : capacity_(capacity) {}
+
+    void add(const RequestTrace& trace);
+    std::vector<RequestTrace> slowest() const;     // slowest first
+
+private:
+    size_t capacity_;
+    mutable std::mutex mtx_;
+    std::vector<RequestTrace> heap_;   // min-heap on totalMs
+};
+
+// Server metrics: per-route latency and status classes, per-stage latency,
+// in-flight connections and requests, plus the slow query log
+class RequestMetrics {
+public:
+    void connectionOpened() { connections_.add(1); }
+    void connectionClosed() { connections_.add(-1); }
+    void requestStarted() { requests_.add(1); }
+    void requestFinished(const RequestTrace& trace);
+
+    void renderPrometheus(std::string& out) const;
+    void renderSlowLog(std::string& out) const;
+
+    static RequestMetrics& getInstance() {
+        static RequestMetrics instance;
+        return instance;
+    }
+
+private:
+    RequestMetrics();
+
+    enum Stage { Read, Queue, Parse, Index, Snippets, Render, Write, StageCount };
+    static constexpr size_t kRoutes = static_cast<size_t>(Route::Count);
+
+    metrics::Gauge& connections_;
+    metrics::Gauge& requests_;
+    std::array<metrics::Histogram*, kRoutes> routeLatency_{};
+    std::array<std::array<metrics::Counter*, 5>, kRoutes> responses_{};   // 1xx..5xx
+    std::array<metrics::Histogram*, StageCount> stageLatency_{};
+    SlowQueryLog slowLog_;
+};
@@ -0,0 +1,100 @@
+#include "search_admission.h"
+#include <algorithm>
+#include <iostream>
+
+SearchAdmission& SearchAdmission::getInstance() {
+    static SearchAdmission instance;
+    return instance;
+}
+
+SearchAdmission::SearchAdmission()
+    : queued_(metrics::Registry::getInstance().gauge(
+        "search_queue_depth", "Searches waiting for a worker"))
+    , active_(metrics::Registry::getInstance().gauge(
+        "search_active", "Searches executing on workers"))
+    , rejected_(metrics::Registry::getInstance().counter("search_shed_total",
+        "Searches answered with 503 without running", "reason=\"queue_full\""))
+    , expired_(metrics::Registry::getInstance().counter("search_shed_total",
+        "Searches answered with 503 without running", "reason=\"expired\""))
+    , timeouts_(metrics::Registry::getInstance().counter("search_timeouts_total",
+        "Searches cancelled when their time budget ran out"))
+    , wait_(metrics::Registry::getInstance().histogram("search_queue_wait_seconds",
+        "Time a search waited for a worker"))
+{
+}
+
+SearchAdmission::~SearchAdmission() {
+    stopWorkers();
+}
+
+void SearchAdmission::configure(size_t workers, size_t queueCapacity) {
+    stopWorkers();
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    queueCapacity_ = queueCapacity;
+    stopping_ = false;
+    workers = std::max<size_t>(1, workers);
+    for (size_t i = 0; i < workers; ++i) {
+        workers_.emplace_back([this] { work(); });
+    }
+    std::cout << "🚦 " << workers << " search workers, queue of " << queueCapacity << std::endl;
+}
+
+bool SearchAdmission::submit(Job job) {
+    job.queuedAt = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mtx_);
+    // Jobs up to the number of idle workers are taken straight away and
+    // do not count against the queue
+    if (queue_.size() >= idle_ + queueCapacity_) {
+        lock.unlock();
+        rejected_.add();
+        return false;
+    }
+    queue_.push_back(std::move(job));
+    queued_.set(static_cast<int64_t>(queue_.size()));
+    lock.unlock();
+    cv_.notify_one();
+    return true;
+}
+
+void SearchAdmission::work() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (true) {
+        ++idle_;
+        cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+        --idle_;
+        if (stopping_) {
+            return;
+        }
+        Job job = std::move(queue_.front());
+        queue_.pop_front();
+        queued_.set(static_cast<int64_t>(queue_.size()));
+        lock.unlock();
+
+        auto now = std::chrono::steady_clock::now();
+        wait_.record(now - job.queuedAt);
+        if (now >= job.deadline) {
+            // Its client is better served by a quick 503 than a late answer
+            expired_.add();
+            job.expired();
+        } else {
+            active_.add(1);
+            job.run();
+            active_.add(-1);
+        }
+
+        lock.lock();
+    }
+}
+
+void SearchAdmission::stopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+}
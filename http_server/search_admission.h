@@ -0,0 +1,61 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "metrics.h"
+
+// Admission control for searches. At most `workers` searches execute at
+// once, each on a worker thread; up to `queue` more wait in FIFO order.
+// A search arriving while a worker is idle is always admitted, so a queue
+// of 0 means "no waiting" rather than "no searches". A search that finds
+// the queue full, or whose deadline passes while it
+// waits, is shed straight away so the server can answer 503 instead of
+// letting every request slow down under overload.
+class SearchAdmission {
+public:
+    struct Job {
+        std::chrono::steady_clock::time_point deadline;
+        std::function<void()> run;          // on a worker thread
+        std::function<void()> expired;      // on a worker thread, instead of run
+        std::chrono::steady_clock::time_point queuedAt;     // set by submit
+    };
+
+    static SearchAdmission& getInstance();
+
+    void configure(size_t workers, size_t queueCapacity);
+
+    // False when no worker is idle and the queue is full; the job is then
+    // dropped without running
+    bool submit(Job job);
+
+    // A search that ran out of its time budget while executing
+    void recordTimeout() { timeouts_.add(); }
+
+    ~SearchAdmission();
+
+private:
+    SearchAdmission();
+
+    void work();
+    void stopWorkers();
+
+    size_t queueCapacity_ = 0;
+    size_t idle_ = 0;           // workers waiting for a job
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<Job> queue_;
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+
+    metrics::Gauge& queued_;
+    metrics::Gauge& active_;
+    metrics::Counter& rejected_;
+    metrics::Counter& expired_;
+    metrics::Counter& timeouts_;
+    metrics::Histogram& wait_;
+};
@@ -0,0 +1,91 @@
+#include "search_json.h"
+#include <algorithm>
+#include <chrono>
+
+SearchJsonSerializer::SearchJsonSerializer(std::string& out, const SearchRequest& request,
+    QueryCache::Results page, const SearchTimings& timings)
+    : out_(out)
+    , json_(out)
+    , request_(request)
+    , page_(std::move(page))
+    , timings_(timings)
+{
+}
+
+bool SearchJsonSerializer::writeNext(size_t maxResults) {
+    if (finished_) {
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    const auto& results = page_->results;
+
+    if (!started_) {
+        // Typical result objects with a snippet are ~500 bytes; reserve once instead of regrowing
+        out_.reserve(out_.size() + 256 + std::min(maxResults, results.size()) * 500);
+        json_.beginObject()
+            .key("query").value(request_.query)
+            .key("page").value(request_.page)
+            .key("k").value(request_.size)
+            .key("count").value(static_cast<long long>(results.size()))
+            .key("results").beginArray();
+        started_ = true;
+    }
+
+    size_t end = std::min(results.size(), position_ + std::max<size_t>(1, maxResults));
+    for (; position_ < end; ++position_) {
+        const SearchResult& result = results[position_];
+        json_.beginObject()
+            .key("id").value(result.documentId)
+            .key("url").value(result.url)
+            .key("title").value(result.title)
+            .key("relevance").value(result.relevance)
+            .key("snippet");
+        if (result.snippet.empty()) {
+            json_.null();
+        } else {
+            json_.value(result.snippet);
+        }
+        json_.key("highlights").beginArray();
+        for (const auto& [offset, length] : result.highlights) {
+            json_.beginArray()
+                .value(static_cast<long long>(offset))
+                .value(static_cast<long long>(length))
+                .endArray();
+        }
+        json_.endArray().endObject();
+    }
+
+    timings_.serializeMs += std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    if (position_ < results.size()) {
+        return true;
+    }
+
+    json_.endArray().key("next_cursor");
+    if (page_->nextCursor.empty())
+        json_.null();
+    else
+        json_.value(page_->nextCursor);
+
+    json_.key("partial").value(page_->partial)
+        .key("cached").value(timings_.cached)
+        .key("timings_ms").beginObject()
+            .key("queue").value(timings_.queueMs)
+            .key("parse").value(timings_.parseMs)
+            .key("retrieve").value(timings_.retrieveMs)
+            .key("rank").value(timings_.rankMs)
+            .key("snippets").value(timings_.snippetMs)
+            .key("serialize").value(timings_.serializeMs)
+        .endObject()
+        .endObject();
+
+    finished_ = true;
+    return false;
+}
+
+void SearchJsonSerializer::writeAll() {
+    while (writeNext(page_->results.size())) {
+    }
+}
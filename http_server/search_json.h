@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include "json_writer.h"
+#include "search_service.h"
+
+// Serializes a search page as JSON in resumable steps, so the same code
+// can fill one response buffer or produce the chunks of a streamed reply.
+// Timings are emitted last, after serialization itself has been measured.
+class SearchJsonSerializer {
+public:
+    SearchJsonSerializer(std::string& out, const SearchRequest& request,
+        QueryCache::Results page, const SearchTimings& timings);
+
+    // Appends up to maxResults further results (plus the envelope as needed)
+    // to out; returns false once the document is complete
+    bool writeNext(size_t maxResults);
+    void writeAll();
+
+    size_t resultCount() const { return page_->results.size(); }
+
+private:
+    std::string& out_;
+    JsonWriter json_;
+    SearchRequest request_;
+    QueryCache::Results page_;
+    SearchTimings timings_;
+    size_t position_ = 0;
+    bool started_ = false;
+    bool finished_ = false;
+};
@@ -0,0 +1,130 @@
+#include "search_service.h"
+#include "config.h"
+#include "shard_broker.h"
+#include "snippets.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+    double elapsedMs(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+SearchService::Prepared SearchService::prepare(const SearchRequest& request, SearchTimings* timings) {
+    auto start = std::chrono::steady_clock::now();
+
+    Prepared prepared;
+    prepared.hasCursor = !request.cursor.empty();
+    if (prepared.hasCursor && !SearchCursor::decode(request.cursor, prepared.after)) {
+        throw std::invalid_argument("Invalid cursor");
+    }
+
+    prepared.query = QueryParser::parse(request.query);
+    prepared.size = static_cast<size_t>(std::max(1, request.size));
+    prepared.cacheKey = prepared.query.canonical;
+    prepared.cacheKey += '|' + std::to_string(prepared.size) + '|' + request.cursor;
+
+    if (timings) {
+        timings->parseMs += elapsedMs(start);
+    }
+    return prepared;
+}
+
+QueryCache::Results SearchService::cached(const Prepared& prepared, SearchTimings* timings) {
+    auto start = std::chrono::steady_clock::now();
+
+    QueryCache::Results page = QueryCache::getInstance().get(prepared.cacheKey);
+    if (timings) {
+        timings->retrieveMs += elapsedMs(start);
+        timings->cached = page != nullptr;
+    }
+    if (page) {
+        std::cout << "⚡ Cache hit for '" << prepared.cacheKey << "'" << std::endl;
+    }
+    return page;
+}
+
+QueryCache::Results SearchService::execute(const SearchRequest& request, const Prepared& prepared,
+    SearchTimings* timings) {
+    const ParsedQuery& query = prepared.query;
+    const SearchCursor* after = prepared.hasCursor ? &prepared.after : nullptr;
+
+    QueryCache& cache = QueryCache::getInstance();
+    uint64_t generation = cache.generation();
+    SearchPage fresh;
+    bool snippets = true;
+    ShardBroker& broker = ShardBroker::getInstance();
+    if (query.words.empty()) {
+        // nothing to search for
+    } else if (broker.enabled()) {
+        fresh = broker.search(query, prepared.size, after, timings, request.deadline);
+        snippets = attachSnippets([&broker](const std::vector<int>& ids,
+            std::chrono::steady_clock::time_point deadline, bool& complete) {
+            return broker.loadDocumentTexts(ids, deadline, &complete);
+        }, query, request.deadline, fresh, timings);
+    } else {
+        SearchDatabase& db = localDatabase();
+        fresh = db.search(query, prepared.size, after, timings, request.deadline);
+        snippets = attachSnippets([&db](const std::vector<int>& ids,
+            std::chrono::steady_clock::time_point deadline, bool&) {
+            return db.loadDocumentTexts(ids, deadline);
+        }, query, request.deadline, fresh, timings);
+    }
+
+    // Pages missing a shard or some snippets are served but never cached
+    if (fresh.partial || !snippets) {
+        return std::make_shared<const SearchPage>(std::move(fresh));
+    }
+    return cache.put(prepared.cacheKey, std::move(fresh), generation);
+}
+
+SearchDatabase& SearchService::localDatabase() {
+    // Search workers are long-lived, so each keeps one connection instead
+    // of opening a new one per search
+    thread_local std::unique_ptr<SearchDatabase> db;
+    if (db && db->isOpen()) {
+        return *db;
+    }
+    db = std::make_unique<SearchDatabase>(SearchDatabase::connectionString());
+    return *db;
+}
+
+bool SearchService::attachSnippets(const TextLoader& loadTexts, const ParsedQuery& query,
+    std::chrono::steady_clock::time_point searchDeadline, SearchPage& page, SearchTimings* timings) {
+    Config& config = Config::getInstance();
+    size_t maxResults = static_cast<size_t>(std::max(0, config.getInt("server", "snippet_results", 50)));
+    if (page.results.empty() || maxResults == 0) {
+        return true;
+    }
+
+    // The budget covers loading the texts too; results past it go without a snippet
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = std::min(searchDeadline,
+        start + std::chrono::milliseconds(config.getInt("server", "snippet_budget_ms", 25)));
+
+    std::vector<int> ids;
+    for (size_t i = 0; i < page.results.size() && i < maxResults; ++i) {
+        ids.push_back(page.results[i].documentId);
+    }
+
+    bool complete = true;
+    try {
+        auto texts = loadTexts(ids, deadline, complete);
+        complete = SnippetBuilder::fill(page.results, query.words, texts, deadline) && complete;
+    } catch (const std::exception& e) {
+        std::cerr << "❌ Snippets skipped: " << e.what() << std::endl;
+        complete = false;
+    }
+
+    if (timings) {
+        timings->snippetMs += elapsedMs(start);
+    }
+    return complete;
+}
+
+int SearchService::clampPageSize(int size, int maxSize) {
+    return std::clamp(size, 1, std::max(1, maxSize));
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "database.h"
+#include "query_cache.h"
+
+struct SearchRequest {
+    std::string query;
+    int page = 1;           // display only, continuation is driven by cursor
+    int size = 10;
+    std::string cursor;     // opaque token from the previous page
+    // Time budget of the search; past it the database cancels the query
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+};
+
+class SearchService {
+public:
+    // A request parsed once: the query, its cursor and its cache key
+    struct Prepared {
+        ParsedQuery query;
+        SearchCursor after;
+        bool hasCursor = false;
+        size_t size = 1;
+        std::string cacheKey;
+    };
+
+    // Throws std::invalid_argument for a malformed cursor token
+    static Prepared prepare(const SearchRequest& request, SearchTimings* timings = nullptr);
+
+    // A search in two halves: a cache lookup that never touches the
+    // database (nullptr on a miss), and the search itself, which stores
+    // its page in the cache and throws SearchTimeout when the deadline
+    // passes. Stage durations are added to *timings when it is given.
+    static QueryCache::Results cached(const Prepared& prepared, SearchTimings* timings = nullptr);
+    static QueryCache::Results execute(const SearchRequest& request, const Prepared& prepared,
+        SearchTimings* timings = nullptr);
+
+    static int clampPageSize(int size, int maxSize);
+
+private:
+    // Connection of the calling thread, opened on first use
+    static SearchDatabase& localDatabase();
+
+    // Compressed texts of the given documents, loaded by the snippet deadline
+    // Clears complete when some texts could not be loaded in time.
+    using TextLoader = std::function<std::unordered_map<int, std::basic_string<std::byte>>(
+        const std::vector<int>& documentIds, std::chrono::steady_clock::time_point deadline, bool& complete)>;
+
+    // Snippets stop at the snippet budget or the search deadline, whichever
+    // comes first; false when that left results without a snippet
+    static bool attachSnippets(const TextLoader& loadTexts, const ParsedQuery& query,
+        std::chrono::steady_clock::time_point searchDeadline, SearchPage& page, SearchTimings* timings);
+};
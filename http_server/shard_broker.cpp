@@ -0,0 +1,263 @@
+#include "shard_broker.h"
+#include "metrics.h"
+#include "shards.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+
+// Worker thread owning one shard connection. Tasks run in order; a task
+// the broker stopped waiting for still runs, but the connection's
+// statement_timeout keeps it from holding up the queue for long.
+class ShardBroker::Shard {
+public:
+    Shard(size_t index, std::string connection, std::chrono::milliseconds timeout)
+        : index_(index)
+        , connection_(std::move(connection))
+        , statementTimeout_(timeout)
+        , latency_(metrics::Registry::getInstance().histogram("search_shard_duration_seconds",
+            "Time for a shard to answer the broker", shardLabel(index)))
+        , timeouts_(metrics::Registry::getInstance().counter("search_shard_timeouts_total",
+            "Shard answers the broker stopped waiting for", shardLabel(index)))
+        , errors_(metrics::Registry::getInstance().counter("search_shard_errors_total",
+            "Shard requests that failed", shardLabel(index)))
+        , thread_([this] { run(); })
+    {
+    }
+
+    ~Shard() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+
+    template <class Task>
+    auto submit(Task task) -> std::future<std::invoke_result_t<Task&, SearchDatabase&>> {
+        using Result = std::invoke_result_t<Task&, SearchDatabase&>;
+
+        auto job = std::make_shared<std::packaged_task<Result()>>(
+            [this, task = std::move(task)]() mutable {
+                metrics::ScopedTimer timer(latency_);
+                try {
+                    if (!db_) {
+                        db_ = std::make_unique<SearchDatabase>(connection_);
+                        db_->setStatementTimeout(static_cast<int>(statementTimeout_.count()));
+                    }
+                    return task(*db_);
+                } catch (const pqxx::broken_connection&) {
+                    db_.reset();
+                    throw;
+                }
+            });
+        auto future = job->get_future();
+
+        std::unique_lock<std::mutex> lock(mtx_);
+        if (tasks_.size() >= kMaxQueued) {
+            lock.unlock();
+            std::promise<Result> rejected;
+            rejected.set_exception(std::make_exception_ptr(
+                std::runtime_error("shard " + std::to_string(index_) + " is overloaded")));
+            return rejected.get_future();
+        }
+        tasks_.emplace_back([job] { (*job)(); });
+        lock.unlock();
+        cv_.notify_one();
+        return future;
+    }
+
+    // Waits until deadline; nullopt (and the shard is counted) on timeout or error
+    template <class Result>
+    std::optional<Result> collect(std::future<Result>& future, std::chrono::steady_clock::time_point deadline) {
+        if (future.wait_until(deadline) != std::future_status::ready) {
+            timeouts_.add();
+            std::cerr << "⏱️ Shard " << index_ << " timed out" << std::endl;
+            return std::nullopt;
+        }
+        try {
+            return future.get();
+        } catch (const std::exception& e) {
+            errors_.add();
+            std::cerr << "❌ Shard " << index_ << " failed: " << e.what() << std::endl;
+            return std::nullopt;
+        }
+    }
+
+    const std::string& connection() const { return connection_; }
+
+private:
+    static constexpr size_t kMaxQueued = 256;
+
+    static std::string shardLabel(size_t index) {
+        return "shard=\"" + std::to_string(index) + "\"";
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (true) {
+            cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            auto task = std::move(tasks_.front());
+            tasks_.pop_front();
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+
+    size_t index_;
+    std::string connection_;
+    std::chrono::milliseconds statementTimeout_;
+    metrics::Histogram& latency_;
+    metrics::Counter& timeouts_;
+    metrics::Counter& errors_;
+
+    std::unique_ptr<SearchDatabase> db_;    // worker thread only
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> tasks_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+ShardBroker& ShardBroker::getInstance() {
+    static ShardBroker instance;
+    return instance;
+}
+
+ShardBroker::ShardBroker() = default;
+ShardBroker::~ShardBroker() = default;
+
+void ShardBroker::configure(std::vector<std::string> connections, std::chrono::milliseconds timeout) {
+    timeout_ = std::max(std::chrono::milliseconds(1), timeout);
+    shards_.clear();
+    for (size_t i = 0; i < connections.size(); ++i) {
+        shards_.push_back(std::make_unique<Shard>(i, std::move(connections[i]), timeout_));
+    }
+    if (!shards_.empty()) {
+        std::cout << "🧩 Broker over " << shards_.size() << " shards, timeout " << timeout_.count() << " ms" << std::endl;
+    }
+}
+
+SearchPage ShardBroker::search(const ParsedQuery& query, size_t limit,
+    const SearchCursor* after, SearchTimings* timings, std::chrono::steady_clock::time_point queryDeadline) {
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = std::min(start + timeout_, queryDeadline);
+
+    // Every shard returns its own top `limit` after the cursor; the global
+    // top `limit` is among them because ids, and so (score, id), are unique
+    std::optional<SearchCursor> cursor;
+    if (after) cursor = *after;
+
+    std::vector<std::future<SearchPage>> parts;
+    parts.reserve(shards_.size());
+    for (auto& shard : shards_) {
+        parts.push_back(shard->submit([query, limit, cursor, deadline](SearchDatabase& db) {
+            return db.search(query, limit, cursor ? &*cursor : nullptr, nullptr, deadline);
+        }));
+    }
+
+    SearchPage page;
+    bool more = false;
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        std::optional<SearchPage> part = shards_[i]->collect(parts[i], deadline);
+        if (!part) {
+            page.partial = true;
+            continue;
+        }
+        more = more || !part->nextCursor.empty();
+        std::move(part->results.begin(), part->results.end(), std::back_inserter(page.results));
+    }
+    auto gathered = std::chrono::steady_clock::now();
+
+    std::sort(page.results.begin(), page.results.end(), [](const SearchResult& a, const SearchResult& b) {
+        return a.relevance != b.relevance ? a.relevance > b.relevance : a.documentId > b.documentId;
+    });
+    if (page.results.size() > limit) {
+        page.results.resize(limit);
+        more = true;
+    }
+    if (more && !page.results.empty()) {
+        const SearchResult& last = page.results.back();
+        page.nextCursor = SearchCursor{last.relevance, last.documentId}.encode();
+    }
+
+    if (timings) {
+        using ms = std::chrono::duration<double, std::milli>;
+        timings->retrieveMs += ms(gathered - start).count();
+        timings->rankMs += ms(std::chrono::steady_clock::now() - gathered).count();
+    }
+    return page;
+}
+
+ShardBroker::Texts ShardBroker::loadDocumentTexts(const std::vector<int>& documentIds,
+    std::chrono::steady_clock::time_point deadline, bool* complete) {
+    std::vector<std::vector<int>> byShard(shards_.size());
+    for (int id : documentIds) {
+        byShard[shards::shardOfDocument(id, shards_.size())].push_back(id);
+    }
+
+    std::vector<std::optional<std::future<Texts>>> parts(shards_.size());
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (!byShard[i].empty()) {
+            parts[i] = shards_[i]->submit([ids = std::move(byShard[i]), deadline](SearchDatabase& db) {
+                return db.loadDocumentTexts(ids, deadline);
+            });
+        }
+    }
+
+    Texts texts;
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (!parts[i]) {
+            continue;
+        }
+        if (auto part = shards_[i]->collect(*parts[i], deadline)) {
+            texts.merge(*part);
+        } else if (complete) {
+            *complete = false;
+        }
+    }
+    return texts;
+}
+
+uint64_t ShardBroker::indexGeneration() {
+    std::vector<std::future<uint64_t>> parts;
+    for (auto& shard : shards_) {
+        parts.push_back(shard->submit([](SearchDatabase& db) { return db.indexGeneration(); }));
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + timeout_;
+    uint64_t generation = 0;
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        auto part = shards_[i]->collect(parts[i], deadline);
+        if (!part) {
+            throw std::runtime_error("shard " + std::to_string(i) + " did not report its generation");
+        }
+        generation += *part;
+    }
+    return generation;
+}
+
+std::vector<std::pair<std::string, uint32_t>> ShardBroker::loadTermDictionary() {
+    // A full dictionary scan outlasts the query timeout, so it runs on
+    // connections of its own rather than on the shard workers
+    std::unordered_map<std::string, uint32_t> frequencies;
+    for (auto& shard : shards_) {
+        SearchDatabase db(shard->connection());
+        for (auto& [term, df] : db.loadTermDictionary()) {
+            frequencies[std::move(term)] += df;
+        }
+    }
+    return {std::make_move_iterator(frequencies.begin()), std::make_move_iterator(frequencies.end())};
+}
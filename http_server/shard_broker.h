@@ -0,0 +1,56 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "database.h"
+
+// Broker mode: the index is split over several shard databases
+// ([shards] databases) and every search is fanned out to all of them.
+//
+// Each shard has a worker thread with its own connection. A query goes to
+// all workers at once; shards that have not answered by the shard timeout
+// are left out and the page is marked partial. Scores are term frequencies
+// plus phrase bonuses, which depend on the document alone, so shard scores
+// merge directly. The suggest dictionary's document frequencies are summed
+// over the shards to give global statistics.
+class ShardBroker {
+public:
+    using Texts = std::unordered_map<int, std::basic_string<std::byte>>;
+
+    static ShardBroker& getInstance();
+
+    void configure(std::vector<std::string> connections, std::chrono::milliseconds timeout);
+    bool enabled() const { return !shards_.empty(); }
+    size_t shardCount() const { return shards_.size(); }
+
+    // Waits for the shards until the shard timeout or the query deadline,
+    // whichever comes first; shard statements are cut at the deadline too
+    SearchPage search(const ParsedQuery& query, size_t limit,
+        const SearchCursor* after = nullptr, SearchTimings* timings = nullptr,
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+
+    // Texts of the documents whose shards answered before the deadline;
+    // *complete is cleared when some shard did not
+    Texts loadDocumentTexts(const std::vector<int>& documentIds, std::chrono::steady_clock::time_point deadline,
+        bool* complete = nullptr);
+
+    // Sum over all shards; throws if one of them cannot be read
+    uint64_t indexGeneration();
+    // Union of the shard dictionaries with summed document frequencies
+    std::vector<std::pair<std::string, uint32_t>> loadTermDictionary();
+
+    ~ShardBroker();
+
+private:
+    class Shard;
+
+    ShardBroker();
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::chrono::milliseconds timeout_{500};
+};
@@ -0,0 +1,124 @@
+#include "snippets.h"
+#include "doc_store.h"
+#include "tokenizer.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    struct Match {
+        uint32_t position;
+        size_t begin;
+        size_t end;
+        size_t term;
+    };
+
+    bool isContinuation(char c) {
+        return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+    }
+
+    constexpr std::string_view kEllipsis = "\xE2\x80\xA6";
+}
+
+void SnippetBuilder::build(std::string_view text, const std::vector<std::string>& terms, SearchResult& result) {
+    result.snippet.clear();
+    result.highlights.clear();
+    if (text.empty()) {
+        return;
+    }
+
+    std::vector<Match> matches;
+    Tokenizer::getInstance().tokenizeSpans(text, [&](std::string_view word, uint32_t position, size_t begin, size_t end) {
+        for (size_t i = 0; i < terms.size(); ++i) {
+            if (terms[i] == word) {
+                matches.push_back(Match{position, begin, end, i});
+                break;
+            }
+        }
+    });
+
+    // Sliding window over the matches, bounded by token distance
+    size_t bestFirst = 0;
+    size_t bestLast = 0;
+    long long bestScore = -1;
+    std::vector<uint32_t> counts(terms.size(), 0);
+    size_t distinct = 0;
+    size_t lo = 0;
+    for (size_t hi = 0; hi < matches.size(); ++hi) {
+        if (counts[matches[hi].term]++ == 0) ++distinct;
+        while (matches[hi].position - matches[lo].position >= kWindowTokens) {
+            if (--counts[matches[lo].term] == 0) --distinct;
+            ++lo;
+        }
+        long long score = static_cast<long long>(distinct) * 1000 + static_cast<long long>(hi - lo + 1);
+        if (score > bestScore) {
+            bestScore = score;
+            bestFirst = lo;
+            bestLast = hi;
+        }
+    }
+
+    size_t firstBegin = matches.empty() ? 0 : matches[bestFirst].begin;
+    size_t lastEnd = matches.empty() ? 0 : matches[bestLast].end;
+
+    size_t start = firstBegin > kContextBytes ? firstBegin - kContextBytes : 0;
+    size_t end = std::max(start + kSnippetBytes, lastEnd);
+    end = std::min({end, start + 2 * kSnippetBytes, text.size()});
+
+    // Cut at spaces where possible, never inside a UTF-8 sequence
+    if (start > 0) {
+        size_t space = text.find(' ', start);
+        if (space != std::string_view::npos && space < std::max(firstBegin, start + 1)) {
+            start = space + 1;
+        } else {
+            while (start > 0 && isContinuation(text[start])) --start;
+        }
+    }
+    if (end < text.size()) {
+        size_t space = text.rfind(' ', end);
+        if (space != std::string_view::npos && space > std::max(lastEnd, start)) {
+            end = space;
+        } else {
+            while (end < text.size() && isContinuation(text[end])) ++end;
+        }
+    }
+
+    size_t shift = 0;
+    if (start > 0) {
+        result.snippet.append(kEllipsis).push_back(' ');
+        shift = kEllipsis.size() + 1;
+    }
+    result.snippet.append(text.substr(start, end - start));
+    if (end < text.size()) {
+        result.snippet.push_back(' ');
+        result.snippet.append(kEllipsis);
+    }
+
+    for (const Match& match : matches) {
+        if (match.begin >= start && match.end <= end) {
+            result.highlights.emplace_back(static_cast<uint32_t>(match.begin - start + shift),
+                static_cast<uint32_t>(match.end - match.begin));
+        }
+    }
+}
+
+bool SnippetBuilder::fill(std::vector<SearchResult>& results, const std::vector<std::string>& terms,
+    const std::unordered_map<int, std::basic_string<std::byte>>& texts,
+    std::chrono::steady_clock::time_point deadline) {
+    for (auto& result : results) {
+        auto it = texts.find(result.documentId);
+        if (it == texts.end()) {
+            continue;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+
+        try {
+            std::string text = DocumentStore::decompress(it->second, kScanBytes);
+            build(text, terms, result);
+        } catch (const std::exception& e) {
+            std::cerr << "❌ Snippet error for document " << result.documentId << ": " << e.what() << std::endl;
+        }
+    }
+    return true;
+}
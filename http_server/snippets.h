@@ -0,0 +1,29 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "database.h"
+
+// Query-biased snippets from stored page text. The best window is the one
+// covering the most distinct query terms (then the most occurrences)
+// within kWindowTokens tokens; every term occurrence inside the snippet
+// is reported as a highlight range.
+class SnippetBuilder {
+public:
+    static constexpr size_t kSnippetBytes = 240;
+    static constexpr size_t kContextBytes = 60;
+    static constexpr uint32_t kWindowTokens = 30;
+    static constexpr size_t kScanBytes = 64 * 1024;  // text decoded per document
+
+    // terms are normalized the same way as the index (QueryParser::parse)
+    static void build(std::string_view text, const std::vector<std::string>& terms, SearchResult& result);
+
+    // Fills snippets in result order until the deadline passes; false if
+    // the deadline left some results without their chance
+    static bool fill(std::vector<SearchResult>& results, const std::vector<std::string>& terms,
+        const std::unordered_map<int, std::basic_string<std::byte>>& texts,
+        std::chrono::steady_clock::time_point deadline);
+};
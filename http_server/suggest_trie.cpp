@@ -0,0 +1,195 @@
+#include "suggest_trie.h"
+#include "database.h"
+#include "shard_broker.h"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <queue>
+#include <thread>
+
+SuggestTrie::SuggestTrie(std::vector<std::pair<std::string, uint32_t>> terms) {
+    std::sort(terms.begin(), terms.end());
+    // Equal terms are adjacent after sorting; keep the last (largest) weight
+    std::vector<std::pair<std::string, uint32_t>> unique;
+    unique.reserve(terms.size());
+    for (auto& term : terms) {
+        if (term.first.empty() || term.first.size() > UINT16_MAX) continue;
+        if (!unique.empty() && unique.back().first == term.first) {
+            unique.back().second = std::max(unique.back().second, term.second);
+        } else {
+            unique.push_back(std::move(term));
+        }
+    }
+    termCount_ = unique.size();
+
+    struct Pending {
+        uint32_t node;
+        size_t lo, hi;  // range of terms below this node
+        size_t depth;   // characters consumed including this node's label
+    };
+
+    nodes_.push_back(Node{0, 0, 0, 0, 0, 0});
+    std::deque<Pending> queue{{0, 0, unique.size(), 0}};
+
+    // Breadth-first, so the children of each node are allocated contiguously
+    while (!queue.empty()) {
+        Pending p = queue.front();
+        queue.pop_front();
+
+        size_t lo = p.lo;
+        if (lo < p.hi && unique[lo].first.size() == p.depth) {
+            nodes_[p.node].weight = std::max<uint32_t>(1, unique[lo].second);
+            ++lo;
+        }
+
+        std::vector<Pending> children;
+        for (size_t start = lo; start < p.hi;) {
+            char first = unique[start].first[p.depth];
+            size_t end = start + 1;
+            while (end < p.hi && unique[end].first[p.depth] == first) ++end;
+
+            // Compressed edge: the longest prefix shared by the whole group
+            const std::string& a = unique[start].first;
+            const std::string& b = unique[end - 1].first;
+            size_t common = p.depth;
+            while (common < a.size() && common < b.size() && a[common] == b[common]) ++common;
+
+            Node child{static_cast<uint32_t>(labels_.size()), 0, 0, 0,
+                static_cast<uint16_t>(common - p.depth), 0};
+            labels_.append(a, p.depth, common - p.depth);
+            children.push_back(Pending{static_cast<uint32_t>(nodes_.size()), start, end, common});
+            nodes_.push_back(child);
+            start = end;
+        }
+
+        nodes_[p.node].childCount = static_cast<uint16_t>(children.size());
+        nodes_[p.node].firstChild = children.empty() ? 0 : children.front().node;
+        for (const auto& child : children) {
+            queue.push_back(child);
+        }
+    }
+
+    // Children always follow their parent, so one reverse pass computes subtree maxima
+    for (size_t i = nodes_.size(); i-- > 0;) {
+        Node& node = nodes_[i];
+        node.maxWeight = node.weight;
+        for (uint32_t c = 0; c < node.childCount; ++c) {
+            node.maxWeight = std::max(node.maxWeight, nodes_[node.firstChild + c].maxWeight);
+        }
+    }
+
+    nodes_.shrink_to_fit();
+    labels_.shrink_to_fit();
+}
+
+std::vector<Suggestion> SuggestTrie::complete(std::string_view prefix, size_t k) const {
+    std::vector<Suggestion> out;
+    if (k == 0 || nodes_.empty()) {
+        return out;
+    }
+
+    // Descend along the prefix; it may end in the middle of an edge label
+    uint32_t current = 0;
+    std::string path;
+    size_t matched = 0;
+    while (matched < prefix.size()) {
+        const Node& node = nodes_[current];
+        uint32_t next = 0;
+        bool found = false;
+        for (uint32_t c = 0; c < node.childCount; ++c) {
+            const Node& child = nodes_[node.firstChild + c];
+            if (labels_[child.labelOffset] == prefix[matched]) {
+                next = node.firstChild + c;
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            return out;
+        }
+
+        std::string_view edge = label(nodes_[next]);
+        size_t n = std::min(edge.size(), prefix.size() - matched);
+        if (edge.substr(0, n) != prefix.substr(matched, n)) {
+            return out;
+        }
+        path.append(edge);
+        matched += n;
+        current = next;
+    }
+
+    struct Entry {
+        uint32_t priority;
+        uint32_t node;
+        bool emit;          // true: report the term ending at node
+        std::string text;
+
+        bool operator<(const Entry& other) const { return priority < other.priority; }
+    };
+
+    std::priority_queue<Entry> queue;
+    queue.push(Entry{nodes_[current].maxWeight, current, false, std::move(path)});
+
+    while (!queue.empty() && out.size() < k) {
+        Entry entry = queue.top();
+        queue.pop();
+
+        if (entry.emit) {
+            out.push_back(Suggestion{std::move(entry.text), entry.priority});
+            continue;
+        }
+
+        const Node& node = nodes_[entry.node];
+        if (node.weight > 0) {
+            queue.push(Entry{node.weight, entry.node, true, entry.text});
+        }
+        for (uint32_t c = 0; c < node.childCount; ++c) {
+            uint32_t childIndex = node.firstChild + c;
+            const Node& child = nodes_[childIndex];
+            queue.push(Entry{child.maxWeight, childIndex, false, entry.text + std::string(label(child))});
+        }
+    }
+
+    return out;
+}
+
+size_t SuggestTrie::memoryBytes() const {
+    return nodes_.capacity() * sizeof(Node) + labels_.capacity();
+}
+
+std::shared_ptr<const SuggestTrie> SuggestIndex::current() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return trie_;
+}
+
+void SuggestIndex::replace(std::shared_ptr<const SuggestTrie> trie) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    trie_ = std::move(trie);
+}
+
+void SuggestIndex::rebuildAsync() {
+    if (rebuilding_.exchange(true)) {
+        return;
+    }
+
+    std::thread([this] {
+        try {
+            auto start = std::chrono::steady_clock::now();
+            // A broker merges the shard dictionaries so weights are global frequencies
+            ShardBroker& broker = ShardBroker::getInstance();
+            auto trie = std::make_shared<const SuggestTrie>(broker.enabled()
+                ? broker.loadTermDictionary()
+                : SearchDatabase(SearchDatabase::connectionString()).loadTermDictionary());
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start);
+
+            std::cout << "🔤 Suggest index: " << trie->termCount() << " terms, "
+                      << trie->memoryBytes() / 1024 << " KiB, built in " << elapsed.count() << " ms" << std::endl;
+            replace(std::move(trie));
+        } catch (const std::exception& e) {
+            std::cerr << "❌ Suggest index rebuild failed: " << e.what() << std::endl;
+        }
+        rebuilding_ = false;
+    }).detach();
+}
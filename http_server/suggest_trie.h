@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <atomic>
+
+struct Suggestion {
+    std::string term;
+    uint32_t weight;    // document frequency
+};
+
+// Immutable path-compressed trie over the term dictionary, laid out in
+// flat arrays: nodes are 20 bytes, children of a node are contiguous and
+// edge labels share one character buffer. Every node keeps the best weight
+// in its subtree, so top-k completion is a best-first walk that touches
+// only the branches that can still contribute.
+class SuggestTrie {
+public:
+    // terms do not need to be sorted; duplicates keep the larger weight
+    explicit SuggestTrie(std::vector<std::pair<std::string, uint32_t>> terms);
+
+    std::vector<Suggestion> complete(std::string_view prefix, size_t k) const;
+
+    size_t termCount() const { return termCount_; }
+    size_t memoryBytes() const;
+
+private:
+    struct Node {
+        uint32_t labelOffset;
+        uint32_t firstChild;
+        uint32_t maxWeight;
+        uint32_t weight;        // 0 when no term ends here
+        uint16_t labelLength;
+        uint16_t childCount;
+    };
+
+    std::string_view label(const Node& node) const {
+        return std::string_view(labels_).substr(node.labelOffset, node.labelLength);
+    }
+
+    std::vector<Node> nodes_;
+    std::string labels_;
+    size_t termCount_ = 0;
+};
+
+// Process-wide current trie, swapped in whole when a rebuild finishes
+class SuggestIndex {
+public:
+    std::shared_ptr<const SuggestTrie> current() const;
+    void replace(std::shared_ptr<const SuggestTrie> trie);
+
+    // Loads the dictionary from the database on a background thread;
+    // does nothing if a rebuild is already running
+    void rebuildAsync();
+
+    static SuggestIndex& getInstance() {
+        static SuggestIndex instance;
+        return instance;
+    }
+
+private:
+    mutable std::mutex mtx_;
+    std::shared_ptr<const SuggestTrie> trie_;
+    std::atomic<bool> rebuilding_{false};
+};
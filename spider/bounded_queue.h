@@ -0,0 +1,85 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// Multi-producer multi-consumer queue with a fixed capacity. push() blocks
+// while the queue is full, which is what throttles a fast stage to the
+// pace of the one after it. After close() pushes fail and pops drain what
+// is left, then fail.
+template <class T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity ? capacity : 1) {}
+
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        notFull_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+        if (closed_) {
+            return false;
+        }
+        items_.push_back(std::move(item));
+        notEmpty_.notify_one();
+        return true;
+    }
+
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        notEmpty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+        if (items_.empty()) {
+            return false;
+        }
+        item = std::move(items_.front());
+        items_.pop_front();
+        notFull_.notify_one();
+        return true;
+    }
+
+    // Waits for one item, then up to maxWait for the batch to fill; takes
+    // at most maxItems. False once the queue is closed and drained.
+    bool popBatch(std::vector<T>& out, size_t maxItems, std::chrono::milliseconds maxWait) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (true) {
+            notEmpty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+            if (items_.empty()) {
+                return false;
+            }
+            notEmpty_.wait_for(lock, maxWait, [&] { return closed_ || items_.size() >= maxItems; });
+            if (!items_.empty()) {
+                break;
+            }
+            // Other consumers took everything while this one waited for a fuller batch
+        }
+
+        size_t count = std::min(maxItems, items_.size());
+        for (size_t i = 0; i < count; ++i) {
+            out.push_back(std::move(items_.front()));
+            items_.pop_front();
+        }
+        notFull_.notify_all();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        closed_ = true;
+        notEmpty_.notify_all();
+        notFull_.notify_all();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return items_.size();
+    }
+
+private:
+    const size_t capacity_;
+    mutable std::mutex mtx_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+    std::deque<T> items_;
+    bool closed_ = false;
+};
@@ -0,0 +1,268 @@
+#include "charset.h"
+#include "utf8.h"
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+// Code points for bytes 0x80..0xFF
+using CodePage = std::array<char16_t, 128>;
+
+constexpr CodePage kWindows1251 = {
+    0x0402, 0x0403, 0x201A, 0x0453, 0x201E, 0x2026, 0x2020, 0x2021, 0x20AC, 0x2030, 0x0409, 0x2039, 0x040A, 0x040C, 0x040B, 0x040F,
+    0x0452, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014, 0xFFFD, 0x2122, 0x0459, 0x203A, 0x045A, 0x045C, 0x045B, 0x045F,
+    0x00A0, 0x040E, 0x045E, 0x0408, 0x00A4, 0x0490, 0x00A6, 0x00A7, 0x0401, 0x00A9, 0x0404, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x0407,
+    0x00B0, 0x00B1, 0x0406, 0x0456, 0x0491, 0x00B5, 0x00B6, 0x00B7, 0x0451, 0x2116, 0x0454, 0x00BB, 0x0458, 0x0405, 0x0455, 0x0457,
+    0x0410, 0x0411, 0x0412, 0x0413, 0x0414, 0x0415, 0x0416, 0x0417, 0x0418, 0x0419, 0x041A, 0x041B, 0x041C, 0x041D, 0x041E, 0x041F,
+    0x0420, 0x0421, 0x0422, 0x0423, 0x0424, 0x0425, 0x0426, 0x0427, 0x0428, 0x0429, 0x042A, 0x042B, 0x042C, 0x042D, 0x042E, 0x042F,
+    0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0436, 0x0437, 0x0438, 0x0439, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E, 0x043F,
+    0x0440, 0x0441, 0x0442, 0x0443, 0x0444, 0x0445, 0x0446, 0x0447, 0x0448, 0x0449, 0x044A, 0x044B, 0x044C, 0x044D, 0x044E, 0x044F,
+};
+
+constexpr CodePage kKoi8R = {
+    0x2500, 0x2502, 0x250C, 0x2510, 0x2514, 0x2518, 0x251C, 0x2524, 0x252C, 0x2534, 0x253C, 0x2580, 0x2584, 0x2588, 0x258C, 0x2590,
+    0x2591, 0x2592, 0x2593, 0x2320, 0x25A0, 0x2219, 0x221A, 0x2248, 0x2264, 0x2265, 0x00A0, 0x2321, 0x00B0, 0x00B2, 0x00B7, 0x00F7,
+    0x2550, 0x2551, 0x2552, 0x0451, 0x2553, 0x2554, 0x2555, 0x2556, 0x2557, 0x2558, 0x2559, 0x255A, 0x255B, 0x255C, 0x255D, 0x255E,
+    0x255F, 0x2560, 0x2561, 0x0401, 0x2562, 0x2563, 0x2564, 0x2565, 0x2566, 0x2567, 0x2568, 0x2569, 0x256A, 0x256B, 0x256C, 0x00A9,
+    0x044E, 0x0430, 0x0431, 0x0446, 0x0434, 0x0435, 0x0444, 0x0433, 0x0445, 0x0438, 0x0439, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E,
+    0x043F, 0x044F, 0x0440, 0x0441, 0x0442, 0x0443, 0x0436, 0x0432, 0x044C, 0x044B, 0x0437, 0x0448, 0x044D, 0x0449, 0x0447, 0x044A,
+    0x042E, 0x0410, 0x0411, 0x0426, 0x0414, 0x0415, 0x0424, 0x0413, 0x0425, 0x0418, 0x0419, 0x041A, 0x041B, 0x041C, 0x041D, 0x041E,
+    0x041F, 0x042F, 0x0420, 0x0421, 0x0422, 0x0423, 0x0416, 0x0412, 0x042C, 0x042B, 0x0417, 0x0428, 0x042D, 0x0429, 0x0427, 0x042A,
+};
+
+constexpr CodePage kCp866 = {
+    0x0410, 0x0411, 0x0412, 0x0413, 0x0414, 0x0415, 0x0416, 0x0417, 0x0418, 0x0419, 0x041A, 0x041B, 0x041C, 0x041D, 0x041E, 0x041F,
+    0x0420, 0x0421, 0x0422, 0x0423, 0x0424, 0x0425, 0x0426, 0x0427, 0x0428, 0x0429, 0x042A, 0x042B, 0x042C, 0x042D, 0x042E, 0x042F,
+    0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0436, 0x0437, 0x0438, 0x0439, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E, 0x043F,
+    0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x2561, 0x2562, 0x2556, 0x2555, 0x2563, 0x2551, 0x2557, 0x255D, 0x255C, 0x255B, 0x2510,
+    0x2514, 0x2534, 0x252C, 0x251C, 0x2500, 0x253C, 0x255E, 0x255F, 0x255A, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256C, 0x2567,
+    0x2568, 0x2564, 0x2565, 0x2559, 0x2558, 0x2552, 0x2553, 0x256B, 0x256A, 0x2518, 0x250C, 0x2588, 0x2584, 0x258C, 0x2590, 0x2580,
+    0x0440, 0x0441, 0x0442, 0x0443, 0x0444, 0x0445, 0x0446, 0x0447, 0x0448, 0x0449, 0x044A, 0x044B, 0x044C, 0x044D, 0x044E, 0x044F,
+    0x0401, 0x0451, 0x0404, 0x0454, 0x0407, 0x0457, 0x040E, 0x045E, 0x00B0, 0x2219, 0x00B7, 0x221A, 0x2116, 0x00A4, 0x25A0, 0x00A0,
+};
+
+constexpr CodePage buildIso88595() {
+    CodePage page{};
+    for (char16_t i = 0; i < 0x20; ++i) page[i] = 0x80 + i;         // C1 controls
+    page[0x20] = 0x00A0;
+    for (char16_t i = 0x21; i <= 0x2C; ++i) page[i] = 0x0400 + (i - 0x20);
+    page[0x2D] = 0x00AD;
+    for (char16_t i = 0x2E; i <= 0x6F; ++i) page[i] = 0x0400 + (i - 0x20);
+    page[0x70] = 0x2116;
+    for (char16_t i = 0x71; i <= 0x7C; ++i) page[i] = 0x0450 + (i - 0x70);
+    page[0x7D] = 0x00A7;
+    page[0x7E] = 0x045E;
+    page[0x7F] = 0x045F;
+    return page;
+}
+
+constexpr CodePage buildWindows1252() {
+    CodePage page{
+        0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021, 0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+        0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014, 0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+    };
+    for (char16_t i = 0x20; i < 0x80; ++i) page[i] = 0x80 + i;      // same as Latin-1
+    return page;
+}
+
+constexpr CodePage kIso88595 = buildIso88595();
+constexpr CodePage kWindows1252 = buildWindows1252();
+
+struct Label {
+    std::string_view name;
+    Charset charset;
+};
+
+const Label kLabels[] = {
+    {"utf-8", Charset::Utf8}, {"utf8", Charset::Utf8}, {"unicode-1-1-utf-8", Charset::Utf8},
+    {"windows-1251", Charset::Windows1251}, {"cp1251", Charset::Windows1251}, {"x-cp1251", Charset::Windows1251},
+    {"koi8-r", Charset::Koi8R}, {"koi8r", Charset::Koi8R}, {"koi8", Charset::Koi8R}, {"koi", Charset::Koi8R}, {"cskoi8r", Charset::Koi8R},
+    {"iso-8859-5", Charset::Iso88595}, {"iso8859-5", Charset::Iso88595}, {"iso_8859-5", Charset::Iso88595},
+    {"cyrillic", Charset::Iso88595}, {"csisolatincyrillic", Charset::Iso88595},
+    {"windows-1252", Charset::Windows1252}, {"cp1252", Charset::Windows1252}, {"x-cp1252", Charset::Windows1252},
+    {"iso-8859-1", Charset::Windows1252}, {"iso8859-1", Charset::Windows1252}, {"iso_8859-1", Charset::Windows1252},
+    {"latin1", Charset::Windows1252}, {"l1", Charset::Windows1252}, {"us-ascii", Charset::Windows1252}, {"ascii", Charset::Windows1252},
+    {"ibm866", Charset::Cp866}, {"cp866", Charset::Cp866}, {"866", Charset::Cp866}, {"csibm866", Charset::Cp866},
+};
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+size_t findIgnoreCase(std::string_view text, std::string_view needle, size_t from = 0) {
+    if (needle.size() > text.size()) return std::string_view::npos;
+    for (size_t i = from; i + needle.size() <= text.size(); ++i) {
+        if (equalsIgnoreCase(text.substr(i, needle.size()), needle)) return i;
+    }
+    return std::string_view::npos;
+}
+
+// Value after "charset=" up to the next delimiter, quotes stripped
+std::string_view charsetParameter(std::string_view text) {
+    size_t pos = findIgnoreCase(text, "charset");
+    while (pos != std::string_view::npos) {
+        size_t i = pos + 7;
+        while (i < text.size() && text[i] == ' ') ++i;
+        if (i < text.size() && text[i] == '=') {
+            ++i;
+            while (i < text.size() && (text[i] == ' ' || text[i] == '"' || text[i] == '\'')) ++i;
+            size_t end = i;
+            while (end < text.size() && text[end] != '"' && text[end] != '\'' && text[end] != ';' &&
+                text[end] != ' ' && text[end] != '>' && text[end] != '/') ++end;
+            return text.substr(i, end - i);
+        }
+        pos = findIgnoreCase(text, "charset", pos + 7);
+    }
+    return {};
+}
+
+bool isValidUtf8(std::string_view text) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(text.data());
+    const unsigned char* end = p + text.size();
+    while (p < end) {
+        const unsigned char* start = p;
+        if (utf8::decode(p, end) == utf8::kInvalid) {
+            // A sequence cut off by the sniff window is not an error
+            return end - start < 4 && (*start & 0xC0) == 0xC0 && p == start + 1 &&
+                std::all_of(start + 1, end, [](unsigned char c) { return (c & 0xC0) == 0x80; });
+        }
+    }
+    return true;
+}
+
+}
+
+const char* charsetName(Charset charset) {
+    switch (charset) {
+    case Charset::Utf8: return "utf-8";
+    case Charset::Windows1251: return "windows-1251";
+    case Charset::Koi8R: return "koi8-r";
+    case Charset::Iso88595: return "iso-8859-5";
+    case Charset::Windows1252: return "windows-1252";
+    case Charset::Cp866: return "ibm866";
+    }
+    return "unknown";
+}
+
+std::optional<Charset> charsetFromLabel(std::string_view label) {
+    while (!label.empty() && std::isspace(static_cast<unsigned char>(label.front()))) label.remove_prefix(1);
+    while (!label.empty() && std::isspace(static_cast<unsigned char>(label.back()))) label.remove_suffix(1);
+
+    for (const Label& known : kLabels) {
+        if (equalsIgnoreCase(label, known.name)) {
+            return known.charset;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<Charset> charsetFromContentType(std::string_view contentType) {
+    std::string_view value = charsetParameter(contentType);
+    if (value.empty()) return std::nullopt;
+    return charsetFromLabel(value);
+}
+
+std::optional<Charset> charsetFromMeta(std::string_view head) {
+    size_t pos = findIgnoreCase(head, "<meta");
+    while (pos != std::string_view::npos) {
+        size_t end = head.find('>', pos);
+        if (end == std::string_view::npos) end = head.size();
+
+        std::string_view value = charsetParameter(head.substr(pos, end - pos));
+        if (!value.empty()) {
+            if (auto charset = charsetFromLabel(value)) return charset;
+        }
+        pos = findIgnoreCase(head, "<meta", end);
+    }
+    return std::nullopt;
+}
+
+Utf8Transcoder::Utf8Transcoder(std::string_view contentType)
+    : declared_(charsetFromContentType(contentType))
+{
+}
+
+size_t Utf8Transcoder::sniff(std::string_view head) {
+    if (head.size() >= 3 && head.substr(0, 3) == "\xEF\xBB\xBF") {
+        charset_ = Charset::Utf8;
+        return 3;
+    }
+
+    head = head.substr(0, kSniffBytes);
+    if (declared_) {
+        charset_ = *declared_;
+    } else if (auto meta = charsetFromMeta(head)) {
+        charset_ = *meta;
+    } else {
+        charset_ = isValidUtf8(head) ? Charset::Utf8 : Charset::Windows1251;
+    }
+    return 0;
+}
+
+const Utf8Transcoder::Table& Utf8Transcoder::table(Charset charset) {
+    auto build = [](const CodePage& page) {
+        Table table{};
+        for (size_t i = 0; i < page.size(); ++i) {
+            std::string bytes;
+            utf8::append(bytes, page[i]);
+            std::copy(bytes.begin(), bytes.end(), table[i].bytes);
+            table[i].length = static_cast<unsigned char>(bytes.size());
+        }
+        return table;
+    };
+
+    static const Table windows1251 = build(kWindows1251);
+    static const Table koi8r = build(kKoi8R);
+    static const Table iso88595 = build(kIso88595);
+    static const Table windows1252 = build(kWindows1252);
+    static const Table cp866 = build(kCp866);
+
+    switch (charset) {
+    case Charset::Koi8R: return koi8r;
+    case Charset::Iso88595: return iso88595;
+    case Charset::Windows1252: return windows1252;
+    case Charset::Cp866: return cp866;
+    default: return windows1251;
+    }
+}
+
+void Utf8Transcoder::append(std::string& out, std::string_view bytes) const {
+    if (passthrough()) {
+        out.append(bytes);
+        return;
+    }
+
+    const Table& map = table(charset_);
+    out.reserve(out.size() + bytes.size() * 2);
+
+    size_t i = 0;
+    while (i < bytes.size()) {
+        // Copy ASCII runs in one go
+        size_t run = i;
+        while (run < bytes.size() && static_cast<unsigned char>(bytes[run]) < 0x80) ++run;
+        out.append(bytes.data() + i, run - i);
+        i = run;
+
+        while (i < bytes.size() && static_cast<unsigned char>(bytes[i]) >= 0x80) {
+            const Utf8Bytes& mapped = map[static_cast<unsigned char>(bytes[i]) - 0x80];
+            out.append(mapped.bytes, mapped.length);
+            ++i;
+        }
+    }
+}
+
+void transcodeToUtf8(std::string& page, std::string_view contentType) {
+    Utf8Transcoder transcoder(contentType);
+    size_t bom = transcoder.sniff(page);
+
+    if (transcoder.passthrough()) {
+        page.erase(0, bom);
+        return;
+    }
+
+    std::string decoded;
+    transcoder.append(decoded, page);
+    page.swap(decoded);
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <array>
+#include <optional>
+#include <string>
+#include <string_view>
+
+enum class Charset {
+    Utf8,
+    Windows1251,
+    Koi8R,
+    Iso88595,
+    Windows1252,    // also used for ISO-8859-1 and ASCII labels, like browsers do
+    Cp866
+};
+
+const char* charsetName(Charset charset);
+std::optional<Charset> charsetFromLabel(std::string_view label);
+// charset parameter of a Content-Type header value
+std::optional<Charset> charsetFromContentType(std::string_view contentType);
+// <meta charset> or <meta http-equiv content="...; charset=..."> in the page head
+std::optional<Charset> charsetFromMeta(std::string_view head);
+
+// Streaming conversion of a fetched page to UTF-8. The charset is decided
+// once from the first kSniffBytes of the body: a BOM wins, then the
+// Content-Type header, then a meta tag; unlabelled pages are assumed UTF-8
+// if the sniffed bytes are valid UTF-8, windows-1251 otherwise.
+// UTF-8 pages are passed through untouched so the caller can append the
+// raw bytes; single-byte codepages are decoded through a lookup table.
+class Utf8Transcoder {
+public:
+    static constexpr size_t kSniffBytes = 1024;
+
+    explicit Utf8Transcoder(std::string_view contentType);
+
+    // Decides the charset from the start of the body (or the whole body
+    // if it is shorter); returns the number of BOM bytes to skip
+    size_t sniff(std::string_view head);
+
+    bool passthrough() const { return charset_ == Charset::Utf8; }
+    Charset charset() const { return charset_; }
+
+    // Appends bytes decoded from the sniffed charset to out
+    void append(std::string& out, std::string_view bytes) const;
+
+private:
+    struct Utf8Bytes {
+        char bytes[3];
+        unsigned char length;
+    };
+    using Table = std::array<Utf8Bytes, 128>;
+
+    static const Table& table(Charset charset);
+
+    std::optional<Charset> declared_;
+    Charset charset_ = Charset::Utf8;
+};
+
+// Converts a complete page in place; no-op for UTF-8 apart from the BOM
+void transcodeToUtf8(std::string& page, std::string_view contentType);
@@ -0,0 +1,293 @@
+#include "cluster.h"
+#include "async_logger.h"
+#include "page_source.h"
+#include "spider_metrics.h"
+#include <boost/asio/write.hpp>
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <stdexcept>
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+using tcp = boost::asio::ip::tcp;
+
+namespace {
+
+// Nodes listen only on the address they are listed under, so nodes listed
+// as 127.0.0.1 or localhost are not reachable from other machines
+tcp::endpoint listenEndpoint(const ClusterNode& node) {
+    boost::system::error_code ec;
+    auto address = net::ip::make_address(node.host, ec);
+    if (!ec) {
+        return {address, node.port};
+    }
+    net::io_context ioc;
+    tcp::resolver resolver(ioc);
+    return *resolver.resolve(node.host, std::to_string(node.port)).begin();
+}
+
+}  // namespace
+
+std::vector<ClusterNode> parseClusterNodes(const std::string& list) {
+    std::vector<ClusterNode> nodes;
+    size_t start = 0;
+    while (start < list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) end = list.size();
+        std::string item = list.substr(start, end - start);
+        start = end + 1;
+
+        item.erase(0, item.find_first_not_of(" \t"));
+        item.erase(item.find_last_not_of(" \t") + 1);
+        if (item.empty()) {
+            continue;
+        }
+
+        size_t colon = item.rfind(':');
+        int port = 0;
+        if (colon == std::string::npos
+            || std::from_chars(item.data() + colon + 1, item.data() + item.size(), port).ec != std::errc()
+            || port <= 0 || port > 65535) {
+            throw std::invalid_argument("Cluster node must be host:port, got " + item);
+        }
+        nodes.push_back({item.substr(0, colon), static_cast<unsigned short>(port)});
+    }
+    return nodes;
+}
+
+HostRing::HostRing(size_t nodeCount, int virtualNodes)
+    : nodeCount_(nodeCount)
+{
+    virtualNodes = std::max(1, virtualNodes);
+    points_.reserve(nodeCount * virtualNodes);
+    for (size_t node = 0; node < nodeCount; ++node) {
+        for (int replica = 0; replica < virtualNodes; ++replica) {
+            points_.emplace_back(hash("node-" + std::to_string(node) + "#" + std::to_string(replica)),
+                static_cast<uint32_t>(node));
+        }
+    }
+    std::sort(points_.begin(), points_.end());
+}
+
+size_t HostRing::owner(std::string_view host) const {
+    if (points_.empty()) {
+        return 0;
+    }
+    auto it = std::lower_bound(points_.begin(), points_.end(), std::make_pair(hash(host), uint32_t{0}));
+    return it == points_.end() ? points_.front().second : it->second;
+}
+
+uint64_t HostRing::hash(std::string_view key) {
+    // FNV-1a with a final avalanche; all nodes must place hosts the same
+    // way, so this must not depend on std::hash
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : key) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+struct LinkExchange::Session {
+    explicit Session(tcp::socket s) : socket(std::move(s)) {}
+
+    tcp::socket socket;
+    std::array<char, 65536> chunk;
+    std::string partial;
+};
+
+LinkExchange::LinkExchange(ClusterOptions options, Receiver receiver)
+    : options_(std::move(options)),
+      ring_(options_.nodes.size(), options_.virtualNodes),
+      receiver_(std::move(receiver)),
+      peers_(options_.nodes.size()),
+      acceptor_(ioc_, listenEndpoint(options_.nodes.at(options_.self)))
+{
+    accept();
+    listener_ = std::thread([this] { ioc_.run(); });
+    flusher_ = std::thread([this] { flushLoop(); });
+    Log::info() << "🧭 Cluster node " << options_.self << " of " << options_.nodes.size()
+                << ", links exchanged on " << acceptor_.local_endpoint();
+}
+
+LinkExchange::~LinkExchange() {
+    stop();
+}
+
+void LinkExchange::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (flusher_.joinable()) {
+        flusher_.join();
+    }
+    ioc_.stop();
+    if (listener_.joinable()) {
+        listener_.join();
+    }
+}
+
+void LinkExchange::forward(size_t node, const Link& link, int depth) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    Peer& peer = peers_.at(node);
+    if (peer.pending >= options_.maxPending) {
+        SpiderMetrics::get().clusterDropped.add();
+        return;
+    }
+
+    peer.outbox += std::to_string(depth);
+    peer.outbox += '\t';
+    peer.outbox += linkToUrl(link);
+    peer.outbox += '\n';
+    if (++peer.pending >= options_.batchSize && !full_) {
+        full_ = true;
+        cv_.notify_one();
+    }
+}
+
+// Batches leave every batchWait, or as soon as one peer has batchSize links
+void LinkExchange::flushLoop() {
+    SpiderMetrics& m = SpiderMetrics::get();
+    std::vector<std::pair<size_t, std::string>> batches;
+    std::vector<size_t> counts;
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (true) {
+        cv_.wait_for(lock, options_.batchWait, [this] { return stopping_ || full_; });
+        bool last = stopping_;
+        full_ = false;
+
+        batches.clear();
+        counts.clear();
+        for (size_t node = 0; node < peers_.size(); ++node) {
+            if (peers_[node].pending > 0) {
+                batches.emplace_back(node, std::move(peers_[node].outbox));
+                counts.push_back(peers_[node].pending);
+                peers_[node].outbox.clear();
+                peers_[node].pending = 0;
+            }
+        }
+        lock.unlock();
+
+        std::vector<bool> sent(batches.size());
+        for (size_t i = 0; i < batches.size(); ++i) {
+            sent[i] = send(batches[i].first, batches[i].second);
+        }
+
+        lock.lock();
+        for (size_t i = 0; i < batches.size(); ++i) {
+            Peer& peer = peers_[batches[i].first];
+            if (sent[i]) {
+                m.clusterSent.add(counts[i]);
+            } else if (last || peer.pending + counts[i] > options_.maxPending) {
+                m.clusterDropped.add(counts[i]);
+            } else {
+                // Retried on the next round, ahead of newer links
+                peer.outbox.insert(0, batches[i].second);
+                peer.pending += counts[i];
+            }
+        }
+        if (last) {
+            break;
+        }
+    }
+}
+
+bool LinkExchange::send(size_t node, const std::string& batch) {
+    Peer& peer = peers_[node];
+    const ClusterNode& target = options_.nodes[node];
+    boost::system::error_code ec;
+
+    if (!peer.stream || !peer.stream->socket().is_open()) {
+        tcp::resolver resolver(sendIoc_);
+        auto endpoints = resolver.resolve(target.host, std::to_string(target.port), ec);
+        peer.stream = std::make_unique<beast::tcp_stream>(sendIoc_);
+        if (!ec) {
+            ec = await(peer, [&](auto handler) { peer.stream->async_connect(endpoints, handler); });
+        }
+    }
+    if (!ec) {
+        ec = await(peer, [&](auto handler) { net::async_write(*peer.stream, net::buffer(batch), handler); });
+    }
+
+    if (ec) {
+        peer.stream.reset();
+        if (peer.reachable) {
+            Log::error() << "❌ Cluster node " << node << " (" << target.host << ":" << target.port
+                         << ") unreachable: " << ec.message();
+        }
+        peer.reachable = false;
+        return false;
+    }
+    if (!peer.reachable) {
+        Log::info() << "🧭 Cluster node " << node << " reachable again";
+    }
+    peer.reachable = true;
+    return true;
+}
+
+// Runs one operation on the peer's stream to completion; a peer that does
+// not answer within sendTimeout fails it instead of stalling the flusher
+template <typename Start>
+boost::system::error_code LinkExchange::await(Peer& peer, Start start) {
+    boost::system::error_code result;
+    peer.stream->expires_after(options_.sendTimeout);
+    start([&result](boost::system::error_code ec, auto&&...) { result = ec; });
+    sendIoc_.restart();
+    sendIoc_.run();
+    return result;
+}
+
+void LinkExchange::accept() {
+    acceptor_.async_accept([this](boost::system::error_code ec, tcp::socket socket) {
+        if (!ec) {
+            read(std::make_shared<Session>(std::move(socket)));
+        }
+        accept();
+    });
+}
+
+void LinkExchange::read(std::shared_ptr<Session> session) {
+    session->socket.async_read_some(net::buffer(session->chunk),
+        [this, session](boost::system::error_code ec, size_t bytes) {
+            if (ec) {
+                return;
+            }
+            session->partial.append(session->chunk.data(), bytes);
+
+            std::vector<std::pair<Link, int>> links;
+            size_t start = 0;
+            size_t eol;
+            while ((eol = session->partial.find('\n', start)) != std::string::npos) {
+                std::string_view line(session->partial.data() + start, eol - start);
+                start = eol + 1;
+
+                size_t tab = line.find('\t');
+                int depth = 0;
+                Link link;
+                if (tab != std::string_view::npos
+                    && std::from_chars(line.data(), line.data() + tab, depth).ec == std::errc()
+                    && parseLink(std::string(line.substr(tab + 1)), link)) {
+                    links.emplace_back(std::move(link), depth);
+                }
+            }
+            session->partial.erase(0, start);
+
+            if (!links.empty()) {
+                SpiderMetrics::get().clusterReceived.add(links.size());
+                receiver_(std::move(links));
+            }
+            read(session);
+        });
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core/tcp_stream.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "link.h"
+
+struct ClusterNode {
+    std::string host;
+    unsigned short port = 0;
+};
+
+// [cluster] section; an empty node list means a single process crawl
+struct ClusterOptions {
+    std::vector<ClusterNode> nodes;
+    size_t self = 0;
+    int virtualNodes = 64;
+    size_t batchSize = 256;
+    std::chrono::milliseconds batchWait{100};
+    size_t maxPending = 100000;     // links buffered per unreachable peer before dropping
+    std::chrono::milliseconds sendTimeout{2000};  // connect or write to a peer
+};
+
+// "host:port,host:port,..."
+std::vector<ClusterNode> parseClusterNodes(const std::string& list);
+
+// Consistent hashing of host names onto nodes. Every node is placed on the
+// ring virtualNodes times, so adding a node moves only its share of hosts.
+class HostRing {
+public:
+    HostRing(size_t nodeCount, int virtualNodes);
+
+    size_t owner(std::string_view host) const;
+    size_t nodeCount() const { return nodeCount_; }
+
+    static uint64_t hash(std::string_view key);
+
+private:
+    std::vector<std::pair<uint64_t, uint32_t>> points_;  // sorted by hash
+    size_t nodeCount_;
+};
+
+// Moves discovered links to the node owning their host. Every node
+// listens on its own host and port from the node list; links for other nodes are buffered per peer
+// and sent in batches as "depth<TAB>url" lines over a kept-alive TCP
+// connection, so a cluster runs as several processes on one machine.
+class LinkExchange {
+public:
+    using Receiver = std::function<void(std::vector<std::pair<Link, int>>&& links)>;
+
+    LinkExchange(ClusterOptions options, Receiver receiver);
+    ~LinkExchange();
+
+    LinkExchange(const LinkExchange&) = delete;
+    LinkExchange& operator=(const LinkExchange&) = delete;
+
+    size_t owner(const Link& link) const { return ring_.owner(link.hostName); }
+    size_t self() const { return options_.self; }
+
+    void forward(size_t node, const Link& link, int depth);
+
+    // Sends what is buffered and stops listening
+    void stop();
+
+private:
+    struct Peer {
+        std::string outbox;
+        size_t pending = 0;
+        std::unique_ptr<boost::beast::tcp_stream> stream;  // flush thread only
+        bool reachable = true;
+    };
+    struct Session;
+
+    void accept();
+    void read(std::shared_ptr<Session> session);
+    void flushLoop();
+    bool send(size_t node, const std::string& batch);
+    template <typename Start>
+    boost::system::error_code await(Peer& peer, Start start);
+
+    ClusterOptions options_;
+    HostRing ring_;
+    Receiver receiver_;
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::vector<Peer> peers_;
+    bool full_ = false;
+    bool stopping_ = false;
+
+    boost::asio::io_context ioc_{1};
+    boost::asio::io_context sendIoc_{1};
+    boost::asio::ip::tcp::acceptor acceptor_;
+    std::thread listener_;
+    std::thread flusher_;
+};
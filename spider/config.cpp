@@ -1,8 +1,8 @@
 #include "config.h"
+#include "async_logger.h"
 #include <fstream>
 #include <sstream>
 #include <algorithm>
-#include <iostream>
 
 namespace {
     inline void trim(std::string& s) {
@@ -20,7 +20,7 @@ namespace {
 bool Config::load(const std::string& filename) {
     std::ifstream file(filename);
     if (!file.is_open()) {
-        std::cerr << "Cannot open config file: " << filename << std::endl;
+        Log::error() << "Cannot open config file: " << filename;
         return false;
     }
 
@@ -0,0 +1,306 @@
+#include "crawl_pipeline.h"
+#include "async_logger.h"
+#include "doc_store.h"
+#include "html_parser.h"
+#include "link_graph.h"
+#include "shards.h"
+#include "spider_metrics.h"
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+    // Longest prefix of at most maxBytes that does not split a UTF-8 sequence
+    std::string_view truncateUtf8(std::string_view text, size_t maxBytes) {
+        if (text.size() <= maxBytes) {
+            return text;
+        }
+        size_t end = maxBytes;
+        while (end > 0 && (static_cast<unsigned char>(text[end]) & 0xC0) == 0x80) {
+            --end;
+        }
+        return text.substr(0, end);
+    }
+}
+
+CrawlPipeline::CrawlPipeline(PageSource& source, NearDuplicateIndex* duplicates, PipelineOptions options)
+    : source_(source)
+    , duplicates_(duplicates)
+    , options_(std::move(options))
+    , fetched_(options_.queueCapacity)
+    , parsed_(options_.queueCapacity)
+{
+    if (options_.parseThreads <= 0) {
+        options_.parseThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    options_.fetchThreads = std::max(1, options_.fetchThreads);
+    options_.indexThreads = std::max(1, options_.indexThreads);
+    options_.batchSize = std::max<size_t>(1, options_.batchSize);
+    if (options_.shards.empty()) {
+        throw std::invalid_argument("No index database configured");
+    }
+}
+
+CrawlPipeline::~CrawlPipeline() {
+    stop();
+}
+
+void CrawlPipeline::start() {
+    fetchersRunning_ = options_.fetchThreads;
+    parsersRunning_ = options_.parseThreads;
+    writersRunning_ = options_.indexThreads;
+
+    for (int i = 0; i < options_.fetchThreads; ++i) {
+        threads_.emplace_back(&CrawlPipeline::fetchLoop, this);
+    }
+    for (int i = 0; i < options_.parseThreads; ++i) {
+        threads_.emplace_back(&CrawlPipeline::parseLoop, this);
+    }
+    for (int i = 0; i < options_.indexThreads; ++i) {
+        threads_.emplace_back(&CrawlPipeline::indexLoop, this);
+    }
+}
+
+void CrawlPipeline::stop() {
+    source_.stop();
+    for (auto& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads_.clear();
+}
+
+void CrawlPipeline::fetchLoop() {
+    SpiderMetrics& m = SpiderMetrics::get();
+    SourcePage page;
+
+    while (source_.next(page)) {
+        m.bytesFetched.add(page.content.size());
+        if (!fetched_.push(std::move(page))) {
+            break;
+        }
+        m.fetchedQueue.set(static_cast<int64_t>(fetched_.size()));
+        page = SourcePage{};
+    }
+
+    // The last fetcher out lets the parsers drain and finish
+    if (--fetchersRunning_ == 0) {
+        fetched_.close();
+    }
+}
+
+void CrawlPipeline::parseLoop() {
+    SpiderMetrics& m = SpiderMetrics::get();
+    SourcePage page;
+
+    while (fetched_.pop(page)) {
+        m.busyWorkers.add(1);
+        try {
+            metrics::ScopedTimer parseTimer(m.parseSeconds);
+            IndexedPage indexed;
+            indexed.url = page.url;
+
+            // WET records are already plain text and have no title
+            std::string text = page.plainText ? page.content : HtmlParser::extractText(page.content);
+            indexed.title = page.plainText ? page.url : HtmlParser::extractTitle(page.content);
+            indexed.wordPositions = HtmlParser::wordPositions(text);
+            indexed.simhash = SimHash::compute(indexed.wordPositions);
+            if (options_.storeTextBytes > 0) {
+                indexed.text = DocumentStore::compress(truncateUtf8(text, options_.storeTextBytes));
+            }
+
+            // The link graph is kept for every HTML page, crawled further or not
+            if (!page.plainText) {
+                std::vector<Link> links = HtmlParser::extractLinks(page.link, page.content);
+                std::vector<uint64_t> targets;
+                targets.reserve(links.size());
+                uint64_t self = LinkGraph::urlHash(page.url);
+                for (const auto& link : links) {
+                    uint64_t target = LinkGraph::urlHash(link);
+                    if (target != self) {
+                        targets.push_back(target);
+                    }
+                }
+                indexed.links = LinkGraph::encodeTargets(std::move(targets));
+
+                if (source_.followsLinks() && page.depth > 0) {
+                    source_.addLinks(page, links);
+                }
+            }
+            parseTimer.stop();
+
+            parsed_.push(std::move(indexed));
+            m.parsedQueue.set(static_cast<int64_t>(parsed_.size()));
+        } catch (const std::exception& e) {
+            m.otherErrors.add();
+            Log::info() << "❌ Error processing " << page.url << ": " << e.what();
+        }
+        m.busyWorkers.add(-1);
+    }
+
+    if (--parsersRunning_ == 0) {
+        parsed_.close();
+    }
+}
+
+void CrawlPipeline::indexLoop() {
+    SpiderMetrics& m = SpiderMetrics::get();
+    Connections connections(options_.shards.size());
+    std::vector<IndexedPage> batch;
+
+    while (parsed_.popBatch(batch, options_.batchSize, options_.batchWait)) {
+        m.parsedQueue.set(static_cast<int64_t>(parsed_.size()));
+        m.busyWorkers.add(1);
+
+        // Every writer owns its connections; lost ones are reopened for the next batch
+        try {
+            writeBatch(connections, batch);
+        } catch (const std::exception& e) {
+            m.dbErrors.add(batch.size());
+            Log::error() << "❌ Database error, " << batch.size() << " pages not indexed: " << e.what();
+            for (auto& connection : connections) {
+                connection.reset();
+            }
+        }
+
+        batch.clear();
+        m.busyWorkers.add(-1);
+    }
+
+    --writersRunning_;
+}
+
+Database& CrawlPipeline::shardDatabase(Connections& connections, size_t shard) {
+    if (!connections[shard]) {
+        connections[shard] = std::make_unique<Database>(options_.shards[shard]);
+    }
+    return *connections[shard];
+}
+
+void CrawlPipeline::writeBatch(Connections& connections, std::vector<IndexedPage>& batch) {
+    SpiderMetrics& m = SpiderMetrics::get();
+    size_t shardCount = connections.size();
+
+    std::vector<IndexedPage> fresh;
+    std::vector<std::pair<std::string, int>> aliases;
+    // Near-duplicates of pages in this same batch: (page, fresh index), aliased once ids exist
+    std::vector<std::pair<std::string, size_t>> batchAliases;
+    for (auto& page : batch) {
+        std::optional<int> canonical;
+        std::optional<size_t> inBatch;
+        if (duplicates_) {
+            canonical = duplicates_->find(page.simhash);
+            for (size_t i = 0; !canonical && !inBatch && i < fresh.size(); ++i) {
+                if (SimHash::distance(page.simhash, fresh[i].simhash) <= duplicates_->maxDistance()) {
+                    inBatch = i;
+                }
+            }
+        }
+        if (canonical) {
+            // Mirrors and printer/session variants only get an alias row
+            Log::info() << "🪞 Near-duplicate of document " << *canonical << ": " << page.url;
+            aliases.emplace_back(std::move(page.url), *canonical);
+        } else if (inBatch) {
+            batchAliases.emplace_back(std::move(page.url), *inBatch);
+        } else {
+            fresh.push_back(std::move(page));
+        }
+    }
+
+    metrics::ScopedTimer writeTimer(m.dbWriteSeconds);
+    std::vector<int> ids(fresh.size(), 0);
+    if (shardCount == 1) {
+        ids = writePages(shardDatabase(connections, 0), fresh);
+    } else {
+        std::vector<std::vector<size_t>> members(shardCount);
+        for (size_t i = 0; i < fresh.size(); ++i) {
+            members[shards::shardOfUrl(fresh[i].url, shardCount)].push_back(i);
+        }
+
+        std::vector<IndexedPage> part;
+        for (size_t shard = 0; shard < shardCount; ++shard) {
+            if (members[shard].empty()) {
+                continue;
+            }
+            part.clear();
+            for (size_t i : members[shard]) {
+                part.push_back(std::move(fresh[i]));
+            }
+            std::vector<int> partIds = writePages(shardDatabase(connections, shard), part);
+            for (size_t j = 0; j < part.size(); ++j) {
+                ids[members[shard][j]] = partIds[j];
+                fresh[members[shard][j]] = std::move(part[j]);
+            }
+        }
+    }
+
+    for (auto& [url, index] : batchAliases) {
+        if (ids[index] != 0) {
+            Log::info() << "🪞 Near-duplicate of document " << ids[index] << ": " << url;
+            aliases.emplace_back(std::move(url), ids[index]);
+        }
+    }
+
+    // An alias lives next to its canonical document
+    std::vector<std::vector<std::pair<std::string, int>>> shardAliases(shardCount);
+    for (auto& alias : aliases) {
+        shardAliases[shards::shardOfDocument(alias.second, shardCount)].push_back(std::move(alias));
+    }
+    for (size_t shard = 0; shard < shardCount; ++shard) {
+        if (!shardAliases[shard].empty()) {
+            Database& database = shardDatabase(connections, shard);
+            if (options_.bulkLoad) {
+                database.stageAliases(shardAliases[shard]);
+            } else {
+                database.addAliases(shardAliases[shard]);
+            }
+        }
+    }
+    m.pagesDuplicate.add(aliases.size());
+    writeTimer.stop();
+
+    for (size_t i = 0; i < fresh.size(); ++i) {
+        if (ids[i] == 0) {
+            continue;
+        }
+        if (duplicates_) {
+            duplicates_->insert(fresh[i].simhash, ids[i]);
+        }
+        m.pagesIndexed.add();
+        Log::info() << "✅ Indexed: " << fresh[i].url << " (unique words: " << fresh[i].wordPositions.size() << ")";
+    }
+}
+
+std::vector<int> CrawlPipeline::writePages(Database& database, const std::vector<IndexedPage>& pages) {
+    // Bulk load stages pages; finishBulkLoad merges them after the crawl
+    auto write = [&](const std::vector<IndexedPage>& part) {
+        return options_.bulkLoad ? database.stageBatch(part) : database.indexBatch(part);
+    };
+
+    std::vector<int> ids;
+    try {
+        ids = write(pages);
+    } catch (const pqxx::broken_connection&) {
+        throw;
+    } catch (const pqxx::failure&) {
+        if (pages.size() == 1) {
+            throw;
+        }
+
+        // One bad page must not cost the rest of the batch
+        ids.assign(pages.size(), 0);
+        for (size_t i = 0; i < pages.size(); ++i) {
+            try {
+                ids[i] = write({pages[i]}).front();
+            } catch (const pqxx::broken_connection&) {
+                throw;
+            } catch (const pqxx::failure& e) {
+                SpiderMetrics::get().dbErrors.add();
+                Log::error() << "❌ Database error processing " << pages[i].url << ": " << e.what();
+            }
+        }
+    }
+    return ids;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bounded_queue.h"
+#include "database.h"
+#include "page_source.h"
+#include "simhash.h"
+
+struct PipelineOptions {
+    std::vector<std::string> shards;    // connection string per index shard
+
+    int fetchThreads = 8;
+    int parseThreads = 0;           // 0: one per core
+    int indexThreads = 2;           // each with its own connections
+    size_t queueCapacity = 256;     // pages between two stages
+    size_t batchSize = 32;          // pages per index transaction
+    std::chrono::milliseconds batchWait{200};
+    size_t storeTextBytes = 262144; // 0 disables the snippet text store
+    bool bulkLoad = false;          // write to staging tables (Database::beginBulkLoad)
+};
+
+// The crawl as three stages with their own thread counts, so fetching (I/O
+// bound), parsing (CPU bound) and index writes (database latency bound)
+// can each be saturated:
+//
+//   PageSource::next  ->  [fetched]  ->  parse  ->  [parsed]  ->  batched index writes
+//
+// With several shards, each batch is split by URL hash and every part is
+// written to its shard's database.
+//
+// The bounded queues between the stages provide backpressure. When the
+// source is exhausted or stopped, the stages drain in order and exit.
+class CrawlPipeline {
+public:
+    // duplicates may be null when deduplication is off
+    CrawlPipeline(PageSource& source, NearDuplicateIndex* duplicates, PipelineOptions options);
+    ~CrawlPipeline();
+
+    CrawlPipeline(const CrawlPipeline&) = delete;
+    CrawlPipeline& operator=(const CrawlPipeline&) = delete;
+
+    void start();
+    // True once every stage has drained
+    bool finished() const { return writersRunning_ == 0; }
+    // Stops the source and waits for the pages already fetched to be indexed
+    void stop();
+
+    const PipelineOptions& options() const { return options_; }
+
+private:
+    void fetchLoop();
+    void parseLoop();
+    using Connections = std::vector<std::unique_ptr<Database>>;
+
+    void indexLoop();
+    void writeBatch(Connections& connections, std::vector<IndexedPage>& batch);
+    Database& shardDatabase(Connections& connections, size_t shard);
+    std::vector<int> writePages(Database& database, const std::vector<IndexedPage>& pages);
+
+    PageSource& source_;
+    NearDuplicateIndex* duplicates_;
+    PipelineOptions options_;
+
+    BoundedQueue<SourcePage> fetched_;
+    BoundedQueue<IndexedPage> parsed_;
+
+    std::vector<std::thread> threads_;
+    std::atomic<int> fetchersRunning_{0};
+    std::atomic<int> parsersRunning_{0};
+    std::atomic<int> writersRunning_{0};
+};
@@ -1,12 +1,274 @@
 #include "database.h"
-#include <iostream>
+#include "async_logger.h"
+#include <algorithm>
+#include <map>
+#include <string_view>
+
+namespace {
+    // Postgres array literal for passing a whole column as one parameter,
+    // e.g. {"a","b"} for text[] or {"\\x0102"} for bytea[]
+    class ArrayLiteral {
+    public:
+        ArrayLiteral() : text_("{") {}
+
+        void add(long long value) {
+            separate();
+            text_ += std::to_string(value);
+        }
+
+        void add(std::string_view value) {
+            separate();
+            text_ += '"';
+            for (char c : value) {
+                if (c == '"' || c == '\\') text_ += '\\';
+                if (c != '\0') text_ += c;
+            }
+            text_ += '"';
+        }
+
+        void add(const std::basic_string<std::byte>& value) {
+            static const char* hex = "0123456789abcdef";
+            separate();
+            text_ += "\"\\\\x";
+            for (std::byte b : value) {
+                text_ += hex[std::to_integer<unsigned>(b) >> 4];
+                text_ += hex[std::to_integer<unsigned>(b) & 15];
+            }
+            text_ += '"';
+        }
+
+        bool empty() const { return text_.size() == 1; }
+        std::string str() const { return text_ + '}'; }
+
+    private:
+        void separate() {
+            if (text_.size() > 1) text_ += ',';
+        }
+
+        std::string text_;
+    };
+
+    // Postgres text cannot hold NUL bytes
+    std::string withoutNul(std::string_view value) {
+        std::string text(value);
+        text.erase(std::remove(text.begin(), text.end(), '\0'), text.end());
+        return text;
+    }
+
+    // Sorted by document id; on a duplicate id the update wins
+    std::vector<Posting> mergePostings(const std::vector<Posting>& stored, const std::vector<Posting>& updates) {
+        std::vector<Posting> merged;
+        merged.reserve(stored.size() + updates.size());
+        auto a = stored.begin();
+        auto b = updates.begin();
+        while (a != stored.end() || b != updates.end()) {
+            if (b == updates.end() || (a != stored.end() && a->documentId < b->documentId)) {
+                merged.push_back(*a++);
+            } else {
+                if (a != stored.end() && a->documentId == b->documentId) ++a;
+                merged.push_back(*b++);
+            }
+        }
+        return merged;
+    }
+
+    // Adds the postings as rows for posting_blocks. An overfull block is
+    // split evenly, so inserts in the middle of a list leave no slivers.
+    void addBlocks(int wordId, const std::vector<Posting>& postings, ArrayLiteral& words,
+                   ArrayLiteral& firsts, ArrayLiteral& lasts, ArrayLiteral& counts, ArrayLiteral& data) {
+        size_t pieces = (postings.size() + PostingBlock::kBlockPostings - 1) / PostingBlock::kBlockPostings;
+        for (size_t piece = 0, start = 0; piece < pieces; ++piece) {
+            size_t end = postings.size() * (piece + 1) / pieces;
+            size_t count = end - start;
+            words.add(wordId);
+            firsts.add(static_cast<long long>(postings[start].documentId));
+            lasts.add(static_cast<long long>(postings[start + count - 1].documentId));
+            counts.add(static_cast<long long>(count));
+            data.add(PostingBlock::encode(postings.data() + start, count));
+            start = end;
+        }
+    }
+
+    // Merges postings (per word, sorted by document id) into posting_blocks.
+    // A posting belongs to the last block of its word starting at or before
+    // its document, or to the first block; only blocks that get postings
+    // are read and rewritten, and one that outgrows kBlockPostings is split.
+    void mergePostingBlocks(pqxx::work& txn, const std::map<int, std::vector<Posting>>& postings) {
+        if (postings.empty()) {
+            return;
+        }
+
+        // Concurrent writers would rewrite a block from stale copies;
+        // searches only read and are not blocked
+        txn.exec("LOCK TABLE posting_blocks IN SHARE ROW EXCLUSIVE MODE");
+
+        ArrayLiteral probeWords, probeDocuments;
+        for (const auto& [wordId, list] : postings) {
+            for (const auto& posting : list) {
+                probeWords.add(wordId);
+                probeDocuments.add(static_cast<long long>(posting.documentId));
+            }
+        }
+        pqxx::result r = txn.exec_params(
+            "WITH k AS ("
+            "SELECT DISTINCT t.word_id, COALESCE("
+            "(SELECT MAX(b.first_document) FROM posting_blocks b "
+            "WHERE b.word_id = t.word_id AND b.first_document <= t.document_id), "
+            "(SELECT MIN(b.first_document) FROM posting_blocks b WHERE b.word_id = t.word_id)"
+            ") AS first_document "
+            "FROM unnest($1::integer[], $2::integer[]) AS t(word_id, document_id)"
+            ") "
+            "SELECT b.word_id, b.first_document, b.data FROM posting_blocks b "
+            "JOIN k ON k.word_id = b.word_id AND k.first_document = b.first_document",
+            probeWords.str(), probeDocuments.str()
+        );
+
+        // Word -> block start -> its postings
+        std::map<int, std::map<uint32_t, std::vector<Posting>>> stored;
+        for (const auto& row : r) {
+            auto& block = stored[row[0].as<int>()][static_cast<uint32_t>(row[1].as<int>())];
+            PostingBlock::decode(row[2].as<std::basic_string<std::byte>>(), block);
+        }
+
+        ArrayLiteral oldWords, oldFirsts;
+        ArrayLiteral words, firsts, lasts, counts, data;
+        for (const auto& [wordId, list] : postings) {
+            auto& blocks = stored[wordId];
+            std::map<uint32_t, std::vector<Posting>> updates;
+            for (const auto& posting : list) {
+                auto it = blocks.upper_bound(posting.documentId);
+                if (it != blocks.begin()) {
+                    --it;
+                }
+                if (it == blocks.end()) {
+                    // The word's first block
+                    it = blocks.emplace(posting.documentId, std::vector<Posting>{}).first;
+                }
+                updates[it->first].push_back(posting);
+            }
+
+            for (const auto& [first, added] : updates) {
+                const auto& block = blocks.at(first);
+                if (!block.empty()) {
+                    oldWords.add(wordId);
+                    oldFirsts.add(static_cast<long long>(first));
+                }
+                addBlocks(wordId, mergePostings(block, added), words, firsts, lasts, counts, data);
+            }
+        }
+
+        if (!oldWords.empty()) {
+            txn.exec_params(
+                "DELETE FROM posting_blocks b "
+                "USING unnest($1::integer[], $2::integer[]) AS t(word_id, first_document) "
+                "WHERE b.word_id = t.word_id AND b.first_document = t.first_document",
+                oldWords.str(), oldFirsts.str()
+            );
+        }
+        txn.exec_params(
+            "INSERT INTO posting_blocks (word_id, first_document, last_document, postings, data) "
+            "SELECT * FROM unnest($1::integer[], $2::integer[], $3::integer[], $4::integer[], $5::bytea[])",
+            words.str(), firsts.str(), lasts.str(), counts.str(), data.str()
+        );
+    }
+
+    // Moves the postings of merge_postings into posting_blocks. Postings past
+    // the last block of their word, which is all of them in a new index, are
+    // packed as the rows stream by and COPYed; the rest are merged. So that
+    // repeated loads do not leave a part-filled block per word behind, the
+    // first postings past the last block are merged into it until it is full.
+    void packMergedPostings(pqxx::work& txn) {
+        constexpr size_t kFetchRows = 100000;
+
+        txn.exec("LOCK TABLE posting_blocks IN SHARE ROW EXCLUSIVE MODE");
+
+        struct Tail {
+            uint32_t lastDocument;
+            size_t room;        // postings the last block still takes
+        };
+        std::unordered_map<int, Tail> tails;
+        pqxx::result r = txn.exec(
+            "SELECT DISTINCT ON (word_id) word_id, last_document, postings FROM posting_blocks "
+            "WHERE word_id IN (SELECT DISTINCT word_id FROM merge_postings) "
+            "ORDER BY word_id, first_document DESC"
+        );
+        for (const auto& row : r) {
+            size_t postings = static_cast<size_t>(row[2].as<int>());
+            tails.emplace(row[0].as<int>(), Tail{static_cast<uint32_t>(row[1].as<int>()),
+                PostingBlock::kBlockPostings - std::min(postings, PostingBlock::kBlockPostings)});
+        }
+
+        txn.exec(
+            "DECLARE merge_postings_cursor NO SCROLL CURSOR FOR "
+            "SELECT word_id, document_id, frequency FROM merge_postings ORDER BY word_id, document_id"
+        );
+
+        std::map<int, std::vector<Posting>> overlapping;
+        size_t overlappingCount = 0;
+        int runWord = 0;
+        std::vector<Posting> run;       // appended postings of runWord not yet written
+        while (true) {
+            r = txn.exec("FETCH " + std::to_string(kFetchRows) + " FROM merge_postings_cursor");
+
+            auto stream = pqxx::stream_to::table(txn, {"posting_blocks"},
+                {"word_id", "first_document", "last_document", "postings", "data"});
+            auto writeRun = [&] {
+                for (size_t start = 0; start < run.size(); start += PostingBlock::kBlockPostings) {
+                    size_t count = std::min(PostingBlock::kBlockPostings, run.size() - start);
+                    stream.write_values(runWord, static_cast<int>(run[start].documentId),
+                        static_cast<int>(run[start + count - 1].documentId), static_cast<int>(count),
+                        PostingBlock::encode(run.data() + start, count));
+                }
+                run.clear();
+            };
+
+            for (const auto& row : r) {
+                int wordId = row[0].as<int>();
+                Posting posting{static_cast<uint32_t>(row[1].as<int>()), static_cast<uint32_t>(row[2].as<int>())};
+                if (wordId != runWord) {
+                    writeRun();
+                    runWord = wordId;
+                }
+
+                auto tail = tails.find(wordId);
+                if (tail != tails.end()
+                    && (posting.documentId <= tail->second.lastDocument || tail->second.room > 0)) {
+                    if (posting.documentId > tail->second.lastDocument) {
+                        --tail->second.room;
+                    }
+                    overlapping[wordId].push_back(posting);
+                    ++overlappingCount;
+                    continue;
+                }
+                run.push_back(posting);
+                if (run.size() == PostingBlock::kBlockPostings) {
+                    writeRun();
+                }
+            }
+            if (r.empty()) {
+                writeRun();
+            }
+            stream.complete();
+
+            if (overlappingCount >= kFetchRows || r.empty()) {
+                mergePostingBlocks(txn, overlapping);
+                overlapping.clear();
+                overlappingCount = 0;
+            }
+            if (r.empty()) {
+                break;
+            }
+        }
+        txn.exec("CLOSE merge_postings_cursor");
+    }
+}
 
 Database::Database(const std::string& connection_string) {
     try {
         conn_ = std::make_unique<pqxx::connection>(connection_string);
-        std::cout << "✅ Connected to database: " << conn_->dbname() << std::endl;
+        Log::info() << "✅ Connected to database: " << conn_->dbname();
     } catch (const std::exception& e) {
-        std::cerr << "❌ Database connection error: " << e.what() << std::endl;
+        Log::error() << "❌ Database connection error: " << e.what();
         throw;
     }
 }
@@ -29,7 +291,7 @@ void Database::initializeDatabase() {
         );
 
         if (r.size() < 3) {
-            std::cout << "📝 Creating database tables..." << std::endl;
+            Log::info() << "📝 Creating database tables...";
 
             txn.exec(
                 "CREATE TABLE IF NOT EXISTS documents ("
@@ -56,88 +318,614 @@ void Database::initializeDatabase() {
                 ")"
             );
 
-            // Create indexes
-            txn.exec("CREATE INDEX IF NOT EXISTS idx_documents_url ON documents(url)");
-            txn.exec("CREATE INDEX IF NOT EXISTS idx_words_word ON words(word)");
+            // url, word and (document_id, word_id) are already indexed by their constraints
             txn.exec("CREATE INDEX IF NOT EXISTS idx_word_freq_word_id ON word_frequencies(word_id)");
-            txn.exec("CREATE INDEX IF NOT EXISTS idx_word_freq_doc_id ON word_frequencies(document_id)");
         }
 
+        // Duplicates of the constraint indexes, created by older versions;
+        // every insert paid for them
+        txn.exec("DROP INDEX IF EXISTS idx_documents_url");
+        txn.exec("DROP INDEX IF EXISTS idx_words_word");
+        txn.exec("DROP INDEX IF EXISTS idx_word_freq_doc_id");
+
+        // Term positions live apart from frequencies, so bag-of-words
+        // queries never read or decode them
+        txn.exec(
+            "CREATE TABLE IF NOT EXISTS word_positions ("
+            "document_id INTEGER REFERENCES documents(id) ON DELETE CASCADE, "
+            "word_id INTEGER REFERENCES words(id) ON DELETE CASCADE, "
+            "positions BYTEA NOT NULL, "
+            "PRIMARY KEY (document_id, word_id)"
+            ")"
+        );
+
+        // Postings packed per word for [index] postings=blocks: each row is
+        // a PostingBlock of consecutive document ids of one word
+        txn.exec(
+            "CREATE TABLE IF NOT EXISTS posting_blocks ("
+            "word_id INTEGER REFERENCES words(id) ON DELETE CASCADE, "
+            "first_document INTEGER NOT NULL, "
+            "last_document INTEGER NOT NULL, "
+            "postings INTEGER NOT NULL, "
+            "data BYTEA NOT NULL, "
+            "PRIMARY KEY (word_id, first_document)"
+            ")"
+        );
+        // The blocks are already packed, pglz would only waste time on them
+        txn.exec("ALTER TABLE posting_blocks ALTER COLUMN data SET STORAGE EXTERNAL");
+
+        // Near-duplicate detection: fingerprint of every canonical document,
+        // and the URLs that were collapsed into one
+        txn.exec("ALTER TABLE documents ADD COLUMN IF NOT EXISTS simhash BIGINT");
+        txn.exec(
+            "CREATE TABLE IF NOT EXISTS document_aliases ("
+            "url TEXT PRIMARY KEY, "
+            "document_id INTEGER REFERENCES documents(id) ON DELETE CASCADE"
+            ")"
+        );
+
+        // Extracted page text for snippets, compressed with DocumentStore
+        txn.exec(
+            "CREATE TABLE IF NOT EXISTS document_texts ("
+            "document_id INTEGER PRIMARY KEY REFERENCES documents(id) ON DELETE CASCADE, "
+            "body BYTEA NOT NULL"
+            ")"
+        );
+
+        // Outgoing links of each page (LinkGraph format) and the PageRank computed from them
+        txn.exec(
+            "CREATE TABLE IF NOT EXISTS document_links ("
+            "document_id INTEGER PRIMARY KEY REFERENCES documents(id) ON DELETE CASCADE, "
+            "targets BYTEA NOT NULL"
+            ")"
+        );
+        txn.exec("ALTER TABLE documents ADD COLUMN IF NOT EXISTS page_rank REAL");
+
+        // Bumped after each indexed document so the server can invalidate its query cache
+        txn.exec("CREATE SEQUENCE IF NOT EXISTS index_generation");
+
         txn.commit();
-        std::cout << "✅ Database initialized successfully" << std::endl;
+        Log::info() << "✅ Database initialized successfully";
 
     } catch (const std::exception& e) {
-        std::cerr << "❌ Database initialization error: " << e.what() << std::endl;
+        Log::error() << "❌ Database initialization error: " << e.what();
         throw;
     }
 }
 
-int Database::addDocument(const std::string& url, const std::string& title) {
+std::basic_string<std::byte> Database::encodePositions(const std::vector<uint32_t>& positions) {
+    std::basic_string<std::byte> out;
+    out.reserve(positions.size() * 2);
+
+    uint32_t previous = 0;
+    for (uint32_t position : positions) {
+        uint32_t delta = position - previous;
+        previous = position;
+        while (delta >= 0x80) {
+            out.push_back(static_cast<std::byte>((delta & 0x7F) | 0x80));
+            delta >>= 7;
+        }
+        out.push_back(static_cast<std::byte>(delta));
+    }
+
+    return out;
+}
+
+std::vector<std::pair<int, uint64_t>> Database::loadSimHashes() {
+    std::vector<std::pair<int, uint64_t>> fingerprints;
+    try {
+        pqxx::read_transaction txn(*conn_);
+        pqxx::result r = txn.exec("SELECT id, simhash FROM documents WHERE simhash IS NOT NULL");
+
+        fingerprints.reserve(r.size());
+        for (const auto& row : r) {
+            fingerprints.emplace_back(row[0].as<int>(), static_cast<uint64_t>(row[1].as<long long>()));
+        }
+    } catch (const std::exception& e) {
+        Log::error() << "❌ Error loading document fingerprints: " << e.what();
+        throw;
+    }
+    return fingerprints;
+}
+
+void Database::assignShard(size_t shard, size_t shardCount) {
+    // Ids step by shardCount from the first free one congruent to shard,
+    // so id % shardCount names the shard holding a document
     try {
         pqxx::work txn(*conn_);
+        pqxx::result r = txn.exec(
+            "SELECT GREATEST(COALESCE((SELECT MAX(id) FROM documents), 0), "
+            "(SELECT last_value FROM documents_id_seq))");
+        long long used = r.empty() ? 0 : r[0][0].as<long long>();
 
-        pqxx::result r = txn.exec_params(
-            "INSERT INTO documents (url, title) VALUES ($1, $2) "
-            "ON CONFLICT (url) DO UPDATE SET title = EXCLUDED.title "
-            "RETURNING id",
-            url, title
-        );
+        long long count = static_cast<long long>(shardCount);
+        long long next = used + 1;
+        next += (static_cast<long long>(shard) - next % count + count) % count;
 
+        txn.exec("ALTER SEQUENCE documents_id_seq INCREMENT BY " + std::to_string(count));
+        txn.exec_params("SELECT setval('documents_id_seq', $1, false)", next);
         txn.commit();
-        return r[0][0].as<int>();
     } catch (const std::exception& e) {
-        std::cerr << "❌ Error adding document: " << e.what() << std::endl;
+        Log::error() << "❌ Error assigning shard " << shard << ": " << e.what();
         throw;
     }
 }
 
-int Database::addWord(const std::string& word) {
+std::vector<int> Database::indexBatch(const std::vector<IndexedPage>& pages) {
+    std::vector<int> ids(pages.size(), 0);
+    if (pages.empty()) {
+        return ids;
+    }
+
     try {
+        // A URL twice in one statement would trip ON CONFLICT, so the last
+        // copy wins. Sorted URLs and words make concurrent writers take
+        // row locks in the same order instead of deadlocking.
+        std::map<std::string_view, const IndexedPage*> latest;
+        for (const auto& page : pages) {
+            latest[page.url] = &page;
+        }
+
+        ArrayLiteral urls, titles, simhashes;
+        for (const auto& [url, page] : latest) {
+            urls.add(url);
+            titles.add(page->title);
+            simhashes.add(static_cast<long long>(page->simhash));
+        }
+
         pqxx::work txn(*conn_);
 
         pqxx::result r = txn.exec_params(
-            "INSERT INTO words (word) VALUES ($1) "
-            "ON CONFLICT (word) DO UPDATE SET word = EXCLUDED.word "
-            "RETURNING id",
-            word
+            "INSERT INTO documents (url, title, simhash) "
+            "SELECT * FROM unnest($1::text[], $2::text[], $3::bigint[]) "
+            "ON CONFLICT (url) DO UPDATE SET title = EXCLUDED.title, simhash = EXCLUDED.simhash "
+            "RETURNING id, url",
+            urls.str(), titles.str(), simhashes.str()
         );
 
+        std::unordered_map<std::string, int> documentIds;
+        for (const auto& row : r) {
+            documentIds.emplace(row[1].as<std::string>(), row[0].as<int>());
+        }
+        for (size_t i = 0; i < pages.size(); ++i) {
+            ids[i] = documentIds.at(pages[i].url);
+        }
+
+        std::vector<std::string_view> words;
+        for (const auto& [url, page] : latest) {
+            for (const auto& entry : page->wordPositions) {
+                words.push_back(entry.first);
+            }
+        }
+        std::sort(words.begin(), words.end());
+        words.erase(std::unique(words.begin(), words.end()), words.end());
+
+        std::unordered_map<std::string, int> wordIds;
+        if (!words.empty()) {
+            ArrayLiteral wordArray;
+            for (auto word : words) {
+                wordArray.add(word);
+            }
+            std::string wordList = wordArray.str();
+
+            txn.exec_params(
+                "INSERT INTO words (word) SELECT unnest($1::text[]) ON CONFLICT (word) DO NOTHING",
+                wordList
+            );
+            r = txn.exec_params("SELECT word, id FROM words WHERE word = ANY($1::text[])", wordList);
+            for (const auto& row : r) {
+                wordIds.emplace(row[0].as<std::string>(), row[1].as<int>());
+            }
+        }
+
+        ArrayLiteral postingDocuments, postingWords, frequencies, positionStreams;
+        ArrayLiteral textDocuments, textBodies;
+        ArrayLiteral linkDocuments, linkTargets;
+        std::map<int, std::vector<Posting>> wordPostings;
+        for (const auto& [url, page] : latest) {
+            int documentId = documentIds.at(page->url);
+            for (const auto& [word, positions] : page->wordPositions) {
+                postingDocuments.add(documentId);
+                postingWords.add(wordIds.at(word));
+                frequencies.add(static_cast<long long>(positions.size()));
+                positionStreams.add(encodePositions(positions));
+                if (postingLayout_ == PostingLayout::Blocks) {
+                    wordPostings[wordIds.at(word)].push_back(
+                        {static_cast<uint32_t>(documentId), static_cast<uint32_t>(positions.size())});
+                }
+            }
+            if (!page->text.empty()) {
+                textDocuments.add(documentId);
+                textBodies.add(page->text);
+            }
+            if (!page->links.empty()) {
+                linkDocuments.add(documentId);
+                linkTargets.add(page->links);
+            }
+        }
+
+        if (postingLayout_ == PostingLayout::Blocks) {
+            if (!postingDocuments.empty()) {
+                txn.exec_params(
+                    "INSERT INTO word_positions (document_id, word_id, positions) "
+                    "SELECT * FROM unnest($1::integer[], $2::integer[], $3::bytea[]) "
+                    "ON CONFLICT (document_id, word_id) DO UPDATE SET positions = EXCLUDED.positions",
+                    postingDocuments.str(), postingWords.str(), positionStreams.str()
+                );
+            }
+            for (auto& [wordId, list] : wordPostings) {
+                std::sort(list.begin(), list.end(),
+                    [](const Posting& a, const Posting& b) { return a.documentId < b.documentId; });
+            }
+            mergePostingBlocks(txn, wordPostings);
+        } else if (!postingDocuments.empty()) {
+            txn.exec_params(
+                "WITH wf AS ("
+                "INSERT INTO word_frequencies (document_id, word_id, frequency) "
+                "SELECT * FROM unnest($1::integer[], $2::integer[], $3::integer[]) "
+                "ON CONFLICT (document_id, word_id) DO UPDATE SET frequency = EXCLUDED.frequency"
+                ") "
+                "INSERT INTO word_positions (document_id, word_id, positions) "
+                "SELECT * FROM unnest($1::integer[], $2::integer[], $4::bytea[]) "
+                "ON CONFLICT (document_id, word_id) DO UPDATE SET positions = EXCLUDED.positions",
+                postingDocuments.str(), postingWords.str(), frequencies.str(), positionStreams.str()
+            );
+        }
+
+        if (!textDocuments.empty()) {
+            txn.exec_params(
+                "INSERT INTO document_texts (document_id, body) "
+                "SELECT * FROM unnest($1::integer[], $2::bytea[]) "
+                "ON CONFLICT (document_id) DO UPDATE SET body = EXCLUDED.body",
+                textDocuments.str(), textBodies.str()
+            );
+        }
+
+        if (!linkDocuments.empty()) {
+            txn.exec_params(
+                "INSERT INTO document_links (document_id, targets) "
+                "SELECT * FROM unnest($1::integer[], $2::bytea[]) "
+                "ON CONFLICT (document_id) DO UPDATE SET targets = EXCLUDED.targets",
+                linkDocuments.str(), linkTargets.str()
+            );
+        }
+
+        txn.exec("SELECT nextval('index_generation')");
         txn.commit();
-        return r[0][0].as<int>();
     } catch (const std::exception& e) {
-        std::cerr << "❌ Error adding word: " << e.what() << std::endl;
+        Log::error() << "❌ Error writing batch of " << pages.size() << " pages: " << e.what();
         throw;
     }
+    return ids;
 }
 
-void Database::addWordFrequency(int document_id, int word_id, int frequency) {
+void Database::addAliases(const std::vector<std::pair<std::string, int>>& aliases) {
+    if (aliases.empty()) {
+        return;
+    }
+
     try {
+        std::map<std::string_view, int> latest;
+        for (const auto& [url, documentId] : aliases) {
+            latest[url] = documentId;
+        }
+
+        ArrayLiteral urls, documentIds;
+        for (const auto& [url, documentId] : latest) {
+            urls.add(url);
+            documentIds.add(documentId);
+        }
+
         pqxx::work txn(*conn_);
 
+        // A page re-crawled under its own URL is not an alias of itself
         txn.exec_params(
-            "INSERT INTO word_frequencies (document_id, word_id, frequency) "
-            "VALUES ($1, $2, $3) "
-            "ON CONFLICT (document_id, word_id) DO UPDATE SET frequency = EXCLUDED.frequency",
-            document_id, word_id, frequency
+            "INSERT INTO document_aliases (url, document_id) "
+            "SELECT a.url, a.document_id FROM unnest($1::text[], $2::integer[]) AS a(url, document_id) "
+            "WHERE NOT EXISTS (SELECT 1 FROM documents d WHERE d.url = a.url) "
+            "ON CONFLICT (url) DO UPDATE SET document_id = EXCLUDED.document_id",
+            urls.str(), documentIds.str()
         );
 
         txn.commit();
     } catch (const std::exception& e) {
-        std::cerr << "❌ Error adding word frequency: " << e.what() << std::endl;
+        Log::error() << "❌ Error adding document aliases: " << e.what();
         throw;
     }
 }
 
-bool Database::documentExists(const std::string& url) {
+void Database::beginBulkLoad() {
     try {
         pqxx::work txn(*conn_);
+
+        // Unlogged and without indexes or constraints: rows go in at COPY speed
+        txn.exec(
+            "CREATE UNLOGGED TABLE IF NOT EXISTS bulk_documents ("
+            "id INTEGER NOT NULL, url TEXT NOT NULL, title TEXT, simhash BIGINT)"
+        );
+        txn.exec(
+            "CREATE UNLOGGED TABLE IF NOT EXISTS bulk_postings ("
+            "document_id INTEGER NOT NULL, word TEXT NOT NULL, "
+            "frequency INTEGER NOT NULL, positions BYTEA NOT NULL)"
+        );
+        txn.exec(
+            "CREATE UNLOGGED TABLE IF NOT EXISTS bulk_texts ("
+            "document_id INTEGER NOT NULL, body BYTEA NOT NULL)"
+        );
+        txn.exec(
+            "CREATE UNLOGGED TABLE IF NOT EXISTS bulk_links ("
+            "document_id INTEGER NOT NULL, targets BYTEA NOT NULL)"
+        );
+        txn.exec(
+            "CREATE UNLOGGED TABLE IF NOT EXISTS bulk_aliases ("
+            "url TEXT NOT NULL, document_id INTEGER NOT NULL)"
+        );
+
+        pqxx::result r = txn.exec("SELECT count(*) FROM bulk_documents");
+        long long staged = r.empty() ? 0 : r[0][0].as<long long>();
+        txn.commit();
+
+        Log::info() << "📦 Bulk load into staging tables"
+                    << (staged > 0 ? ", resuming with " + std::to_string(staged) + " staged pages" : "");
+    } catch (const std::exception& e) {
+        Log::error() << "❌ Error preparing bulk load: " << e.what();
+        throw;
+    }
+}
+
+std::vector<int> Database::stageBatch(const std::vector<IndexedPage>& pages) {
+    std::vector<int> ids;
+    if (pages.empty()) {
+        return ids;
+    }
+
+    try {
+        pqxx::work txn(*conn_);
+
+        // Ids come from the live sequence, so they are final for new URLs
+        // and keep the shard's stride
         pqxx::result r = txn.exec_params(
-            "SELECT 1 FROM documents WHERE url = $1",
-            url
+            "SELECT nextval('documents_id_seq') FROM generate_series(1, $1)",
+            static_cast<int>(pages.size())
+        );
+        ids.reserve(pages.size());
+        for (const auto& row : r) {
+            ids.push_back(row[0].as<int>());
+        }
+
+        auto documents = pqxx::stream_to::table(txn, {"bulk_documents"}, {"id", "url", "title", "simhash"});
+        for (size_t i = 0; i < pages.size(); ++i) {
+            documents.write_values(ids[i], withoutNul(pages[i].url), withoutNul(pages[i].title),
+                static_cast<long long>(pages[i].simhash));
+        }
+        documents.complete();
+
+        auto postings = pqxx::stream_to::table(txn, {"bulk_postings"}, {"document_id", "word", "frequency", "positions"});
+        for (size_t i = 0; i < pages.size(); ++i) {
+            for (const auto& [word, positions] : pages[i].wordPositions) {
+                postings.write_values(ids[i], word, static_cast<int>(positions.size()), encodePositions(positions));
+            }
+        }
+        postings.complete();
+
+        auto texts = pqxx::stream_to::table(txn, {"bulk_texts"}, {"document_id", "body"});
+        for (size_t i = 0; i < pages.size(); ++i) {
+            if (!pages[i].text.empty()) {
+                texts.write_values(ids[i], pages[i].text);
+            }
+        }
+        texts.complete();
+
+        auto links = pqxx::stream_to::table(txn, {"bulk_links"}, {"document_id", "targets"});
+        for (size_t i = 0; i < pages.size(); ++i) {
+            if (!pages[i].links.empty()) {
+                links.write_values(ids[i], pages[i].links);
+            }
+        }
+        links.complete();
+
+        txn.commit();
+    } catch (const std::exception& e) {
+        Log::error() << "❌ Error staging batch of " << pages.size() << " pages: " << e.what();
+        throw;
+    }
+    return ids;
+}
+
+void Database::stageAliases(const std::vector<std::pair<std::string, int>>& aliases) {
+    if (aliases.empty()) {
+        return;
+    }
+
+    try {
+        pqxx::work txn(*conn_);
+        auto stream = pqxx::stream_to::table(txn, {"bulk_aliases"}, {"url", "document_id"});
+        for (const auto& [url, documentId] : aliases) {
+            stream.write_values(withoutNul(url), documentId);
+        }
+        stream.complete();
+        txn.commit();
+    } catch (const std::exception& e) {
+        Log::error() << "❌ Error staging document aliases: " << e.what();
+        throw;
+    }
+}
+
+void Database::finishBulkLoad() {
+    try {
+        Log::info() << "📦 Merging staged pages into the index...";
+        pqxx::work txn(*conn_);
+        txn.exec("SET LOCAL maintenance_work_mem = '512MB'");
+        txn.exec("SET LOCAL work_mem = '256MB'");
+        txn.exec("ANALYZE bulk_documents");
+        txn.exec("ANALYZE bulk_postings");
+
+        // Rebuilt once after the merge instead of updated row by row
+        txn.exec("DROP INDEX IF EXISTS idx_word_freq_word_id");
+
+        // The last copy of a URL crawled twice wins
+        txn.exec(
+            "CREATE TEMP TABLE merge_documents ON COMMIT DROP AS "
+            "SELECT DISTINCT ON (url) id, url, title, simhash FROM bulk_documents ORDER BY url, id DESC"
+        );
+        pqxx::result r = txn.exec(
+            "INSERT INTO documents (id, url, title, simhash) "
+            "SELECT id, url, title, simhash FROM merge_documents ORDER BY id "
+            "ON CONFLICT (url) DO UPDATE SET title = EXCLUDED.title, simhash = EXCLUDED.simhash"
+        );
+        size_t documents = r.affected_rows();
+
+        // Staged id -> live id; they differ only for URLs indexed before this run
+        txn.exec(
+            "CREATE TEMP TABLE merge_ids ON COMMIT DROP AS "
+            "SELECT s.id AS staged_id, d.id AS document_id "
+            "FROM bulk_documents s JOIN documents d ON d.url = s.url"
+        );
+
+        txn.exec(
+            "INSERT INTO words (word) SELECT DISTINCT word FROM bulk_postings ORDER BY word "
+            "ON CONFLICT (word) DO NOTHING"
         );
-        return !r.empty();
+        if (postingLayout_ == PostingLayout::Blocks) {
+            txn.exec(
+                "CREATE TEMP TABLE merge_postings ON COMMIT DROP AS "
+                "SELECT m.document_id, w.id AS word_id, b.frequency, b.positions "
+                "FROM bulk_postings b "
+                "JOIN merge_documents k ON k.id = b.document_id "
+                "JOIN merge_ids m ON m.staged_id = b.document_id "
+                "JOIN words w ON w.word = b.word"
+            );
+            txn.exec(
+                "INSERT INTO word_positions (document_id, word_id, positions) "
+                "SELECT document_id, word_id, positions FROM merge_postings ORDER BY document_id, word_id "
+                "ON CONFLICT (document_id, word_id) DO UPDATE SET positions = EXCLUDED.positions"
+            );
+            packMergedPostings(txn);
+        } else {
+            txn.exec(
+                "WITH p AS ("
+                "SELECT m.document_id, w.id AS word_id, b.frequency, b.positions "
+                "FROM bulk_postings b "
+                "JOIN merge_documents k ON k.id = b.document_id "
+                "JOIN merge_ids m ON m.staged_id = b.document_id "
+                "JOIN words w ON w.word = b.word"
+                "), wf AS ("
+                "INSERT INTO word_frequencies (document_id, word_id, frequency) "
+                "SELECT document_id, word_id, frequency FROM p ORDER BY document_id, word_id "
+                "ON CONFLICT (document_id, word_id) DO UPDATE SET frequency = EXCLUDED.frequency"
+                ") "
+                "INSERT INTO word_positions (document_id, word_id, positions) "
+                "SELECT document_id, word_id, positions FROM p ORDER BY document_id, word_id "
+                "ON CONFLICT (document_id, word_id) DO UPDATE SET positions = EXCLUDED.positions"
+            );
+        }
+        txn.exec(
+            "INSERT INTO document_texts (document_id, body) "
+            "SELECT m.document_id, t.body FROM bulk_texts t "
+            "JOIN merge_documents k ON k.id = t.document_id "
+            "JOIN merge_ids m ON m.staged_id = t.document_id "
+            "ON CONFLICT (document_id) DO UPDATE SET body = EXCLUDED.body"
+        );
+        txn.exec(
+            "INSERT INTO document_links (document_id, targets) "
+            "SELECT m.document_id, l.targets FROM bulk_links l "
+            "JOIN merge_documents k ON k.id = l.document_id "
+            "JOIN merge_ids m ON m.staged_id = l.document_id "
+            "ON CONFLICT (document_id) DO UPDATE SET targets = EXCLUDED.targets"
+        );
+
+        // A page re-crawled under its own URL is not an alias of itself.
+        // Canonical documents from earlier runs are staged with their live
+        // id, which no staged id maps to.
+        txn.exec(
+            "INSERT INTO document_aliases (url, document_id) "
+            "SELECT DISTINCT ON (a.url) a.url, a.document_id FROM ("
+            "SELECT s.url, COALESCE(m.document_id, s.document_id) AS document_id FROM bulk_aliases s "
+            "LEFT JOIN merge_ids m ON m.staged_id = s.document_id"
+            ") a "
+            "WHERE EXISTS (SELECT 1 FROM documents d WHERE d.id = a.document_id) "
+            "AND NOT EXISTS (SELECT 1 FROM documents d WHERE d.url = a.url) "
+            "ORDER BY a.url, a.document_id DESC "
+            "ON CONFLICT (url) DO UPDATE SET document_id = EXCLUDED.document_id"
+        );
+
+        txn.exec("CREATE INDEX idx_word_freq_word_id ON word_frequencies(word_id)");
+
+        txn.exec("DROP TABLE bulk_documents, bulk_postings, bulk_texts, bulk_links, bulk_aliases");
+        txn.exec("SELECT nextval('index_generation')");
+        txn.commit();
+
+        // Fresh statistics for the planner; ANALYZE needs no transaction of its own
+        pqxx::nontransaction analyze(*conn_);
+        analyze.exec("ANALYZE documents, words, word_frequencies, word_positions, posting_blocks, "
+            "document_texts, document_links, document_aliases");
+
+        Log::info() << "✅ Bulk load merged " << documents << " documents";
+    } catch (const std::exception& e) {
+        Log::error() << "❌ Error merging bulk load: " << e.what();
+        throw;
+    }
+}
+
+void Database::scanDocumentUrls(const std::function<void(int, std::string_view)>& visit) {
+    try {
+        pqxx::read_transaction txn(*conn_);
+        txn.for_stream("SELECT id, url FROM documents", [&](int id, std::string_view url) {
+            visit(id, url);
+        });
+    } catch (const std::exception& e) {
+        Log::error() << "❌ Error reading document urls: " << e.what();
+        throw;
+    }
+}
+
+void Database::scanLinks(const std::function<void(int, const std::basic_string<std::byte>&)>& visit) {
+    try {
+        pqxx::read_transaction txn(*conn_);
+        txn.for_stream("SELECT document_id, targets FROM document_links",
+            [&](int documentId, const std::basic_string<std::byte>& targets) {
+                visit(documentId, targets);
+            });
     } catch (const std::exception& e) {
-        std::cerr << "❌ Error checking document existence: " << e.what() << std::endl;
-        return false;
+        Log::error() << "❌ Error reading document links: " << e.what();
+        throw;
+    }
+}
+
+void Database::scanPageRanks(const std::function<void(std::string_view, float)>& visit) {
+    try {
+        pqxx::read_transaction txn(*conn_);
+        txn.for_stream("SELECT url, page_rank FROM documents WHERE page_rank IS NOT NULL",
+            [&](std::string_view url, float rank) {
+                visit(url, rank);
+            });
+    } catch (const std::exception& e) {
+        Log::error() << "❌ Error reading page ranks: " << e.what();
+        throw;
+    }
+}
+
+void Database::storePageRanks(const std::vector<std::pair<int, float>>& ranks) {
+    const size_t kChunk = 10000;
+
+    try {
+        pqxx::work txn(*conn_);
+        for (size_t start = 0; start < ranks.size(); start += kChunk) {
+            ArrayLiteral ids, values;
+            for (size_t i = start; i < std::min(ranks.size(), start + kChunk); ++i) {
+                ids.add(ranks[i].first);
+                values.add(std::to_string(ranks[i].second));
+            }
+            txn.exec_params(
+                "UPDATE documents d SET page_rank = r.rank "
+                "FROM unnest($1::integer[], $2::real[]) AS r(id, rank) WHERE d.id = r.id",
+                ids.str(), values.str()
+            );
+        }
+        txn.exec("SELECT nextval('index_generation')");
+        txn.commit();
+    } catch (const std::exception& e) {
+        Log::error() << "❌ Error storing page ranks: " << e.what();
+        throw;
     }
 }
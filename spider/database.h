@@ -1,19 +1,65 @@
 #pragma once
 #include <string>
 #include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <string_view>
+#include <utility>
+#include <unordered_map>
 #include <pqxx/pqxx>
+#include "posting_block.h"
+
+// Everything the index keeps about one crawled page
+struct IndexedPage {
+    std::string url;
+    std::string title;
+    uint64_t simhash = 0;
+    std::basic_string<std::byte> text;      // DocumentStore format, empty if not stored
+    std::basic_string<std::byte> links;     // LinkGraph::encodeTargets format, empty if none
+    std::unordered_map<std::string, std::vector<uint32_t>> wordPositions;
+};
 
 class Database {
 private:
     std::unique_ptr<pqxx::connection> conn_;
+    static inline PostingLayout postingLayout_ = PostingLayout::Rows;
 
 public:
     Database(const std::string& connection_string);
     ~Database();
 
+    // Where every Database writes term postings; set once at startup
+    static void setPostingLayout(PostingLayout layout) { postingLayout_ = layout; }
+
     void initializeDatabase();
-    int addDocument(const std::string& url, const std::string& title);
-    int addWord(const std::string& word);
-    void addWordFrequency(int document_id, int word_id, int frequency);
-    bool documentExists(const std::string& url);
+    // Makes new document ids of this database satisfy id % shardCount == shard
+    void assignShard(size_t shard, size_t shardCount);
+    std::vector<std::pair<int, uint64_t>> loadSimHashes();
+
+    // Ascending positions as LEB128 varints of the gaps between them
+    static std::basic_string<std::byte> encodePositions(const std::vector<uint32_t>& positions);
+
+    // Writes the pages with their texts, words and postings in a single
+    // transaction and bumps the index generation once. Returns the
+    // document id of every page, in order.
+    std::vector<int> indexBatch(const std::vector<IndexedPage>& pages);
+    void addAliases(const std::vector<std::pair<std::string, int>>& aliases);
+
+    // Bulk load: pages are COPYed into unlogged staging tables without
+    // indexes, with document ids taken from the sequence up front, and
+    // moved into the index in one pass by finishBulkLoad. Staged rows left
+    // by an interrupted run are kept and merged by the next one.
+    void beginBulkLoad();
+    std::vector<int> stageBatch(const std::vector<IndexedPage>& pages);
+    void stageAliases(const std::vector<std::pair<std::string, int>>& aliases);
+    void finishBulkLoad();
+
+    // Link graph and PageRank, streamed rather than loaded as one result
+    void scanDocumentUrls(const std::function<void(int, std::string_view)>& visit);
+    void scanLinks(const std::function<void(int, const std::basic_string<std::byte>&)>& visit);
+    void scanPageRanks(const std::function<void(std::string_view, float)>& visit);
+    // Replaces documents.page_rank and bumps the index generation
+    void storePageRanks(const std::vector<std::pair<int, float>>& ranks);
 };
@@ -0,0 +1,125 @@
+#include "dns_cache.h"
+#include "async_logger.h"
+#include "spider_metrics.h"
+#include <boost/asio/post.hpp>
+#include <boost/system/system_error.hpp>
+#include <algorithm>
+
+namespace net = boost::asio;
+using tcp = boost::asio::ip::tcp;
+
+DnsCache& DnsCache::getInstance() {
+    static DnsCache instance;
+    return instance;
+}
+
+DnsCache::~DnsCache() {
+    if (pool_) {
+        pool_->stop();
+        pool_->join();
+    }
+}
+
+void DnsCache::configure(Options options) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    options.threads = std::max(1, options.threads);
+    options.capacity = std::max<size_t>(1, options.capacity);
+    options_ = options;
+}
+
+std::shared_future<DnsCache::Results> DnsCache::resolveAsync(const std::string& host, const std::string& port) {
+    SpiderMetrics& m = SpiderMetrics::get();
+    std::string key = host + ":" + port;
+    auto now = Clock::now();
+
+    std::shared_ptr<std::promise<Results>> promise;
+    std::shared_future<Results> answer;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = entries_.find(key);
+        if (it != entries_.end() && now < it->second.expiresAt) {
+            if (it->second.expiresAt == Clock::time_point::max()) {
+                m.dnsCoalesced.add();
+            } else {
+                m.dnsHits.add();
+            }
+            return it->second.answer;
+        }
+
+        if (it == entries_.end() && entries_.size() >= options_.capacity) {
+            evictExpired(now);
+        }
+
+        promise = std::make_shared<std::promise<Results>>();
+        answer = promise->get_future().share();
+        entries_[key] = Entry{answer, Clock::time_point::max()};
+
+        if (!pool_) {
+            pool_ = std::make_unique<net::thread_pool>(static_cast<size_t>(options_.threads));
+        }
+    }
+
+    m.dnsMisses.add();
+    net::post(*pool_, [this, key, host, port, promise] {
+        lookup(key, host, port, promise);
+    });
+    return answer;
+}
+
+// getaddrinfo runs on a pool thread; asio's own async_resolve would
+// serialize all hosts through a single internal thread
+void DnsCache::lookup(const std::string& key, const std::string& host, const std::string& port,
+    std::shared_ptr<std::promise<Results>> promise)
+{
+    SpiderMetrics& m = SpiderMetrics::get();
+    metrics::ScopedTimer timer(m.dnsSeconds);
+
+    boost::system::error_code ec;
+    tcp::resolver resolver(pool_->get_executor());
+    Results results = resolver.resolve(host, port, ec);
+    timer.stop();
+
+    auto now = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = entries_.find(key);
+        if (it != entries_.end()) {
+            it->second.expiresAt = now + (ec ? options_.negativeTtl : options_.ttl);
+        }
+    }
+
+    if (ec) {
+        m.dnsFailures.add();
+        Log::info() << "❌ Cannot resolve " << host << ": " << ec.message();
+        promise->set_exception(std::make_exception_ptr(boost::system::system_error(ec)));
+    } else {
+        promise->set_value(std::move(results));
+    }
+}
+
+// Drops expired answers; if the cache is still full, the answer closest
+// to expiry goes too. Lookups in flight are never evicted.
+void DnsCache::evictExpired(Clock::time_point now) {
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it->second.expiresAt <= now) {
+            it = entries_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (entries_.size() < options_.capacity) {
+        return;
+    }
+
+    auto oldest = entries_.end();
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        if (it->second.expiresAt != Clock::time_point::max()
+            && (oldest == entries_.end() || it->second.expiresAt < oldest->second.expiresAt)) {
+            oldest = it;
+        }
+    }
+    if (oldest != entries_.end()) {
+        entries_.erase(oldest);
+    }
+}
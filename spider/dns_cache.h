@@ -0,0 +1,63 @@
+#pragma once
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Process-wide host name cache shared by all fetchers.
+//
+// Lookups run on a small resolver pool. Concurrent requests for the same
+// host wait on one lookup, answers are kept for ttl and failures for
+// negativeTtl. getaddrinfo does not report record TTLs, so both are fixed.
+class DnsCache {
+public:
+    using Results = boost::asio::ip::tcp::resolver::results_type;
+
+    struct Options {
+        std::chrono::seconds ttl{300};
+        std::chrono::seconds negativeTtl{30};
+        size_t capacity = 4096;
+        int threads = 4;
+    };
+
+    static DnsCache& getInstance();
+
+    // Must be called before the first lookup
+    void configure(Options options);
+
+    // Cached or in-flight answer; get() throws if the lookup failed
+    std::shared_future<Results> resolveAsync(const std::string& host, const std::string& port);
+
+    Results resolve(const std::string& host, const std::string& port) {
+        return resolveAsync(host, port).get();
+    }
+
+    // Starts a lookup in the background so a later resolve() finds it warm
+    void prefetch(const std::string& host, const std::string& port) {
+        resolveAsync(host, port);
+    }
+
+    ~DnsCache();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::shared_future<Results> answer;
+        Clock::time_point expiresAt = Clock::time_point::max();  // max while in flight
+    };
+
+    DnsCache() = default;
+    void lookup(const std::string& key, const std::string& host, const std::string& port,
+        std::shared_ptr<std::promise<Results>> promise);
+    void evictExpired(Clock::time_point now);
+
+    std::mutex mtx_;
+    std::unordered_map<std::string, Entry> entries_;
+    std::unique_ptr<boost::asio::thread_pool> pool_;
+    Options options_;
+};
@@ -0,0 +1,157 @@
+#include "frontier.h"
+#include "link_graph.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+uint32_t HostTable::intern(ProtocolType protocol, std::string_view name) {
+    size_t hash = NameHash{}(name);
+    uint32_t stripeIndex = static_cast<uint32_t>(hash % kStripes);
+    Stripe& stripe = stripes_[stripeIndex];
+    size_t slot = protocol == ProtocolType::HTTPS ? 1 : 0;
+
+    {
+        std::shared_lock<std::shared_mutex> lock(stripe.mtx);
+        auto it = stripe.ids.find(name);
+        if (it != stripe.ids.end() && it->second[slot] != kNone) {
+            return it->second[slot];
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(stripe.mtx);
+    auto it = stripe.ids.find(name);
+    if (it == stripe.ids.end()) {
+        it = stripe.ids.emplace(std::string(name), std::array<uint32_t, 2>{kNone, kNone}).first;
+    }
+    if (it->second[slot] == kNone) {
+        uint64_t prefix = LinkGraph::extendHash(LinkGraph::kHashSeed,
+            protocol == ProtocolType::HTTPS ? "https://" : "http://");
+        stripe.hosts.push_back({it->first, protocol, LinkGraph::extendHash(prefix, name)});
+        it->second[slot] = static_cast<uint32_t>((stripe.hosts.size() - 1) * kStripes + stripeIndex);
+    }
+    return it->second[slot];
+}
+
+const HostTable::Host& HostTable::get(uint32_t id) const {
+    const Stripe& stripe = stripes_[id % kStripes];
+    std::shared_lock<std::shared_mutex> lock(stripe.mtx);
+    return stripe.hosts[id / kStripes];
+}
+
+size_t HostTable::size() const {
+    size_t total = 0;
+    for (const auto& stripe : stripes_) {
+        std::shared_lock<std::shared_mutex> lock(stripe.mtx);
+        total += stripe.hosts.size();
+    }
+    return total;
+}
+
+uint32_t PathArena::add(std::string_view path) {
+    // Varint length, then the bytes
+    char header[5];
+    size_t headerSize = 0;
+    for (size_t n = path.size(); ; n >>= 7) {
+        header[headerSize++] = static_cast<char>((n & 0x7f) | (n >= 0x80 ? 0x80 : 0));
+        if (n < 0x80) break;
+    }
+    size_t recordSize = headerSize + path.size();
+
+    if (used_ + recordSize > kBlockSize) {
+        if (blocks_.size() == kMaxBlocks) {
+            return kNone;
+        }
+        // A path longer than a block gets a block of its own size
+        blocks_.push_back(std::make_unique<char[]>(std::max(kBlockSize, recordSize)));
+        used_ = 0;
+    }
+
+    char* out = blocks_.back().get() + used_;
+    std::memcpy(out, header, headerSize);
+    std::memcpy(out + headerSize, path.data(), path.size());
+
+    uint32_t ref = static_cast<uint32_t>(((blocks_.size() - 1) << kOffsetBits) | used_);
+    used_ += recordSize;
+    return ref;
+}
+
+std::string_view PathArena::get(uint32_t ref) const {
+    const char* in = blocks_[ref >> kOffsetBits].get() + (ref & (kBlockSize - 1));
+    size_t size = 0;
+    for (int shift = 0; ; shift += 7) {
+        unsigned char byte = static_cast<unsigned char>(*in++);
+        size |= static_cast<size_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) break;
+    }
+    return {in, size};
+}
+
+bool UrlHashSet::insert(uint64_t hash) {
+    if (hash == 0) hash = 1;
+    if ((size_ + 1) * 10 > slots_.size() * 7) {
+        grow();
+    }
+
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        if (slots_[i] == hash) {
+            return false;
+        }
+        if (slots_[i] == 0) {
+            slots_[i] = hash;
+            ++size_;
+            return true;
+        }
+    }
+}
+
+bool UrlHashSet::contains(uint64_t hash) const {
+    if (hash == 0) hash = 1;
+    if (slots_.empty()) {
+        return false;
+    }
+
+    size_t mask = slots_.size() - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        if (slots_[i] == hash) return true;
+        if (slots_[i] == 0) return false;
+    }
+}
+
+void UrlHashSet::grow() {
+    std::vector<uint64_t> old;
+    old.swap(slots_);
+    slots_.assign(old.empty() ? 1024 : old.size() * 2, 0);
+
+    size_t mask = slots_.size() - 1;
+    for (uint64_t hash : old) {
+        if (hash == 0) continue;
+        size_t i = hash & mask;
+        while (slots_[i] != 0) i = (i + 1) & mask;
+        slots_[i] = hash;
+    }
+}
+
+PackedUrl UrlStore::pack(const Link& link) {
+    uint32_t host = hosts_.intern(link.protocol, link.hostName);
+    uint64_t hash = LinkGraph::finishHash(LinkGraph::extendHash(hosts_.get(host).hashPrefix, link.query));
+    return {hash, host, PathArena::kNone};
+}
+
+bool UrlStore::add(PackedUrl& url, std::string_view path) {
+    if (seen_.contains(url.hash)) {
+        return false;
+    }
+    // A full arena stops the frontier from growing
+    url.path = paths_.add(path);
+    if (url.path == PathArena::kNone) {
+        return false;
+    }
+    seen_.insert(url.hash);
+    return true;
+}
+
+Link UrlStore::unpack(const PackedUrl& url) const {
+    const HostTable::Host& host = hosts_.get(url.host);
+    return Link{host.protocol, host.name, std::string(paths_.get(url.path))};
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "link.h"
+
+// Compact URLs for the live crawl frontier. A queued URL is 16 bytes: its
+// scheme and host are an id in a shared intern table, its path lives in
+// an append-only arena, and its 64-bit fingerprint (LinkGraph::urlHash of
+// the full URL) is computed once from the host's stored hash prefix, so
+// no URL string is built until the page is fetched.
+struct PackedUrl {
+    uint64_t hash;      // LinkGraph::urlHash of the full URL
+    uint32_t host;      // HostTable id
+    uint32_t path;      // PathArena reference
+};
+static_assert(sizeof(PackedUrl) == 16);
+
+// Scheme + host name -> dense id, shared by all crawl threads. Lookups of
+// known hosts take a shared lock on one of the stripes and allocate nothing.
+class HostTable {
+public:
+    struct Host {
+        std::string name;
+        ProtocolType protocol;
+        uint64_t hashPrefix;    // LinkGraph::extendHash over "scheme://name"
+    };
+
+    uint32_t intern(ProtocolType protocol, std::string_view name);
+    // The reference stays valid for the lifetime of the table
+    const Host& get(uint32_t id) const;
+
+    size_t size() const;
+
+private:
+    static constexpr size_t kStripes = 16;
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    struct NameHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+    };
+
+    struct Stripe {
+        mutable std::shared_mutex mtx;
+        // Per name, the id for each protocol
+        std::unordered_map<std::string, std::array<uint32_t, 2>, NameHash, std::equal_to<>> ids;
+        std::deque<Host> hosts;     // by id / kStripes
+    };
+
+    std::array<Stripe, kStripes> stripes_;
+};
+
+// Append-only storage for URL paths, in blocks of 1 MiB. A reference packs
+// the block number and the offset of a length-prefixed record into 32 bits,
+// which caps the arena at 4096 blocks. Not thread-safe.
+class PathArena {
+public:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    // kNone once the arena is full
+    uint32_t add(std::string_view path);
+    std::string_view get(uint32_t ref) const;
+
+    size_t bytes() const { return blocks_.size() * kBlockSize; }
+
+private:
+    static constexpr int kOffsetBits = 20;
+    static constexpr size_t kBlockSize = size_t{1} << kOffsetBits;
+    static constexpr size_t kMaxBlocks = size_t{1} << (32 - kOffsetBits);
+
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    size_t used_ = kBlockSize;  // in the last block
+};
+
+// Set of URL fingerprints with open addressing, 8 bytes per slot at no
+// more than 70% load. Not thread-safe.
+class UrlHashSet {
+public:
+    // False if the hash was already there
+    bool insert(uint64_t hash);
+    bool contains(uint64_t hash) const;
+    size_t size() const { return size_; }
+
+private:
+    void grow();
+
+    std::vector<uint64_t> slots_;   // 0 marks an empty slot
+    size_t size_ = 0;
+};
+
+// Host table, path arena and the set of URLs ever queued: everything a
+// frontier needs to pack, deduplicate and unpack links
+class UrlStore {
+public:
+    // Fingerprint and host of a link; safe to call from any thread
+    PackedUrl pack(const Link& link);
+    // First sighting only: stores the path and returns true. Callers
+    // serialize the calls.
+    bool add(PackedUrl& url, std::string_view path);
+
+    Link unpack(const PackedUrl& url) const;
+    size_t size() const { return seen_.size(); }
+
+private:
+    HostTable hosts_;
+    PathArena paths_;
+    UrlHashSet seen_;
+};
@@ -1,7 +1,7 @@
 #include "html_parser.h"
+#include "tokenizer.h"
 #include <regex>
 #include <algorithm>
-#include <cctype>
 
 std::string HtmlParser::extractText(const std::string& html) {
     std::string text = html;
@@ -45,30 +45,14 @@ std::vector<Link> HtmlParser::extractLinks(const Link& baseLink, const std::stri
     return links;
 }
 
-std::unordered_map<std::string, int> HtmlParser::countWords(const std::string& text) {
-    std::unordered_map<std::string, int> wordCount;
-
-    std::string word;
-    for (unsigned char c : text) {
-        if (std::isalnum(c)) {
-            word += static_cast<char>(std::tolower(c));
-        } else if (!word.empty()) {
-            word = cleanText(word);
-            if (isValidWord(word)) {
-                wordCount[word]++;
-            }
-            word.clear();
-        }
-    }
+std::unordered_map<std::string, std::vector<uint32_t>> HtmlParser::wordPositions(const std::string& text) {
+    std::unordered_map<std::string, std::vector<uint32_t>> positions;
 
-    if (!word.empty()) {
-        word = cleanText(word);
-        if (isValidWord(word)) {
-            wordCount[word]++;
-        }
-    }
+    Tokenizer::getInstance().tokenize(text, [&](std::string_view word, uint32_t position) {
+        positions[std::string(word)].push_back(position);
+    });
 
-    return wordCount;
+    return positions;
 }
 
 std::string HtmlParser::extractTitle(const std::string& html) {
@@ -86,20 +70,6 @@ std::string HtmlParser::extractTitle(const std::string& html) {
     return "Untitled";
 }
 
-std::string HtmlParser::cleanText(const std::string& text) {
-    std::string cleaned;
-    for (unsigned char c : text) {
-        if (std::isalnum(c)) {
-            cleaned += static_cast<char>(std::tolower(c));
-        }
-    }
-    return cleaned;
-}
-
-bool HtmlParser::isValidWord(const std::string& word) {
-    return word.length() >= 3 && word.length() <= 32;
-}
-
 Link HtmlParser::resolveLink(const Link& baseLink, const std::string& href) {
     Link result;
 
@@ -2,17 +2,16 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <cstdint>
 #include "link.h"
 
 class HtmlParser {
 public:
     static std::string extractText(const std::string& html);
     static std::vector<Link> extractLinks(const Link& baseLink, const std::string& html);
-    static std::unordered_map<std::string, int> countWords(const std::string& text);
+    // Token positions of every indexable word (see Tokenizer)
+    static std::unordered_map<std::string, std::vector<uint32_t>> wordPositions(const std::string& text);
     static std::string extractTitle(const std::string& html);
-
-private:
-    static std::string cleanText(const std::string& text);
-    static bool isValidWord(const std::string& word);
+    // Absolute link for href found on baseLink, or an empty hostName if it is not crawlable
     static Link resolveLink(const Link& baseLink, const std::string& href);
 };
@@ -1,5 +1,7 @@
 #include "http_utils.h"
-#include <iostream>
+#include "async_logger.h"
+#include "charset.h"
+#include "dns_cache.h"
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
 #include <boost/beast/version.hpp>
@@ -11,8 +13,24 @@ namespace http = beast::http;
 namespace net = boost::asio;
 using tcp = boost::asio::ip::tcp;
 
+namespace {
+    std::string& userAgent() {
+        static std::string value = BOOST_BEAST_VERSION_STRING;
+        return value;
+    }
+}
+
+void setUserAgent(const std::string& value) {
+    if (!value.empty()) userAgent() = value;
+}
+
 std::string getHtmlContent(const Link& link) {
-    std::string result;
+    return httpGet(link, "text/html").body;
+}
+
+HttpResult httpGet(const Link& link, const char* accept) {
+    HttpResult response;
+    std::string& result = response.body;
 
     try {
         std::string host = link.hostName;
@@ -22,28 +40,63 @@ std::string getHtmlContent(const Link& link) {
         net::io_context ioc;
 
         if (link.protocol == ProtocolType::HTTPS) {
-            std::cout << "⚠️  HTTPS not supported in this version, skipping: " << host << target << std::endl;
-            return "";
+            Log::info() << "⚠️  HTTPS not supported in this version, skipping: " << host << target;
+            return response;
         }
 
-        tcp::resolver resolver(ioc);
         beast::tcp_stream stream(ioc);
 
-        auto const results = resolver.resolve(host, port);
+        auto const results = DnsCache::getInstance().resolve(host, port);
         stream.connect(results);
 
         http::request<http::string_body> req{http::verb::get, target, 11};
         req.set(http::field::host, host);
-        req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
-        req.set(http::field::accept, "text/html");
+        req.set(http::field::user_agent, userAgent());
+        req.set(http::field::accept, accept);
 
         http::write(stream, req);
 
         beast::flat_buffer buffer;
-        http::response<http::dynamic_body> res;
-        http::read(stream, buffer, res);
+        http::response_parser<http::buffer_body> parser;
+        http::read_header(stream, buffer, parser);
+        response.status = static_cast<int>(parser.get().result_int());
+
+        // Body is read in chunks and converted to UTF-8 on the way; UTF-8
+        // pages are appended as they are
+        auto contentType = parser.get()[http::field::content_type];
+        Utf8Transcoder transcoder(std::string_view(contentType.data(), contentType.size()));
+        bool sniffed = false;
+        char chunk[16384];
 
-        result = boost::beast::buffers_to_string(res.body().data());
+        while (!parser.is_done()) {
+            parser.get().body().data = chunk;
+            parser.get().body().size = sizeof(chunk);
+
+            beast::error_code readError;
+            http::read(stream, buffer, parser, readError);
+            if (readError && readError != http::error::need_buffer) {
+                throw beast::system_error{readError};
+            }
+
+            std::string_view bytes(chunk, sizeof(chunk) - parser.get().body().size);
+            if (sniffed) {
+                transcoder.append(result, bytes);
+                continue;
+            }
+
+            result.append(bytes);
+            if (result.size() >= Utf8Transcoder::kSniffBytes || parser.is_done()) {
+                sniffed = true;
+                size_t bom = transcoder.sniff(result);
+                if (transcoder.passthrough()) {
+                    result.erase(0, bom);
+                } else {
+                    std::string head = std::move(result);
+                    result.clear();
+                    transcoder.append(result, head);
+                }
+            }
+        }
 
         beast::error_code ec;
         stream.socket().shutdown(tcp::socket::shutdown_both, ec);
@@ -53,8 +106,10 @@ std::string getHtmlContent(const Link& link) {
         }
 
     } catch (const std::exception& e) {
-        std::cout << "❌ Error fetching " << link.hostName << link.query << ": " << e.what() << std::endl;
+        Log::info() << "❌ Error fetching " << link.hostName << link.query << ": " << e.what();
+        response.status = 0;
+        result.clear();
     }
 
-    return result;
+    return response;
 }
\ No newline at end of file
@@ -2,4 +2,14 @@
 #include <string>
 #include "link.h"
 
+struct HttpResult {
+    int status = 0;     // 0 when the request failed before a response
+    std::string body;   // converted to UTF-8
+};
+
+HttpResult httpGet(const Link& link, const char* accept);
+
 std::string getHtmlContent(const Link& link);
+
+// Sent as User-Agent with every request
+void setUserAgent(const std::string& userAgent);
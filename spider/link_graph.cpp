@@ -0,0 +1,265 @@
+#include "link_graph.h"
+#include "async_logger.h"
+#include "database.h"
+#include "shards.h"
+#include <algorithm>
+#include <barrier>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <thread>
+
+uint64_t LinkGraph::urlHash(std::string_view url) {
+    return finishHash(extendHash(kHashSeed, url));
+}
+
+uint64_t LinkGraph::urlHash(const Link& link) {
+    uint64_t state = extendHash(kHashSeed, link.protocol == ProtocolType::HTTPS ? "https://" : "http://");
+    state = extendHash(state, link.hostName);
+    return finishHash(extendHash(state, link.query));
+}
+
+uint64_t LinkGraph::extendHash(uint64_t state, std::string_view piece) {
+    // FNV-1a; fingerprints are stored, so this must not depend on std::hash
+    for (unsigned char c : piece) {
+        state ^= c;
+        state *= 1099511628211ULL;
+    }
+    return state;
+}
+
+uint64_t LinkGraph::finishHash(uint64_t state) {
+    // Avalanche, so the low bits are usable as a hash table index
+    state ^= state >> 33;
+    state *= 0xff51afd7ed558ccdULL;
+    state ^= state >> 33;
+    state *= 0xc4ceb9fe1a85ec53ULL;
+    state ^= state >> 33;
+    return state;
+}
+
+std::basic_string<std::byte> LinkGraph::encodeTargets(std::vector<uint64_t> targets) {
+    std::sort(targets.begin(), targets.end());
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+
+    std::basic_string<std::byte> out;
+    out.reserve(targets.size() * 8);
+    for (uint64_t target : targets) {
+        for (int shift = 0; shift < 64; shift += 8) {
+            out.push_back(static_cast<std::byte>(target >> shift));
+        }
+    }
+    return out;
+}
+
+std::vector<uint64_t> LinkGraph::decodeTargets(std::basic_string_view<std::byte> data) {
+    std::vector<uint64_t> targets(data.size() / 8);
+    for (size_t i = 0; i < targets.size(); ++i) {
+        uint64_t target = 0;
+        for (int b = 7; b >= 0; --b) {
+            target = (target << 8) | std::to_integer<uint64_t>(data[i * 8 + b]);
+        }
+        targets[i] = target;
+    }
+    return targets;
+}
+
+PageRank::PageRank(size_t nodeCount, std::vector<std::pair<uint32_t, uint32_t>> edges)
+    : offsets_(nodeCount + 1, 0)
+    , outDegree_(nodeCount, 0)
+{
+    std::sort(edges.begin(), edges.end(), [](const auto& a, const auto& b) {
+        return a.second != b.second ? a.second < b.second : a.first < b.first;
+    });
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    edges.erase(std::remove_if(edges.begin(), edges.end(), [](const auto& e) { return e.first == e.second; }),
+        edges.end());
+
+    // Sorted by target, so the sources of every node are already contiguous
+    sources_.reserve(edges.size());
+    for (const auto& [source, target] : edges) {
+        sources_.push_back(source);
+        ++offsets_[target + 1];
+        ++outDegree_[source];
+    }
+    for (size_t v = 0; v < nodeCount; ++v) {
+        offsets_[v + 1] += offsets_[v];
+    }
+}
+
+std::vector<float> PageRank::compute(const PageRankOptions& options) const {
+    const size_t n = nodeCount();
+    if (n == 0) {
+        return {};
+    }
+
+    size_t threadCount = options.threads > 0
+        ? static_cast<size_t>(options.threads)
+        : std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min(threadCount, n);
+
+    // Node ranges with about the same number of nodes plus in-links each,
+    // so a few heavily linked pages do not land on one thread
+    std::vector<size_t> byNodes{0}, byWork{0};
+    uint64_t totalWork = n + sources_.size();
+    for (size_t t = 1; t < threadCount; ++t) {
+        byNodes.push_back(n * t / threadCount);
+        uint64_t goal = totalWork * t / threadCount;
+        size_t v = byWork.back();
+        while (v < n && v + offsets_[v] < goal) ++v;
+        byWork.push_back(v);
+    }
+    byNodes.push_back(n);
+    byWork.push_back(n);
+
+    const double d = options.damping;
+    std::vector<double> rank(n, 1.0 / static_cast<double>(n));
+    std::vector<double> next(n, 0.0);
+    std::vector<double> contribution(n, 0.0);
+
+    std::vector<double> partial(threadCount, 0.0);
+    auto sumPartial = [&] {
+        double sum = 0;
+        for (double value : partial) {
+            sum += value;
+        }
+        return sum;
+    };
+
+    int iteration = 0;
+    double change = 0;
+    double base = 0;
+    bool done = options.maxIterations <= 0;
+
+    // The workers live for the whole computation. Every iteration has two
+    // phases, each ended by a barrier whose completion runs on one thread.
+    std::barrier contributed(static_cast<std::ptrdiff_t>(threadCount), [&]() noexcept {
+        // Pages without outgoing links spread their rank over every page
+        base = (1.0 - d) / static_cast<double>(n) + d * sumPartial() / static_cast<double>(n);
+    });
+    std::barrier pulled(static_cast<std::ptrdiff_t>(threadCount), [&]() noexcept {
+        change = sumPartial();
+        rank.swap(next);
+        ++iteration;
+        done = change < options.tolerance || iteration >= options.maxIterations;
+    });
+
+    auto work = [&](size_t t) {
+        while (!done) {
+            double lost = 0;
+            for (size_t u = byNodes[t]; u < byNodes[t + 1]; ++u) {
+                if (outDegree_[u] == 0) {
+                    contribution[u] = 0;
+                    lost += rank[u];
+                } else {
+                    contribution[u] = rank[u] / outDegree_[u];
+                }
+            }
+            partial[t] = lost;
+            contributed.arrive_and_wait();
+
+            double delta = 0;
+            for (size_t v = byWork[t]; v < byWork[t + 1]; ++v) {
+                double sum = 0;
+                for (uint64_t i = offsets_[v]; i < offsets_[v + 1]; ++i) {
+                    sum += contribution[sources_[i]];
+                }
+                next[v] = base + d * sum;
+                delta += std::abs(next[v] - rank[v]);
+            }
+            partial[t] = delta;
+            pulled.arrive_and_wait();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < threadCount; ++t) {
+        threads.emplace_back(work, t);
+    }
+    work(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    Log::info() << "📈 PageRank converged to " << change << " after " << iteration << " iterations on "
+                << threadCount << " threads";
+
+    std::vector<float> scores(n);
+    for (size_t v = 0; v < n; ++v) {
+        scores[v] = static_cast<float>(rank[v] * static_cast<double>(n));
+    }
+    return scores;
+}
+
+void computePageRank(const std::vector<std::string>& shardConnections, const PageRankOptions& options) {
+    auto started = std::chrono::steady_clock::now();
+    std::vector<std::unique_ptr<Database>> databases;
+    for (const auto& connection : shardConnections) {
+        databases.push_back(std::make_unique<Database>(connection));
+    }
+
+    // Document ids are unique across shards, so one dense numbering covers them all
+    std::vector<int> documentIds;
+    std::unordered_map<uint64_t, uint32_t> nodeOfUrl;
+    for (auto& database : databases) {
+        database->scanDocumentUrls([&](int documentId, std::string_view url) {
+            nodeOfUrl.emplace(LinkGraph::urlHash(url), static_cast<uint32_t>(documentIds.size()));
+            documentIds.push_back(documentId);
+        });
+    }
+    std::unordered_map<int, uint32_t> nodeOfDocument;
+    nodeOfDocument.reserve(documentIds.size());
+    for (uint32_t node = 0; node < documentIds.size(); ++node) {
+        nodeOfDocument.emplace(documentIds[node], node);
+    }
+
+    // Links to pages that were never indexed are dropped
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    size_t unresolved = 0;
+    for (auto& database : databases) {
+        database->scanLinks([&](int documentId, const std::basic_string<std::byte>& targets) {
+            auto source = nodeOfDocument.find(documentId);
+            if (source == nodeOfDocument.end()) {
+                return;
+            }
+            for (uint64_t target : LinkGraph::decodeTargets(targets)) {
+                auto it = nodeOfUrl.find(target);
+                if (it == nodeOfUrl.end()) {
+                    ++unresolved;
+                } else {
+                    edges.emplace_back(source->second, it->second);
+                }
+            }
+        });
+    }
+    nodeOfUrl.clear();
+    nodeOfDocument.clear();
+
+    PageRank graph(documentIds.size(), std::move(edges));
+    Log::info() << "🕸️ Link graph: " << graph.nodeCount() << " documents, " << graph.edgeCount()
+                << " links, " << unresolved << " links to pages not indexed";
+
+    std::vector<float> scores = graph.compute(options);
+
+    std::vector<std::vector<std::pair<int, float>>> byShard(databases.size());
+    for (size_t node = 0; node < documentIds.size(); ++node) {
+        byShard[shards::shardOfDocument(documentIds[node], databases.size())].emplace_back(documentIds[node], scores[node]);
+    }
+    for (size_t shard = 0; shard < databases.size(); ++shard) {
+        databases[shard]->storePageRanks(byShard[shard]);
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+    Log::info() << "✅ PageRank stored for " << documentIds.size() << " documents in " << elapsed.count() << " s";
+}
+
+UrlRanks loadPageRanks(const std::vector<std::string>& shardConnections) {
+    UrlRanks ranks;
+    for (const auto& connection : shardConnections) {
+        Database database(connection);
+        database.scanPageRanks([&](std::string_view url, float rank) {
+            ranks.emplace(LinkGraph::urlHash(url), rank);
+        });
+    }
+    return ranks;
+}
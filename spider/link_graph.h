@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "link.h"
+
+// Outgoing links of a page are kept as 64-bit fingerprints of the target
+// URLs: most targets are not indexed yet when the page is written, so
+// they are resolved to document ids only when PageRank runs.
+class LinkGraph {
+public:
+    static uint64_t urlHash(std::string_view url);
+    // Same fingerprint as urlHash(linkToUrl(link)), without building the string
+    static uint64_t urlHash(const Link& link);
+
+    // urlHash in pieces: urlHash(a + b) == finishHash(extendHash(extendHash(kHashSeed, a), b)),
+    // so a fingerprint can continue from a stored host prefix
+    static constexpr uint64_t kHashSeed = 14695981039346656037ULL;
+    static uint64_t extendHash(uint64_t state, std::string_view piece);
+    static uint64_t finishHash(uint64_t state);
+
+    // Sorted, distinct fingerprints as 8 little-endian bytes each
+    static std::basic_string<std::byte> encodeTargets(std::vector<uint64_t> targets);
+    static std::vector<uint64_t> decodeTargets(std::basic_string_view<std::byte> data);
+};
+
+// Stored PageRank by URL fingerprint, for ordering the crawl frontier
+using UrlRanks = std::unordered_map<uint64_t, float>;
+
+struct PageRankOptions {
+    double damping = 0.85;
+    double tolerance = 1e-6;    // stop once the L1 change per iteration drops below this
+    int maxIterations = 100;
+    int threads = 0;            // 0: one per core
+};
+
+// PageRank over a graph in compressed sparse row form, indexed by target:
+// the sources linking to node v are sources_[offsets_[v] .. offsets_[v + 1]).
+// Each iteration pulls contributions into every node, so threads own
+// disjoint ranges of nodes and need no atomics.
+class PageRank {
+public:
+    // Edges as (source, target) node indices below nodeCount; duplicates and self-links are dropped
+    PageRank(size_t nodeCount, std::vector<std::pair<uint32_t, uint32_t>> edges);
+
+    // Scores scaled so that they average 1.0 over all nodes
+    std::vector<float> compute(const PageRankOptions& options) const;
+
+    size_t nodeCount() const { return outDegree_.size(); }
+    size_t edgeCount() const { return sources_.size(); }
+
+private:
+    std::vector<uint64_t> offsets_;
+    std::vector<uint32_t> sources_;
+    std::vector<uint32_t> outDegree_;
+};
+
+// The offline job: reads documents and links from every shard, runs
+// PageRank over the whole graph and writes documents.page_rank back
+void computePageRank(const std::vector<std::string>& shardConnections, const PageRankOptions& options);
+
+// Stored ranks of every shard, keyed by urlHash
+UrlRanks loadPageRanks(const std::vector<std::string>& shardConnections);
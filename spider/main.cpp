@@ -1,109 +1,92 @@
-#include <iostream>
-#include <vector>
 #include <thread>
-#include <mutex>
-#include <queue>
-#include <condition_variable>
-#include <atomic>
-#include <unordered_set>
-#include <regex>
 #include <chrono>
+#include <algorithm>
+#include <cstdlib>
 
+#include "page_source.h"
+#include "crawl_pipeline.h"
+#include "dns_cache.h"
 #include "http_utils.h"
-#include "html_parser.h"
+#include "robots.h"
+#include "link_graph.h"
+#include "shards.h"
 #include "database.h"
 #include "config.h"
+#include "tokenizer.h"
+#include "simhash.h"
+#include "metrics.h"
+#include "async_logger.h"
+#include "metrics_server.h"
+#include "spider_metrics.h"
+
+void printUsage() {
+    Log::error() << "Usage: SpiderApp [--config PATH] [--source live|warc|directory] [--source-path PATH] [--node-id N] [--bulk-load] [--pagerank]";
+}
 
-std::mutex mtx;
-std::condition_variable cv;
-std::queue<std::pair<Link, int>> tasks;
-std::unordered_set<std::string> visitedUrls;
-std::atomic<bool> exitThreadPool{false};
-std::unique_ptr<Database> database;
-
-void threadPoolWorker() {
-    std::unique_lock<std::mutex> lock(mtx);
-    while (!exitThreadPool || !tasks.empty()) {
-        if (tasks.empty()) {
-            cv.wait(lock, [] { return exitThreadPool || !tasks.empty(); });
-            if (exitThreadPool && tasks.empty())
-                break;
+int main(int argc, char* argv[]) {
+    std::string configPath = "../config.ini";
+    std::string sourceKind;
+    std::string sourcePath;
+    int nodeId = -1;
+    bool bulkLoad = false;
+    bool pageRank = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--bulk-load" || arg == "--pagerank") {
+            (arg == "--bulk-load" ? bulkLoad : pageRank) = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            printUsage();
+            return 1;
+        }
+        if (arg == "--config") {
+            configPath = argv[++i];
+        } else if (arg == "--source") {
+            sourceKind = argv[++i];
+        } else if (arg == "--source-path") {
+            sourcePath = argv[++i];
+        } else if (arg == "--node-id") {
+            nodeId = std::atoi(argv[++i]);
         } else {
-            auto task = tasks.front();
-            tasks.pop();
-            lock.unlock();
-
-            Link link = task.first;
-            int depth = task.second;
-
-            std::string url = (link.protocol == ProtocolType::HTTPS ? "https://" : "http://")
-                            + link.hostName + link.query;
-
-            {
-                std::lock_guard<std::mutex> visitedLock(mtx);
-                if (visitedUrls.count(url) > 0) {
-                    lock.lock();
-                    continue;
-                }
-                visitedUrls.insert(url);
-            }
-
-            try {
-                std::cout << "🌐 Fetching: " << url << std::endl;
-
-                std::string html = getHtmlContent(link);
-
-                if (html.empty()) {
-                    std::cout << "❌ Failed to get HTML content from: " << url << std::endl;
-                    lock.lock();
-                    continue;
-                }
-
-                std::string text = HtmlParser::extractText(html);
-                std::string title = HtmlParser::extractTitle(html);
-                auto wordCounts = HtmlParser::countWords(text);
-
-                int documentId = database->addDocument(url, title);
-
-                for (const auto& [word, count] : wordCounts) {
-                    int wordId = database->addWord(word);
-                    database->addWordFrequency(documentId, wordId, count);
-                }
-
-                std::cout << "✅ Indexed: " << url << " (unique words: " << wordCounts.size() << ")" << std::endl;
-
-                if (depth > 0) {
-                    auto links = HtmlParser::extractLinks(link, html);
-
-                    std::lock_guard<std::mutex> taskLock(mtx);
-                    for (const auto& newLink : links) {
-                        std::string newUrl = (newLink.protocol == ProtocolType::HTTPS ? "https://" : "http://")
-                                           + newLink.hostName + newLink.query;
-
-                        if (visitedUrls.count(newUrl) == 0) {
-                            tasks.push({newLink, depth - 1});
-                        }
-                    }
-                    cv.notify_all();
-                }
-            } catch (const std::exception& e) {
-                std::cout << "❌ Error processing " << url << ": " << e.what() << std::endl;
-            }
-
-            lock.lock();
+            printUsage();
+            return 1;
         }
     }
-}
 
-int main() {
     try {
         // Load configuration
         Config& config = Config::getInstance();
-        if (!config.load("../config.ini")) {
-            std::cerr << "❌ Failed to load config.ini" << std::endl;
+        if (!config.load(configPath)) {
+            Log::error() << "❌ Failed to load " << configPath;
             return 1;
         }
 
+        // Spider and server must tokenize identically
+        Tokenizer::Options tokenizerOptions;
+        tokenizerOptions.stemming = config.getInt("tokenizer", "stemming", 0) != 0;
+        Tokenizer::configure(tokenizerOptions);
+
+        // Spider and server must agree on the posting layout as well
+        Database::setPostingLayout(config.getString("index", "postings", "rows") == "blocks"
+            ? PostingLayout::Blocks : PostingLayout::Rows);
+
+        DnsCache::Options dnsOptions;
+        dnsOptions.ttl = std::chrono::seconds(config.getInt("spider", "dns_ttl", 300));
+        dnsOptions.negativeTtl = std::chrono::seconds(config.getInt("spider", "dns_negative_ttl", 30));
+        dnsOptions.capacity = static_cast<size_t>(std::max(1, config.getInt("spider", "dns_cache_size", 4096)));
+        dnsOptions.threads = config.getInt("spider", "dns_threads", 4);
+        DnsCache::getInstance().configure(dnsOptions);
+
+        RobotsCache::Options robotsOptions;
+        robotsOptions.enabled = config.getInt("spider", "respect_robots", 1) != 0;
+        robotsOptions.userAgent = config.getString("spider", "user_agent", robotsOptions.userAgent);
+        robotsOptions.ttl = std::chrono::seconds(config.getInt("spider", "robots_ttl", 86400));
+        robotsOptions.errorTtl = std::chrono::seconds(config.getInt("spider", "robots_error_ttl", 600));
+        robotsOptions.capacity = static_cast<size_t>(std::max(1, config.getInt("spider", "robots_cache_size", 10000)));
+        setUserAgent(robotsOptions.userAgent);
+        RobotsCache::getInstance().configure(robotsOptions);
+
         // Initialize database
         std::string dbConnection =
             "host=" + config.getString("database", "host") +
@@ -112,65 +95,165 @@ int main() {
             " user=" + config.getString("database", "username") +
             " password=" + config.getString("database", "password");
 
-        database = std::make_unique<Database>(dbConnection);
-        database->initializeDatabase();
+        // Each shard is a database of its own; without [shards] the index is [database]
+        std::vector<std::string> shardConnections =
+            shards::connectionStrings(dbConnection, config.getString("shards", "databases"));
+        if (shardConnections.empty()) {
+            shardConnections.push_back(dbConnection);
+        }
 
-        // Parse start URL
-        std::string startUrl = config.getString("spider", "start_url");
-        std::regex urlRegex("(https?)://([^/]+)(/.*)?");
-        std::smatch match;
+        // Fingerprints of documents from earlier crawls seed the LSH index
+        std::unique_ptr<NearDuplicateIndex> duplicates;
+        int duplicateDistance = config.getInt("spider", "duplicate_distance", 3);
+        if (duplicateDistance >= 0 && !pageRank) {
+            duplicates = std::make_unique<NearDuplicateIndex>(duplicateDistance);
+        }
+        for (size_t shard = 0; shard < shardConnections.size(); ++shard) {
+            Database database(shardConnections[shard]);
+            database.initializeDatabase();
+            if (shardConnections.size() > 1) {
+                database.assignShard(shard, shardConnections.size());
+            }
+            if (bulkLoad && !pageRank) {
+                database.beginBulkLoad();
+            }
 
-        if (!std::regex_match(startUrl, match, urlRegex)) {
-            std::cerr << "❌ Invalid start URL: " << startUrl << std::endl;
-            return 1;
+            if (duplicates) {
+                for (const auto& [documentId, fingerprint] : database.loadSimHashes()) {
+                    duplicates->insert(fingerprint, documentId);
+                }
+            }
+        }
+        if (duplicates) {
+            Log::info() << "🪞 Near-duplicate index: " << duplicates->size() << " documents";
         }
 
-        Link startLink;
-        startLink.protocol = (match[1] == "https") ? ProtocolType::HTTPS : ProtocolType::HTTP;
-        startLink.hostName = match[2];
-        startLink.query = match[3].matched ? match[3].str() : "/";
+        // Offline job over the link graph the crawls have stored, no crawling
+        if (pageRank) {
+            PageRankOptions rankOptions;
+            rankOptions.damping = std::stod(config.getString("pagerank", "damping", "0.85"));
+            rankOptions.tolerance = std::stod(config.getString("pagerank", "tolerance", "1e-6"));
+            rankOptions.maxIterations = config.getInt("pagerank", "max_iterations", 100);
+            rankOptions.threads = config.getInt("pagerank", "threads", 0);
+            computePageRank(shardConnections, rankOptions);
+            return 0;
+        }
 
+        // Pages come from the live web, a WARC/WET archive or a saved mirror
+        if (sourceKind.empty()) sourceKind = config.getString("spider", "source", "live");
+        if (sourcePath.empty()) sourcePath = config.getString("spider", "source_path");
         int maxDepth = config.getInt("spider", "max_depth", 1);
-        int threadCount = config.getInt("spider", "thread_count", 2);
-
-        std::cout << "🚀 Starting Spider with:" << std::endl;
-        std::cout << "   Start URL: " << startUrl << std::endl;
-        std::cout << "   Max depth: " << maxDepth << std::endl;
-        std::cout << "   Threads: " << threadCount << std::endl;
-        std::cout << std::endl;
 
-        // Start thread pool
-        std::vector<std::thread> threadPool;
-        for (int i = 0; i < threadCount; ++i) {
-            threadPool.emplace_back(threadPoolWorker);
+        // Cluster mode: every node runs with the same config and its own --node-id
+        ClusterOptions cluster;
+        cluster.nodes = parseClusterNodes(config.getString("cluster", "nodes"));
+        if (nodeId < 0) nodeId = config.getInt("cluster", "node_id", 0);
+        if (!cluster.nodes.empty() && static_cast<size_t>(nodeId) >= cluster.nodes.size()) {
+            Log::error() << "❌ Node id " << nodeId << " is not in the cluster of " << cluster.nodes.size() << " nodes";
+            return 1;
         }
-
-        // Add initial task
-        {
-            std::lock_guard<std::mutex> lock(mtx);
-            tasks.push({startLink, maxDepth});
-            cv.notify_all();
+        if (bulkLoad && cluster.nodes.size() > 1) {
+            // The first node to finish would merge and drop the others' staging tables
+            Log::error() << "❌ --bulk-load is not supported in cluster mode";
+            return 1;
+        }
+        cluster.self = static_cast<size_t>(nodeId);
+        cluster.virtualNodes = config.getInt("cluster", "virtual_nodes", 64);
+        cluster.batchSize = static_cast<size_t>(std::max(1, config.getInt("cluster", "forward_batch", 256)));
+        cluster.batchWait = std::chrono::milliseconds(config.getInt("cluster", "forward_ms", 100));
+        cluster.maxPending = static_cast<size_t>(std::max(1, config.getInt("cluster", "forward_max_pending", 100000)));
+        cluster.sendTimeout = std::chrono::milliseconds(std::max(1, config.getInt("cluster", "send_timeout_ms", 2000)));
+
+        // Importance-ordered frontier from the ranks of the last --pagerank run
+        std::shared_ptr<const UrlRanks> ranks;
+        if ((sourceKind.empty() || sourceKind == "live") && config.getString("spider", "frontier", "fifo") == "rank") {
+            ranks = std::make_shared<const UrlRanks>(loadPageRanks(shardConnections));
+            Log::info() << "📈 Frontier ordered by PageRank, " << ranks->size() << " ranked URLs";
         }
 
-        // Simple variant: let spider work for fixed time
-        std::this_thread::sleep_for(std::chrono::seconds(30));
+        std::unique_ptr<PageSource> source = makePageSource(
+            sourceKind, sourcePath, config.getString("spider", "start_url"), maxDepth, &cluster, ranks);
+
+        // Stage sizes: fetchers wait on the network, parsers on the CPU, writers on the database
+        PipelineOptions pipelineOptions;
+        pipelineOptions.shards = shardConnections;
+        pipelineOptions.fetchThreads = config.getInt("spider", "fetch_threads", config.getInt("spider", "thread_count", 8));
+        pipelineOptions.parseThreads = config.getInt("spider", "parse_threads", 0);
+        pipelineOptions.indexThreads = config.getInt("spider", "index_threads", 2);
+        pipelineOptions.queueCapacity = static_cast<size_t>(std::max(1, config.getInt("spider", "queue_capacity", 256)));
+        pipelineOptions.batchSize = static_cast<size_t>(std::max(1, config.getInt("spider", "index_batch_size", 32)));
+        pipelineOptions.batchWait = std::chrono::milliseconds(config.getInt("spider", "index_batch_ms", 200));
+        pipelineOptions.storeTextBytes = static_cast<size_t>(std::max(0, config.getInt("spider", "store_text_bytes", 262144)));
+        pipelineOptions.bulkLoad = bulkLoad;
+
+        CrawlPipeline pipeline(*source, duplicates.get(), pipelineOptions);
+        const PipelineOptions& stages = pipeline.options();
+
+        Log::info() << "🚀 Starting Spider with:";
+        Log::info() << "   Source: " << source->describe();
+        if (source->followsLinks()) {
+            Log::info() << "   Max depth: " << maxDepth;
+        }
+        if (stages.shards.size() > 1) {
+            Log::info() << "   Shards: " << stages.shards.size();
+        }
+        if (stages.bulkLoad) {
+            Log::info() << "   Bulk load: staging tables, indexes built at the end";
+        }
+        Log::info() << "   Threads: " << stages.fetchThreads << " fetch, " << stages.parseThreads << " parse, "
+                    << stages.indexThreads << " index (batches of " << stages.batchSize << ")";
+        Log::info();
+
+        std::unique_ptr<MetricsServer> metricsServer;
+        int metricsPort = config.getInt("spider", "metrics_port", 9100);
+        if (metricsPort > 0) {
+            metricsServer = std::make_unique<MetricsServer>(static_cast<unsigned short>(metricsPort));
+        }
 
-        // Shutdown
-        {
-            std::lock_guard<std::mutex> lock(mtx);
-            exitThreadPool = true;
-            cv.notify_all();
+        pipeline.start();
+
+        // The live crawl runs for a fixed time, offline sources until they are exhausted
+        SpiderMetrics& m = SpiderMetrics::get();
+        const auto reportInterval = std::chrono::seconds(5);
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+        auto nextReport = std::chrono::steady_clock::now() + reportInterval;
+        uint64_t lastIndexed = 0;
+        while (!pipeline.finished() && (!source->followsLinks() || std::chrono::steady_clock::now() < deadline)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if (std::chrono::steady_clock::now() < nextReport) {
+                continue;
+            }
+            nextReport += reportInterval;
+
+            uint64_t indexed = m.pagesIndexed.value();
+            Log::info() << "📊 " << static_cast<double>(indexed - lastIndexed) / reportInterval.count()
+                        << " pages/s, queue " << m.queueDepth.value()
+                        << ", visited " << m.visitedUrls.value()
+                        << ", fetched/parsed waiting " << m.fetchedQueue.value() << "/" << m.parsedQueue.value()
+                        << ", busy workers " << m.busyWorkers.value();
+            if (cluster.nodes.size() > 1) {
+                Log::info() << "🧭 Links sent " << m.clusterSent.value() << ", received " << m.clusterReceived.value()
+                            << ", dropped " << m.clusterDropped.value();
+            }
+            lastIndexed = indexed;
         }
 
-        for (auto& t : threadPool) {
-            t.join();
+        // Pages already fetched are still parsed and indexed
+        pipeline.stop();
+
+        // Staged pages become searchable only now, all at once
+        if (bulkLoad) {
+            for (const auto& connection : shardConnections) {
+                Database(connection).finishBulkLoad();
+            }
         }
 
-        std::cout << std::endl;
-        std::cout << "✅ Spider completed. Indexed " << visitedUrls.size() << " pages." << std::endl;
+        Log::info();
+        Log::info() << "✅ Spider completed. Indexed " << m.pagesIndexed.value() << " pages, "
+                    << m.pagesDuplicate.value() << " near-duplicates.";
 
     } catch (const std::exception& e) {
-        std::cerr << "💥 Error: " << e.what() << std::endl;
+        Log::error() << "💥 Error: " << e.what();
         return 1;
     }
 
@@ -0,0 +1,69 @@
+#include "metrics_server.h"
+#include "metrics.h"
+#include "async_logger.h"
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/version.hpp>
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+using tcp = boost::asio::ip::tcp;
+
+MetricsServer::MetricsServer(unsigned short port)
+    : acceptor_(ioc_, {net::ip::make_address("0.0.0.0"), port})
+{
+    accept();
+    thread_ = std::thread([this] { ioc_.run(); });
+    Log::info() << "📈 Metrics at http://0.0.0.0:" << port << "/metrics";
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+void MetricsServer::stop() {
+    ioc_.stop();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void MetricsServer::accept() {
+    acceptor_.async_accept([this](beast::error_code ec, tcp::socket socket) {
+        if (!ec) {
+            serve(socket);
+        }
+        accept();
+    });
+}
+
+void MetricsServer::serve(tcp::socket& socket) {
+    // Scrapes are rare and tiny, so each one is handled synchronously
+    beast::error_code ec;
+    beast::flat_buffer buffer;
+    http::request<http::string_body> request;
+    http::read(socket, buffer, request, ec);
+    if (ec) {
+        return;
+    }
+
+    http::response<http::string_body> response;
+    response.version(request.version());
+    response.keep_alive(false);
+    response.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+
+    if (request.method() == http::verb::get && request.target() == "/metrics") {
+        response.result(http::status::ok);
+        response.set(http::field::content_type, "text/plain; version=0.0.4");
+        metrics::Registry::getInstance().renderPrometheus(response.body());
+    } else {
+        response.result(http::status::not_found);
+        response.set(http::field::content_type, "text/plain");
+        response.body() = "Not found\n";
+    }
+    response.prepare_payload();
+
+    http::write(socket, response, ec);
+    socket.shutdown(tcp::socket::shutdown_send, ec);
+}
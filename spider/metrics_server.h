@@ -0,0 +1,25 @@
+#pragma once
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <thread>
+
+// Minimal HTTP listener serving GET /metrics from metrics::Registry on
+// its own thread, so scrapes never touch the crawl workers
+class MetricsServer {
+public:
+    explicit MetricsServer(unsigned short port);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    void stop();
+
+private:
+    void accept();
+    void serve(boost::asio::ip::tcp::socket& socket);
+
+    boost::asio::io_context ioc_{1};
+    boost::asio::ip::tcp::acceptor acceptor_;
+    std::thread thread_;
+};
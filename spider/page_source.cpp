@@ -0,0 +1,284 @@
+#include "page_source.h"
+#include "async_logger.h"
+#include "charset.h"
+#include "dns_cache.h"
+#include "http_utils.h"
+#include "robots.h"
+#include "spider_metrics.h"
+#include "warc_source.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+
+bool parseLink(const std::string& url, Link& link) {
+    static const std::regex urlRegex("(https?)://([^/]+)(/.*)?");
+    std::smatch match;
+    if (!std::regex_match(url, match, urlRegex)) {
+        return false;
+    }
+
+    link.protocol = (match[1] == "https") ? ProtocolType::HTTPS : ProtocolType::HTTP;
+    link.hostName = match[2];
+    link.query = match[3].matched ? match[3].str() : "/";
+    return true;
+}
+
+std::string linkToUrl(const Link& link) {
+    return (link.protocol == ProtocolType::HTTPS ? "https://" : "http://") + link.hostName + link.query;
+}
+
+LiveSource::LiveSource(const Link& start, int maxDepth, const ClusterOptions* cluster,
+    std::shared_ptr<const UrlRanks> ranks)
+    : startUrl_(linkToUrl(start))
+    , ranks_(std::move(ranks))
+{
+    if (cluster && cluster->nodes.size() > 1) {
+        exchange_ = std::make_unique<LinkExchange>(*cluster,
+            [this](std::vector<std::pair<Link, int>>&& links) { addRemoteLinks(std::move(links)); });
+
+        // Every node starts from the same URL, only its owner fetches it
+        size_t owner = exchange_->owner(start);
+        if (owner != exchange_->self()) {
+            Log::info() << "🧭 " << startUrl_ << " belongs to node " << owner << ", waiting for links";
+            return;
+        }
+    }
+    std::lock_guard<std::mutex> lock(mtx_);
+    push(urls_.pack(start), start.query, maxDepth, 1.0);
+}
+
+bool LiveSource::push(PackedUrl url, std::string_view path, int depth, double estimate) {
+    if (!urls_.add(url, path)) {
+        return false;
+    }
+    tasks_.push({url, static_cast<float>(priorityOf(url.hash, estimate)), depth, pushed_++});
+    return true;
+}
+
+double LiveSource::priorityOf(uint64_t hash, double estimate) const {
+    if (!ranks_) {
+        return 0;
+    }
+    auto it = ranks_->find(hash);
+    return it == ranks_->end() ? estimate : it->second;
+}
+
+bool LiveSource::next(SourcePage& page) {
+    SpiderMetrics& m = SpiderMetrics::get();
+
+    while (true) {
+        Link link;
+        int depth;
+        double priority;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            cv_.wait(lock, [this] { return stopped_ || !tasks_.empty(); });
+            if (stopped_) {
+                return false;
+            }
+
+            // Every queued URL is distinct, so this is the only place a
+            // frontier entry turns back into strings
+            link = urls_.unpack(tasks_.top().url);
+            depth = tasks_.top().depth;
+            priority = tasks_.top().priority;
+            tasks_.pop();
+            m.queueDepth.set(static_cast<int64_t>(tasks_.size()));
+            m.visitedUrls.set(static_cast<int64_t>(++fetched_));
+        }
+        std::string url = linkToUrl(link);
+
+        if (!RobotsCache::getInstance().allowed(link)) {
+            m.robotsBlocked.add();
+            Log::info() << "🤖 Disallowed by robots.txt: " << url;
+            continue;
+        }
+
+        Log::info() << "🌐 Fetching: " << url;
+
+        metrics::ScopedTimer fetchTimer(m.fetchSeconds);
+        std::string html = getHtmlContent(link);
+        fetchTimer.stop();
+
+        if (html.empty()) {
+            m.fetchErrors.add();
+            Log::info() << "❌ Failed to get HTML content from: " << url;
+            continue;
+        }
+
+        page.url = std::move(url);
+        page.link = std::move(link);
+        page.depth = depth;
+        page.priority = priority;
+        page.content = std::move(html);
+        page.plainText = false;
+        return true;
+    }
+}
+
+void LiveSource::addLinks(const SourcePage& from, const std::vector<Link>& links) {
+    if (from.depth <= 0) {
+        return;
+    }
+
+    // Links of hosts whose robots.txt is not loaded yet are checked again
+    // by next(), which fetches it. Hosts are interned and URLs fingerprinted
+    // here, outside the frontier lock.
+    RobotsCache& robots = RobotsCache::getInstance();
+    std::vector<std::pair<const Link*, PackedUrl>> permitted;
+    permitted.reserve(links.size());
+    for (const auto& link : links) {
+        // The owning node applies its own robots.txt and visited checks
+        if (exchange_) {
+            size_t owner = exchange_->owner(link);
+            if (owner != exchange_->self()) {
+                exchange_->forward(owner, link, from.depth - 1);
+                continue;
+            }
+        }
+        if (robots.check(link) == RobotsCache::Status::Disallowed) {
+            SpiderMetrics::get().robotsBlocked.add();
+        } else {
+            permitted.emplace_back(&link, urls_.pack(link));
+        }
+    }
+
+    // A page passes a damped share of its own priority to each link
+    double share = from.priority * 0.85 / static_cast<double>(std::max<size_t>(1, links.size()));
+
+    std::vector<std::string> newHosts;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (auto& [link, url] : permitted) {
+            if (push(url, link->query, from.depth - 1, share)
+                && link->protocol == ProtocolType::HTTP && link->hostName != from.link.hostName) {
+                newHosts.push_back(link->hostName);
+            }
+        }
+        SpiderMetrics::get().queueDepth.set(static_cast<int64_t>(tasks_.size()));
+        cv_.notify_all();
+    }
+
+    // Other hosts are resolved while the queue ahead of them is fetched
+    std::sort(newHosts.begin(), newHosts.end());
+    newHosts.erase(std::unique(newHosts.begin(), newHosts.end()), newHosts.end());
+    for (const auto& host : newHosts) {
+        DnsCache::getInstance().prefetch(host, "80");
+    }
+}
+
+void LiveSource::addRemoteLinks(std::vector<std::pair<Link, int>>&& links) {
+    std::vector<PackedUrl> packed;
+    packed.reserve(links.size());
+    for (const auto& [link, depth] : links) {
+        packed.push_back(urls_.pack(link));
+    }
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (size_t i = 0; i < links.size(); ++i) {
+        // Forwarded links carry no priority; unknown ones count as an average page
+        push(packed[i], links[i].first.query, links[i].second, 1.0);
+    }
+    SpiderMetrics::get().queueDepth.set(static_cast<int64_t>(tasks_.size()));
+    cv_.notify_all();
+}
+
+void LiveSource::stop() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stopped_ = true;
+    cv_.notify_all();
+}
+
+std::string LiveSource::describe() const {
+    if (exchange_) {
+        return "live crawl from " + startUrl_ + ", cluster node " + std::to_string(exchange_->self());
+    }
+    return "live crawl from " + startUrl_;
+}
+
+DirectorySource::DirectorySource(const std::string& root)
+    : root_(root)
+{
+    namespace fs = std::filesystem;
+    if (!fs::is_directory(root)) {
+        throw std::runtime_error("Not a directory: " + root);
+    }
+
+    for (const auto& entry : fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied)) {
+        std::string extension = entry.path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (entry.is_regular_file() && (extension == ".html" || extension == ".htm")) {
+            files_.push_back(entry.path().string());
+        }
+    }
+    std::sort(files_.begin(), files_.end());
+}
+
+bool DirectorySource::next(SourcePage& page) {
+    namespace fs = std::filesystem;
+
+    size_t index;
+    while (!stopped_ && (index = next_.fetch_add(1)) < files_.size()) {
+        const std::string& file = files_[index];
+
+        std::ifstream in(file, std::ios::binary);
+        if (!in) {
+            Log::error() << "❌ Cannot read " << file;
+            continue;
+        }
+        std::ostringstream content;
+        content << in.rdbuf();
+
+        page.content = content.str();
+        page.plainText = false;
+        page.depth = 0;
+        transcodeToUtf8(page.content, "");
+
+        // host/dir/index.html -> http://host/dir/
+        fs::path relative = fs::path(file).lexically_relative(root_);
+        std::string path = relative.generic_string();
+        std::string host = relative.begin()->string();
+        if (path.size() >= 10 && path.compare(path.size() - 10, 10, "index.html") == 0) {
+            path.erase(path.size() - 10);
+        }
+
+        page.link = Link{};
+        if (host.find('.') != std::string::npos && host != path && parseLink("http://" + path, page.link)) {
+            page.url = "http://" + path;
+        } else {
+            page.url = "file://" + fs::absolute(file).generic_string();
+        }
+        return true;
+    }
+    return false;
+}
+
+std::string DirectorySource::describe() const {
+    return "directory " + root_ + " (" + std::to_string(files_.size()) + " pages)";
+}
+
+std::unique_ptr<PageSource> makePageSource(const std::string& kind, const std::string& path,
+    const std::string& startUrl, int maxDepth, const ClusterOptions* cluster,
+    std::shared_ptr<const UrlRanks> ranks)
+{
+    if (kind.empty() || kind == "live") {
+        Link start;
+        if (!parseLink(startUrl, start)) {
+            throw std::invalid_argument("Invalid start URL: " + startUrl);
+        }
+        return std::make_unique<LiveSource>(start, maxDepth, cluster, std::move(ranks));
+    }
+    if (cluster && cluster->nodes.size() > 1) {
+        throw std::invalid_argument("Cluster mode only partitions the live crawl");
+    }
+    if (kind == "warc") {
+        return std::make_unique<WarcSource>(path);
+    }
+    if (kind == "directory") {
+        return std::make_unique<DirectorySource>(path);
+    }
+    throw std::invalid_argument("Unknown page source: " + kind);
+}
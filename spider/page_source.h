@@ -0,0 +1,123 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+#include "cluster.h"
+#include "frontier.h"
+#include "link.h"
+#include "link_graph.h"
+
+// A page handed to the indexing workers, already converted to UTF-8
+struct SourcePage {
+    std::string url;
+    Link link;
+    int depth = 0;              // links left to follow (live crawl only)
+    double priority = 0;        // frontier priority it was fetched with (live crawl only)
+    std::string content;
+    bool plainText = false;     // extracted text (WET) rather than HTML
+};
+
+// Where the spider gets its pages from: the live web, a web archive or a
+// local mirror. Everything after next() is the same indexing pipeline.
+class PageSource {
+public:
+    virtual ~PageSource() = default;
+
+    // Fills page with the next page to index; false once the source is
+    // exhausted or stopped. Called concurrently by all workers.
+    virtual bool next(SourcePage& page) = 0;
+
+    // Only the live crawler follows links found on indexed pages
+    virtual bool followsLinks() const { return false; }
+    virtual void addLinks(const SourcePage& from, const std::vector<Link>& links) {
+        (void)from;
+        (void)links;
+    }
+
+    // Wakes all workers blocked in next() and makes it return false
+    virtual void stop() = 0;
+
+    virtual std::string describe() const = 0;
+};
+
+// "scheme://host/path" into a Link; false for anything else
+bool parseLink(const std::string& url, Link& link);
+std::string linkToUrl(const Link& link);
+
+// Crawl from a start URL, fetching pages with getHtmlContent. Breadth-first
+// by default; given stored PageRanks, the frontier fetches the most
+// important URLs first: a known URL is ranked by its stored score, a new
+// one by the share its linking page passes on (score * 0.85 / links).
+// Queued URLs are packed (see frontier.h) and deduplicated when queued, so
+// a URL is fetched once, with the depth and priority of its first sighting.
+// In cluster mode the source only crawls hosts its node owns: other links
+// go to their owner, and the URL set holds this node's URLs only.
+class LiveSource : public PageSource {
+public:
+    LiveSource(const Link& start, int maxDepth, const ClusterOptions* cluster = nullptr,
+        std::shared_ptr<const UrlRanks> ranks = nullptr);
+
+    bool next(SourcePage& page) override;
+    bool followsLinks() const override { return true; }
+    void addLinks(const SourcePage& from, const std::vector<Link>& links) override;
+    void stop() override;
+    std::string describe() const override;
+
+private:
+    struct Task {
+        PackedUrl url;
+        float priority;
+        int32_t depth;
+        uint64_t order;     // first in, first out among equal priorities
+
+        bool operator<(const Task& other) const {
+            return priority != other.priority ? priority < other.priority : order > other.order;
+        }
+    };
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::priority_queue<Task> tasks_;
+    uint64_t pushed_ = 0;
+    uint64_t fetched_ = 0;
+    UrlStore urls_;
+    bool stopped_ = false;
+    std::string startUrl_;
+    std::shared_ptr<const UrlRanks> ranks_;     // null: breadth-first
+
+    // Callers hold mtx_; false if the URL was queued before
+    bool push(PackedUrl url, std::string_view path, int depth, double estimate);
+    double priorityOf(uint64_t hash, double estimate) const;
+    void addRemoteLinks(std::vector<std::pair<Link, int>>&& links);
+
+    // Last, so it stops delivering links before the queue goes away
+    std::unique_ptr<LinkExchange> exchange_;
+};
+
+// Saved pages under a directory. A top-level directory that looks like a
+// host name (wget --mirror layout) gives the pages their original URLs,
+// other files are indexed as file:// URLs.
+class DirectorySource : public PageSource {
+public:
+    explicit DirectorySource(const std::string& root);
+
+    bool next(SourcePage& page) override;
+    void stop() override { stopped_ = true; }
+    std::string describe() const override;
+
+private:
+    std::string root_;
+    std::vector<std::string> files_;
+    std::atomic<size_t> next_{0};
+    std::atomic<bool> stopped_{false};
+};
+
+// Source named by [spider] source: live, warc or directory
+std::unique_ptr<PageSource> makePageSource(const std::string& kind, const std::string& path,
+    const std::string& startUrl, int maxDepth, const ClusterOptions* cluster = nullptr,
+    std::shared_ptr<const UrlRanks> ranks = nullptr);
@@ -0,0 +1,327 @@
+#include "robots.h"
+#include "async_logger.h"
+#include "http_utils.h"
+#include "spider_metrics.h"
+#include <algorithm>
+
+namespace {
+    constexpr size_t kMaxRobotsBytes = 500 * 1024;  // RFC 9309 parsing limit
+
+    std::string_view trim(std::string_view s) {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) s.remove_suffix(1);
+        return s;
+    }
+
+    std::string lower(std::string_view s) {
+        std::string out(s);
+        std::transform(out.begin(), out.end(), out.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return out;
+    }
+
+    // "Name/1.0 (+http://...)" -> "name"
+    std::string productToken(std::string_view agent) {
+        agent = trim(agent);
+        size_t end = agent.find_first_of("/ \t");
+        return lower(agent.substr(0, end));
+    }
+}
+
+RobotsRules RobotsRules::disallowAll() {
+    RobotsRules rules;
+    rules.addRule("/", Disallow);
+    return rules;
+}
+
+RobotsRules RobotsRules::parse(std::string_view text, std::string_view userAgent) {
+    if (text.size() > kMaxRobotsBytes) {
+        text = text.substr(0, kMaxRobotsBytes);
+    }
+
+    // Rules of the groups naming our product token win over the "*" groups
+    std::string token = productToken(userAgent);
+    std::vector<std::pair<std::string_view, Verdict>> specific;
+    std::vector<std::pair<std::string_view, Verdict>> any;
+    bool foundSpecific = false;
+    bool groupSpecific = false;
+    bool groupAny = false;
+    bool readingAgents = false;
+
+    while (!text.empty()) {
+        size_t eol = text.find('\n');
+        std::string_view line = text.substr(0, eol);
+        text.remove_prefix(eol == std::string_view::npos ? text.size() : eol + 1);
+
+        line = line.substr(0, line.find('#'));
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            continue;
+        }
+        std::string key = lower(trim(line.substr(0, colon)));
+        std::string_view value = trim(line.substr(colon + 1));
+
+        if (key == "user-agent") {
+            if (!readingAgents) {
+                groupSpecific = groupAny = false;
+                readingAgents = true;
+            }
+            if (value == "*") {
+                groupAny = true;
+            } else if (!token.empty() && productToken(value) == token) {
+                groupSpecific = foundSpecific = true;
+            }
+            continue;
+        }
+
+        readingAgents = false;
+        Verdict verdict = key == "allow" ? Allow : key == "disallow" ? Disallow : None;
+        if (verdict == None || value.empty()) {
+            continue;
+        }
+        if (groupSpecific) specific.emplace_back(value, verdict);
+        if (groupAny) any.emplace_back(value, verdict);
+    }
+
+    RobotsRules rules;
+    for (const auto& [pattern, verdict] : foundSpecific ? specific : any) {
+        rules.addRule(pattern, verdict);
+    }
+    std::stable_sort(rules.wildcards_.begin(), rules.wildcards_.end(),
+        [](const WildcardRule& a, const WildcardRule& b) { return a.pattern.size() > b.pattern.size(); });
+    return rules;
+}
+
+void RobotsRules::addRule(std::string_view pattern, Verdict verdict) {
+    ++ruleCount_;
+
+    bool anchored = !pattern.empty() && pattern.back() == '$';
+    if (anchored) {
+        pattern.remove_suffix(1);
+    }
+
+    // "/a**b" is "/a*b", and a trailing '*' adds nothing to a prefix match
+    std::string collapsed;
+    for (char c : pattern) {
+        if (c != '*' || collapsed.empty() || collapsed.back() != '*') collapsed.push_back(c);
+    }
+    while (!anchored && !collapsed.empty() && collapsed.back() == '*') {
+        collapsed.pop_back();
+    }
+    if (collapsed.find('*') != std::string::npos) {
+        wildcards_.push_back({std::move(collapsed), anchored, verdict});
+        return;
+    }
+
+    uint32_t node = 0;
+    for (unsigned char c : collapsed) {
+        auto& children = nodes_[node].children;
+        auto it = std::lower_bound(children.begin(), children.end(), c,
+            [](const std::pair<unsigned char, uint32_t>& child, unsigned char key) { return child.first < key; });
+        if (it != children.end() && it->first == c) {
+            node = it->second;
+            continue;
+        }
+        uint32_t child = static_cast<uint32_t>(nodes_.size());
+        children.insert(it, {c, child});
+        nodes_.emplace_back();
+        node = child;
+    }
+
+    Verdict& slot = anchored ? nodes_[node].exact : nodes_[node].prefix;
+    slot = merge(slot, verdict);
+}
+
+bool RobotsRules::allowed(std::string_view path) const {
+    // Every node passed on the way down is a prefix of path, and deeper
+    // means longer, so the last verdict seen is the longest match
+    size_t bestLength = 0;
+    Verdict best = None;
+
+    uint32_t node = 0;
+    size_t depth = 0;
+    while (true) {
+        const Node& current = nodes_[node];
+        if (current.prefix != None) {
+            best = current.prefix;
+            bestLength = depth;
+        }
+        if (depth == path.size()) {
+            if (current.exact != None) {
+                best = current.prefix != None ? merge(current.prefix, current.exact) : current.exact;
+                bestLength = depth;
+            }
+            break;
+        }
+
+        unsigned char c = static_cast<unsigned char>(path[depth]);
+        auto it = std::lower_bound(current.children.begin(), current.children.end(), c,
+            [](const std::pair<unsigned char, uint32_t>& child, unsigned char key) { return child.first < key; });
+        if (it == current.children.end() || it->first != c) {
+            break;
+        }
+        node = it->second;
+        ++depth;
+    }
+
+    for (const auto& rule : wildcards_) {
+        if (rule.pattern.size() < bestLength) {
+            break;
+        }
+        if (wildcardMatch(rule.pattern, rule.anchored, path)) {
+            best = rule.pattern.size() > bestLength ? rule.verdict : merge(best, rule.verdict);
+            bestLength = rule.pattern.size();
+        }
+    }
+
+    return best != Disallow;
+}
+
+bool RobotsRules::wildcardMatch(std::string_view pattern, bool anchored, std::string_view path) {
+    size_t p = 0;
+    size_t s = 0;
+    size_t star = std::string_view::npos;
+    size_t resume = 0;
+
+    while (s < path.size()) {
+        if (p == pattern.size() && !anchored) {
+            return true;
+        }
+        if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            resume = s;
+        } else if (p < pattern.size() && pattern[p] == path[s]) {
+            ++p;
+            ++s;
+        } else if (star != std::string_view::npos) {
+            p = star + 1;
+            s = ++resume;
+        } else {
+            return false;
+        }
+    }
+
+    while (p < pattern.size() && pattern[p] == '*') {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+RobotsCache& RobotsCache::getInstance() {
+    static RobotsCache instance;
+    return instance;
+}
+
+void RobotsCache::configure(Options options) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    options.capacity = std::max<size_t>(1, options.capacity);
+    options_ = std::move(options);
+}
+
+std::string RobotsCache::hostKey(const Link& link) {
+    return (link.protocol == ProtocolType::HTTPS ? "https://" : "http://") + link.hostName;
+}
+
+RobotsCache::Status RobotsCache::check(const Link& link) {
+    Rules rules;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!options_.enabled) {
+            return Status::Allowed;
+        }
+
+        // An entry being fetched is Unknown too: waiting for it here would
+        // hold mtx_ for as long as the slowest host takes to answer
+        auto it = entries_.find(hostKey(link));
+        if (it == entries_.end() || Clock::now() >= it->second.expiresAt ||
+            it->second.rules.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return Status::Unknown;
+        }
+        lru_.splice(lru_.begin(), lru_, it->second.lru);
+        rules = it->second.rules.get();
+    }
+
+    return rules->allowed(link.query) ? Status::Allowed : Status::Disallowed;
+}
+
+bool RobotsCache::allowed(const Link& link) {
+    std::string key = hostKey(link);
+    std::shared_future<Rules> rules;
+    std::shared_ptr<std::promise<Rules>> promise;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!options_.enabled) {
+            return true;
+        }
+
+        auto it = entries_.find(key);
+        if (it != entries_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second.lru);
+        }
+        if (it != entries_.end() && Clock::now() < it->second.expiresAt) {
+            rules = it->second.rules;
+        } else {
+            promise = std::make_shared<std::promise<Rules>>();
+            rules = promise->get_future().share();
+            if (it != entries_.end()) {
+                it->second.rules = rules;
+                it->second.expiresAt = Clock::time_point::max();
+            } else {
+                lru_.push_front(key);
+                entries_[key] = Entry{rules, Clock::time_point::max(), lru_.begin()};
+                evict();
+            }
+        }
+    }
+
+    if (promise) {
+        std::chrono::seconds ttl;
+        promise->set_value(fetch(link, ttl));
+
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto it = entries_.find(key);
+        if (it != entries_.end()) {
+            it->second.expiresAt = Clock::now() + ttl;
+        }
+    }
+
+    return rules.get()->allowed(link.query);
+}
+
+// 4xx (and redirects, which are not followed) mean there are no rules;
+// server errors and unreachable hosts block the host until errorTtl passes
+RobotsCache::Rules RobotsCache::fetch(const Link& link, std::chrono::seconds& ttl) const {
+    SpiderMetrics::get().robotsFetches.add();
+
+    Link robots{link.protocol, link.hostName, "/robots.txt"};
+    HttpResult response = httpGet(robots, "text/plain");
+
+    if (response.status >= 200 && response.status < 300) {
+        ttl = options_.ttl;
+        auto rules = std::make_shared<RobotsRules>(RobotsRules::parse(response.body, options_.userAgent));
+        Log::info() << "🤖 robots.txt for " << link.hostName << ": " << rules->ruleCount() << " rules";
+        return rules;
+    }
+    if (response.status >= 300 && response.status < 500) {
+        ttl = options_.ttl;
+        return std::make_shared<RobotsRules>(RobotsRules::allowAll());
+    }
+
+    ttl = options_.errorTtl;
+    Log::info() << "⚠️  robots.txt unavailable for " << link.hostName << " (status " << response.status
+                << "), host blocked for " << ttl.count() << "s";
+    return std::make_shared<RobotsRules>(RobotsRules::disallowAll());
+}
+
+// Hosts whose robots.txt is still being fetched stay
+void RobotsCache::evict() {
+    auto it = lru_.end();
+    while (entries_.size() > options_.capacity && it != lru_.begin()) {
+        --it;
+        auto entry = entries_.find(*it);
+        if (entry->second.expiresAt == Clock::time_point::max()) {
+            continue;
+        }
+        entries_.erase(entry);
+        it = lru_.erase(it);
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "link.h"
+
+// The Allow/Disallow rules of one robots.txt that apply to our user agent,
+// compiled for matching (RFC 9309: the longest matching rule wins, Allow
+// wins a tie, '*' matches any run of characters, a trailing '$' anchors).
+//
+// Plain prefixes live in a byte trie, so a check is a single walk down the
+// path. The few rules with wildcards are kept apart, longest first, and
+// only tried when they could beat the trie's match.
+class RobotsRules {
+public:
+    static RobotsRules parse(std::string_view text, std::string_view userAgent);
+    static RobotsRules allowAll() { return RobotsRules(); }
+    static RobotsRules disallowAll();
+
+    // path is the URL path with its query, starting with '/'
+    bool allowed(std::string_view path) const;
+
+    size_t ruleCount() const { return ruleCount_; }
+
+private:
+    enum Verdict : uint8_t { None = 0, Allow = 1, Disallow = 2 };
+
+    struct Node {
+        std::vector<std::pair<unsigned char, uint32_t>> children;  // sorted by byte
+        Verdict prefix = None;  // rule "/path"
+        Verdict exact = None;   // rule "/path$"
+    };
+
+    struct WildcardRule {
+        std::string pattern;
+        bool anchored;
+        Verdict verdict;
+    };
+
+    RobotsRules() : nodes_(1) {}
+
+    void addRule(std::string_view pattern, Verdict verdict);
+    static bool wildcardMatch(std::string_view pattern, bool anchored, std::string_view path);
+    static Verdict merge(Verdict current, Verdict added) {
+        return current == Allow || added == Allow ? Allow : added;
+    }
+
+    std::vector<Node> nodes_;
+    std::vector<WildcardRule> wildcards_;
+    size_t ruleCount_ = 0;
+};
+
+// Compiled robots.txt per scheme and host, least recently used hosts
+// evicted past capacity. Lookups for one host share a single fetch.
+class RobotsCache {
+public:
+    enum class Status { Allowed, Disallowed, Unknown };
+
+    struct Options {
+        bool enabled = true;
+        std::string userAgent = "SearchEngineSpider";
+        std::chrono::seconds ttl{86400};
+        std::chrono::seconds errorTtl{600};  // 5xx and unreachable hosts: everything disallowed
+        size_t capacity = 10000;
+    };
+
+    static RobotsCache& getInstance();
+
+    // Must be called before the first lookup
+    void configure(Options options);
+
+    // Never fetches; Unknown when the host's robots.txt is not loaded yet
+    Status check(const Link& link);
+
+    // Fetches robots.txt first if needed
+    bool allowed(const Link& link);
+
+private:
+    using Clock = std::chrono::steady_clock;
+    using Rules = std::shared_ptr<const RobotsRules>;
+
+    struct Entry {
+        std::shared_future<Rules> rules;
+        Clock::time_point expiresAt = Clock::time_point::max();  // max while being fetched
+        std::list<std::string>::iterator lru;
+    };
+
+    RobotsCache() = default;
+    static std::string hostKey(const Link& link);
+    Rules fetch(const Link& link, std::chrono::seconds& ttl) const;
+    void evict();
+
+    std::mutex mtx_;
+    std::unordered_map<std::string, Entry> entries_;
+    std::list<std::string> lru_;  // most recently used first
+    Options options_;
+};
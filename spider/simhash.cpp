@@ -0,0 +1,86 @@
+#include "simhash.h"
+#include <algorithm>
+#include <bit>
+
+uint64_t SimHash::hashTerm(const std::string& term) {
+    // FNV-1a with a final avalanche; fingerprints are stored in the
+    // database, so this must not depend on std::hash
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : term) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+template <class Map, class Weight>
+uint64_t SimHash::computeWeighted(const Map& terms, Weight weight) {
+    std::array<long long, 64> votes{};
+    for (const auto& [term, value] : terms) {
+        uint64_t hash = hashTerm(term);
+        long long w = weight(value);
+        for (int bit = 0; bit < 64; ++bit) {
+            votes[bit] += ((hash >> bit) & 1) ? w : -w;
+        }
+    }
+
+    uint64_t fingerprint = 0;
+    for (int bit = 0; bit < 64; ++bit) {
+        if (votes[bit] > 0) fingerprint |= 1ULL << bit;
+    }
+    return fingerprint;
+}
+
+uint64_t SimHash::compute(const std::unordered_map<std::string, std::vector<uint32_t>>& wordPositions) {
+    return computeWeighted(wordPositions, [](const std::vector<uint32_t>& positions) {
+        return static_cast<long long>(positions.size());
+    });
+}
+
+int SimHash::distance(uint64_t a, uint64_t b) {
+    return std::popcount(a ^ b);
+}
+
+NearDuplicateIndex::NearDuplicateIndex(int maxDistance)
+    : maxDistance_(std::clamp(maxDistance, 0, kMaxDistance))
+{
+}
+
+std::optional<int> NearDuplicateIndex::find(uint64_t fingerprint) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+
+    std::optional<int> best;
+    int bestDistance = maxDistance_ + 1;
+    for (int i = 0; i < kBands; ++i) {
+        auto it = bands_[i].find(band(fingerprint, i));
+        if (it == bands_[i].end()) continue;
+
+        for (const Entry& entry : it->second) {
+            int d = SimHash::distance(fingerprint, entry.fingerprint);
+            if (d < bestDistance) {
+                bestDistance = d;
+                best = entry.documentId;
+                if (d == 0) return best;
+            }
+        }
+    }
+    return best;
+}
+
+void NearDuplicateIndex::insert(uint64_t fingerprint, int documentId) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (int i = 0; i < kBands; ++i) {
+        bands_[i][band(fingerprint, i)].push_back(Entry{fingerprint, documentId});
+    }
+    ++size_;
+}
+
+size_t NearDuplicateIndex::size() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return size_;
+}
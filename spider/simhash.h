@@ -0,0 +1,57 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 64-bit SimHash of a page's bag of words, weighted by term frequency.
+// Pages that differ only in boilerplate (session ids, print footers,
+// mirrors) end up a few bits apart.
+class SimHash {
+public:
+    static uint64_t compute(const std::unordered_map<std::string, std::vector<uint32_t>>& wordPositions);
+
+    static int distance(uint64_t a, uint64_t b);
+
+private:
+    static uint64_t hashTerm(const std::string& term);
+    template <class Map, class Weight>
+    static uint64_t computeWeighted(const Map& terms, Weight weight);
+};
+
+// Banded LSH over SimHash fingerprints: the 64 bits are split into four
+// 16-bit bands, and two fingerprints within Hamming distance 3 always
+// agree on at least one band, so only documents sharing a band value are
+// compared. Safe to use from several worker threads.
+class NearDuplicateIndex {
+public:
+    static constexpr int kBands = 4;
+    static constexpr int kMaxDistance = kBands - 1;
+
+    explicit NearDuplicateIndex(int maxDistance = kMaxDistance);
+
+    // Canonical document whose fingerprint is within maxDistance, if any
+    std::optional<int> find(uint64_t fingerprint) const;
+    void insert(uint64_t fingerprint, int documentId);
+
+    size_t size() const;
+    int maxDistance() const { return maxDistance_; }
+
+private:
+    struct Entry {
+        uint64_t fingerprint;
+        int documentId;
+    };
+
+    static uint16_t band(uint64_t fingerprint, int index) {
+        return static_cast<uint16_t>(fingerprint >> (index * 16));
+    }
+
+    int maxDistance_;
+    mutable std::mutex mtx_;
+    std::array<std::unordered_map<uint16_t, std::vector<Entry>>, kBands> bands_;
+    size_t size_ = 0;
+};
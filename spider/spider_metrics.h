@@ -0,0 +1,61 @@
+#pragma once
+#include "metrics.h"
+
+// Crawl metrics, exported on [spider] metrics_port
+struct SpiderMetrics {
+    metrics::Counter& pagesIndexed;
+    metrics::Counter& pagesDuplicate;
+    metrics::Counter& bytesFetched;
+    metrics::Counter& fetchErrors;
+    metrics::Counter& dbErrors;
+    metrics::Counter& otherErrors;
+    metrics::Histogram& fetchSeconds;
+    metrics::Histogram& parseSeconds;
+    metrics::Histogram& dbWriteSeconds;
+    metrics::Counter& dnsHits;
+    metrics::Counter& dnsMisses;
+    metrics::Counter& dnsCoalesced;
+    metrics::Counter& dnsFailures;
+    metrics::Histogram& dnsSeconds;
+    metrics::Counter& robotsBlocked;
+    metrics::Counter& robotsFetches;
+    metrics::Counter& clusterSent;
+    metrics::Counter& clusterReceived;
+    metrics::Counter& clusterDropped;
+    metrics::Gauge& queueDepth;
+    metrics::Gauge& fetchedQueue;
+    metrics::Gauge& parsedQueue;
+    metrics::Gauge& visitedUrls;
+    metrics::Gauge& busyWorkers;
+
+    static SpiderMetrics& get() {
+        auto& r = metrics::Registry::getInstance();
+        static SpiderMetrics instance{
+            r.counter("spider_pages_indexed_total", "Pages written to the index"),
+            r.counter("spider_pages_duplicate_total", "Pages collapsed into a near-duplicate"),
+            r.counter("spider_fetched_bytes_total", "Decoded page bytes fetched"),
+            r.counter("spider_errors_total", "Failed pages by error type", "type=\"fetch\""),
+            r.counter("spider_errors_total", "Failed pages by error type", "type=\"db\""),
+            r.counter("spider_errors_total", "Failed pages by error type", "type=\"other\""),
+            r.histogram("spider_fetch_seconds", "Time to download a page"),
+            r.histogram("spider_parse_seconds", "Time to extract text, title and terms"),
+            r.histogram("spider_db_write_seconds", "Time to write a batch of pages to the index"),
+            r.counter("spider_dns_lookups_total", "Host name lookups by cache outcome", "result=\"hit\""),
+            r.counter("spider_dns_lookups_total", "Host name lookups by cache outcome", "result=\"miss\""),
+            r.counter("spider_dns_lookups_total", "Host name lookups by cache outcome", "result=\"coalesced\""),
+            r.counter("spider_dns_failures_total", "Lookups that failed and were cached as negative"),
+            r.histogram("spider_dns_seconds", "Time spent in getaddrinfo"),
+            r.counter("spider_robots_blocked_total", "Links skipped because robots.txt disallows them"),
+            r.counter("spider_robots_fetches_total", "robots.txt files fetched"),
+            r.counter("spider_cluster_links_total", "Links exchanged with other cluster nodes", "direction=\"sent\""),
+            r.counter("spider_cluster_links_total", "Links exchanged with other cluster nodes", "direction=\"received\""),
+            r.counter("spider_cluster_links_dropped_total", "Links lost because their node stayed unreachable"),
+            r.gauge("spider_queue_depth", "Links waiting to be crawled"),
+            r.gauge("spider_stage_queue_depth", "Pages waiting between pipeline stages", "queue=\"fetched\""),
+            r.gauge("spider_stage_queue_depth", "Pages waiting between pipeline stages", "queue=\"parsed\""),
+            r.gauge("spider_visited_urls", "URLs taken off the frontier"),
+            r.gauge("spider_busy_workers", "Parse and index workers currently busy"),
+        };
+        return instance;
+    }
+};
@@ -0,0 +1,342 @@
+#include "warc_source.h"
+#include "async_logger.h"
+#include "charset.h"
+#include <zlib.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+    bool endsWith(const std::string& text, std::string_view suffix) {
+        return text.size() >= suffix.size()
+            && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    bool equalsNoCase(std::string_view a, std::string_view b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(),
+            [](char x, char y) { return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y)); });
+    }
+
+    bool containsNoCase(std::string_view text, std::string_view needle) {
+        return std::search(text.begin(), text.end(), needle.begin(), needle.end(),
+            [](char x, char y) { return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y)); })
+            != text.end();
+    }
+
+    std::string_view trim(std::string_view text) {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+        while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) text.remove_suffix(1);
+        return text;
+    }
+
+    // Header block of a WARC record or HTTP message: the lines after the
+    // first one, up to an empty line. Returns the offset just past the
+    // empty line, or npos if it is missing.
+    size_t headerEnd(std::string_view data) {
+        size_t pos = 0;
+        while (pos < data.size()) {
+            size_t end = data.find('\n', pos);
+            if (end == std::string_view::npos) return std::string_view::npos;
+            if (end == pos || (end == pos + 1 && data[pos] == '\r')) return end + 1;
+            pos = end + 1;
+        }
+        return std::string_view::npos;
+    }
+
+    std::string_view headerValue(std::string_view headers, std::string_view name) {
+        size_t pos = 0;
+        while (pos < headers.size()) {
+            size_t end = headers.find('\n', pos);
+            if (end == std::string_view::npos) end = headers.size();
+            std::string_view line = headers.substr(pos, end - pos);
+            size_t colon = line.find(':');
+            if (colon != std::string_view::npos && equalsNoCase(trim(line.substr(0, colon)), name)) {
+                return trim(line.substr(colon + 1));
+            }
+            pos = end + 1;
+        }
+        return {};
+    }
+
+    bool parseSize(std::string_view text, size_t& value) {
+        if (text.empty()) return false;
+        value = 0;
+        for (char c : text) {
+            if (c < '0' || c > '9') return false;
+            value = value * 10 + static_cast<size_t>(c - '0');
+        }
+        return true;
+    }
+
+    bool decodeChunked(std::string_view body, std::string& out) {
+        out.clear();
+        size_t pos = 0;
+        while (pos < body.size()) {
+            size_t lineEnd = body.find('\n', pos);
+            if (lineEnd == std::string_view::npos) return false;
+            size_t size = 0;
+            bool any = false;
+            for (size_t i = pos; i < lineEnd; ++i) {
+                char c = body[i];
+                int digit = c >= '0' && c <= '9' ? c - '0'
+                    : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                    : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+                if (digit < 0) break;
+                size = size * 16 + static_cast<size_t>(digit);
+                any = true;
+            }
+            if (!any) return false;
+            pos = lineEnd + 1;
+            if (size == 0) return true;
+            if (size > body.size() - pos) return false;
+            out.append(body.substr(pos, size));
+            pos += size;
+            if (pos < body.size() && body[pos] == '\r') ++pos;
+            if (pos < body.size() && body[pos] == '\n') ++pos;
+        }
+        return true;
+    }
+
+    // HTTP response stored in a WARC "response" record
+    bool responseToPage(std::string_view block, SourcePage& page) {
+        if (block.substr(0, 5) != "HTTP/") return false;
+        size_t statusPos = block.find(' ');
+        if (statusPos == std::string_view::npos || statusPos + 1 >= block.size() || block[statusPos + 1] != '2') {
+            return false;
+        }
+
+        size_t bodyStart = headerEnd(block);
+        if (bodyStart == std::string_view::npos) return false;
+        std::string_view headers = block.substr(0, bodyStart);
+        std::string_view body = block.substr(bodyStart);
+
+        std::string_view contentType = headerValue(headers, "Content-Type");
+        if (!contentType.empty() && !containsNoCase(contentType, "html")) return false;
+
+        std::string_view encoding = headerValue(headers, "Content-Encoding");
+        if (!encoding.empty() && !equalsNoCase(encoding, "identity")) return false;
+
+        if (containsNoCase(headerValue(headers, "Transfer-Encoding"), "chunked")) {
+            if (!decodeChunked(body, page.content)) return false;
+        } else {
+            page.content.assign(body);
+        }
+        transcodeToUtf8(page.content, contentType);
+        return true;
+    }
+}
+
+WarcSource::WarcSource(const std::string& path)
+    : path_(path)
+{
+    namespace fs = std::filesystem;
+
+    if (fs::is_directory(path)) {
+        std::vector<std::string> archives;
+        for (const auto& entry : fs::directory_iterator(path)) {
+            std::string name = entry.path().string();
+            if (entry.is_regular_file() && (endsWith(name, ".warc") || endsWith(name, ".warc.gz")
+                || endsWith(name, ".wet") || endsWith(name, ".wet.gz"))) {
+                archives.push_back(name);
+            }
+        }
+        std::sort(archives.begin(), archives.end());
+        for (const auto& archive : archives) {
+            addFile(archive);
+        }
+    } else {
+        addFile(path);
+    }
+
+    if (files_.empty()) {
+        throw std::runtime_error("No WARC files at " + path);
+    }
+}
+
+void WarcSource::addFile(const std::string& path) {
+    auto file = std::make_unique<MappedFile>(path);
+    const unsigned char* data = file->data();
+    size_t size = file->size();
+    size_t fileIndex = files_.size();
+    size_t firstChunk = chunks_.size();
+
+    if (endsWith(path, ".gz")) {
+        // Candidate member starts: gzip magic followed by the deflate method
+        const unsigned char* p = data;
+        const unsigned char* end = data + size;
+        while (p + 3 <= end) {
+            p = static_cast<const unsigned char*>(std::memchr(p, 0x1f, static_cast<size_t>(end - p - 2)));
+            if (!p) break;
+            // Inflate stops at the end of the member, so it may run to the end of the file
+            if (p[1] == 0x8b && p[2] == 0x08) {
+                size_t offset = static_cast<size_t>(p - data);
+                chunks_.push_back({fileIndex, offset, size - offset, true});
+            }
+            ++p;
+        }
+    } else {
+        // Walk record headers: "WARC/1.x", fields, empty line, Content-Length bytes
+        std::string_view text(reinterpret_cast<const char*>(data), size);
+        size_t pos = 0;
+        while (pos < size) {
+            size_t start = text.find("WARC/", pos);
+            if (start == std::string_view::npos) break;
+            size_t blockStart = headerEnd(text.substr(start));
+            size_t length = 0;
+            if (blockStart == std::string_view::npos
+                || !parseSize(headerValue(text.substr(start, blockStart), "Content-Length"), length)) {
+                pos = start + 5;
+                continue;
+            }
+            size_t recordEnd = std::min(size, start + blockStart + length);
+            chunks_.push_back({fileIndex, start, recordEnd - start, false});
+            pos = recordEnd;
+        }
+    }
+
+    Log::info() << "📦 " << path << ": " << (chunks_.size() - firstChunk)
+                << (endsWith(path, ".gz") ? " gzip members" : " records");
+    files_.push_back(std::move(file));
+}
+
+bool WarcSource::inflateMember(const unsigned char* data, size_t size, std::string& out) {
+    z_stream zs{};
+    if (inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK) {
+        return false;
+    }
+
+    out.clear();
+    char buffer[65536];
+    const unsigned char* p = data;
+    size_t left = size;
+    int rc = Z_OK;
+    while (rc == Z_OK) {
+        if (zs.avail_in == 0 && left > 0) {
+            uInt feed = static_cast<uInt>(std::min<size_t>(left, std::numeric_limits<uInt>::max()));
+            zs.next_in = const_cast<Bytef*>(p);
+            zs.avail_in = feed;
+            p += feed;
+            left -= feed;
+        }
+        zs.next_out = reinterpret_cast<Bytef*>(buffer);
+        zs.avail_out = sizeof(buffer);
+        rc = inflate(&zs, Z_NO_FLUSH);
+        out.append(buffer, sizeof(buffer) - zs.avail_out);
+
+        // The first bytes tell a real member from magic inside compressed data
+        if (out.size() >= 5 && out.compare(0, 5, "WARC/") != 0) {
+            rc = Z_DATA_ERROR;
+        }
+        if (rc == Z_BUF_ERROR && left > 0) {
+            rc = Z_OK;
+        }
+    }
+    inflateEnd(&zs);
+    return rc == Z_STREAM_END;
+}
+
+void WarcSource::parseRecords(std::string_view data, std::vector<SourcePage>& out) {
+    size_t pos = 0;
+    while (pos < data.size()) {
+        size_t start = data.find("WARC/", pos);
+        if (start == std::string_view::npos) break;
+
+        std::string_view record = data.substr(start);
+        size_t blockStart = headerEnd(record);
+        size_t length = 0;
+        if (blockStart == std::string_view::npos
+            || !parseSize(headerValue(record.substr(0, blockStart), "Content-Length"), length)) {
+            pos = start + 5;
+            continue;
+        }
+        std::string_view headers = record.substr(0, blockStart);
+        std::string_view block = record.substr(blockStart, length);
+        pos = start + blockStart + block.size();
+
+        std::string_view type = headerValue(headers, "WARC-Type");
+        std::string_view uri = headerValue(headers, "WARC-Target-URI");
+        if (uri.size() >= 2 && uri.front() == '<' && uri.back() == '>') {
+            uri = uri.substr(1, uri.size() - 2);
+        }
+        if (uri.empty()) continue;
+
+        SourcePage page;
+        page.url.assign(uri);
+        if (!parseLink(page.url, page.link)) continue;
+
+        if (type == "response") {
+            if (!responseToPage(block, page)) continue;
+        } else if (type == "conversion") {
+            page.content.assign(block);
+            page.plainText = true;
+        } else if (type == "resource") {
+            std::string_view contentType = headerValue(headers, "Content-Type");
+            if (!containsNoCase(contentType, "html")) continue;
+            page.content.assign(block);
+            transcodeToUtf8(page.content, contentType);
+        } else {
+            continue;
+        }
+        out.push_back(std::move(page));
+    }
+}
+
+bool WarcSource::next(SourcePage& page) {
+    std::vector<SourcePage> decoded;
+    std::string inflated;
+
+    while (!stopped_) {
+        {
+            std::lock_guard<std::mutex> lock(pendingMtx_);
+            if (!pending_.empty()) {
+                page = std::move(pending_.back());
+                pending_.pop_back();
+                return true;
+            }
+        }
+
+        size_t index = next_.fetch_add(1);
+        if (index >= chunks_.size()) {
+            // Records another worker adds to pending_ later are picked up by that worker
+            std::lock_guard<std::mutex> lock(pendingMtx_);
+            if (pending_.empty()) return false;
+            page = std::move(pending_.back());
+            pending_.pop_back();
+            return true;
+        }
+
+        const Chunk& chunk = chunks_[index];
+        const unsigned char* data = files_[chunk.file]->data() + chunk.offset;
+        std::string_view records;
+        if (chunk.gzip) {
+            if (!inflateMember(data, chunk.length, inflated)) continue;
+            records = inflated;
+        } else {
+            records = std::string_view(reinterpret_cast<const char*>(data), chunk.length);
+        }
+
+        decoded.clear();
+        try {
+            parseRecords(records, decoded);
+        } catch (const std::exception& e) {
+            Log::error() << "❌ Bad WARC record in " << files_[chunk.file]->path() << " at " << chunk.offset << ": " << e.what();
+            continue;
+        }
+        if (decoded.empty()) continue;
+
+        page = std::move(decoded.front());
+        if (decoded.size() > 1) {
+            std::lock_guard<std::mutex> lock(pendingMtx_);
+            std::move(decoded.begin() + 1, decoded.end(), std::back_inserter(pending_));
+        }
+        return true;
+    }
+    return false;
+}
+
+std::string WarcSource::describe() const {
+    return "WARC " + path_ + " (" + std::to_string(files_.size()) + " files, "
+        + std::to_string(chunks_.size()) + " chunks)";
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "mapped_file.h"
+#include "page_source.h"
+
+// Pages from WARC and WET archives (.warc, .warc.gz, .wet, .wet.gz), a
+// single file or every archive in a directory. Files are memory mapped.
+//
+// Compressed archives are series of gzip members, normally one per record.
+// Member starts are found up front by scanning for the gzip magic, and
+// workers inflate the members they claim in parallel; a candidate that
+// turns out to be inside another member simply fails to inflate and is
+// skipped. An archive compressed as a single member is inflated by one
+// worker into memory. Uncompressed archives are split into records by walking the
+// record headers, which only touches the header pages.
+//
+// Indexed records: HTTP 2xx "response" records with an HTML payload,
+// "resource" records with text/html content, and WET "conversion" records
+// (extracted plain text).
+class WarcSource : public PageSource {
+public:
+    explicit WarcSource(const std::string& path);
+
+    bool next(SourcePage& page) override;
+    void stop() override { stopped_ = true; }
+    std::string describe() const override;
+
+    // Appends the indexable pages among the records in data
+    static void parseRecords(std::string_view data, std::vector<SourcePage>& out);
+
+private:
+    struct Chunk {
+        size_t file;
+        size_t offset;
+        size_t length;
+        bool gzip;
+    };
+
+    void addFile(const std::string& path);
+    static bool inflateMember(const unsigned char* data, size_t size, std::string& out);
+
+    std::string path_;
+    std::vector<std::unique_ptr<MappedFile>> files_;
+    std::vector<Chunk> chunks_;
+    std::atomic<size_t> next_{0};
+    std::atomic<bool> stopped_{false};
+
+    // Members holding more than one record leave the rest here
+    std::mutex pendingMtx_;
+    std::vector<SourcePage> pending_;
+};